@@ -5,6 +5,13 @@ if not exist ..\build mkdir ..\build
 pushd ..\build
 
 cl /Od /nologo /Zi /EHsc /D %platform% /I ..\src /Febuilder ^
-	..\src\builder\builder.cpp
+	..\src\builder\builder.cpp     ^
+	..\src\builder\cook.cpp        ^
+	..\src\room_format.cpp         ^
+	..\src\parsing.cpp             ^
+	..\src\math_m.cpp              ^
+	..\src\mip_maps.cpp            ^
+	..\src\texture_compression.cpp ^
+	..\src\hash.cpp
 
 popd
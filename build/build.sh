@@ -0,0 +1,16 @@
+#!/bin/sh
+platform="LINUX"
+
+mkdir -p ../build
+cd ../build
+
+g++ -O0 -g -D $platform -I ../src -Wno-write-strings -o builder \
+	../src/builder/builder.cpp     \
+	../src/builder/cook.cpp        \
+	../src/room_format.cpp         \
+	../src/parsing.cpp             \
+	../src/math_m.cpp              \
+	../src/mip_maps.cpp            \
+	../src/texture_compression.cpp \
+	../src/hash.cpp                \
+	-lpthread
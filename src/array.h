@@ -1,6 +1,11 @@
 #pragma once
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+#include "macros.h"
 
 template <typename T>
 struct Array {
@@ -28,6 +33,23 @@ struct Array {
 // ************************ //
 static const int MIN_SIZE_ARRAY = 8;
 
+#ifdef PERF_MON
+inline std::atomic<long long> * get_array_allocation_counter() {
+    static std::atomic<long long> counter;
+    return &counter;
+}
+#endif
+
+// Times any Array got memory so far, on every thread, for the debug overlay. -1 without PERF_MON. The game and each
+// renderer DLL count their own.
+inline long long get_array_allocation_count() {
+#ifdef PERF_MON
+    return get_array_allocation_counter()->load(std::memory_order_relaxed);
+#else
+    return -1;
+#endif
+}
+
 template <typename T>
 bool Array<T>::add_at_index(T item, int index) {
     if (index >= this->allocated) {
@@ -151,5 +173,9 @@ bool Array<T>::reserve(int to_reserve, bool zero) { // Default : zero = false
     this->data = (T *) new_block;
     this->allocated = to_reserve;
 
+#ifdef PERF_MON
+    get_array_allocation_counter()->fetch_add(1, std::memory_order_relaxed);
+#endif
+
     return true;
 }
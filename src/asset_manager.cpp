@@ -1,10 +1,33 @@
 #include "asset_manager.h"
+#include "job_system.h"
 #include "parsing.h"
 #include "macros.h"
+#include "pack_file.h"
+#include "profiler.h"
+
+struct AsyncLoad {
+    AssetManager * manager;
+    Asset * asset;
+    void * load;
+};
+
+struct PendingLoad {
+    int index; // In assets_to_reload
+    int file_size;
+};
+
+// Private functions
+static void do_async_load_job(void * data);
+static void end_async_load_job(void * data);
+
+static int compare_pending_loads(const void * a, const void * b);
 
 // @Incomplete, make those pointers instead of v functions
-void AssetManager::create_placeholder(char * name, char * path) {
-    log_print("create_placeholder", "we ned to create a placeholder for asset %s, but the manager has no create_placeholder function", name);
+void AssetManager::create_placeholder(String name, String path) {
+    char * c_name = to_c_string(name);
+    scope_exit(free(c_name));
+
+    log_print("create_placeholder", "we ned to create a placeholder for asset %s, but the manager has no create_placeholder function", c_name);
 }
 
 void AssetManager::reload_or_create_asset(String file_path, String file_name) {
@@ -14,11 +37,126 @@ void AssetManager::reload_or_create_asset(String file_path, String file_name) {
     log_print("reload_or_create_asset", "Asset %s is up for reloading, but the manager has no reload_or_create_asset function", c_file_name);
 }
 
+void AssetManager::load_asset(Asset * asset) {
+    char * c_name = to_c_string(asset->name);
+    scope_exit(free(c_name));
+
+    log_print("load_asset", "Asset %s is up for loading, but the manager has no load_asset function", c_name);
+}
+
+Asset * AssetManager::find_or_create_asset(String file_path, String file_name) {
+    return NULL; // Only AssetManager_Poly has a table to look in.
+}
+
+void * AssetManager::begin_async_load(Asset * asset) {
+    return NULL; // Load synchronously.
+}
+
+void AssetManager::do_async_load(void * load) {}
+
+void AssetManager::end_async_load(void * load) {}
+
+// Kicks a job for every asset that needs (re)loading, the results get published by the job system, see
+// run_finished_jobs and wait_for_all_jobs.
+//
+// The biggest files go first. Decode time is roughly proportional to size, so if a big texture were picked up last,
+// every other worker would sit idle while one thread finishes it.
 void AssetManager::perform_reloads() {
-    for_array(this->assets_to_reload.data, this->assets_to_reload.count) {
-        //scope_exit(free(it->full_path.data));
-        reload_or_create_asset(it->full_path, it->name);
+    if(!this->assets_to_reload.count) return;
+
+    profile_function();
+
+    // Take the batch out first, loads that finish while we're kicking jobs (add_job helps out when the queue is full)
+    // can queue more reloads, and those are for the next call.
+    Array<Asset> batch = this->assets_to_reload;
+    this->assets_to_reload = {};
+
+    int num_loads = batch.count;
+
+    PendingLoad * order = (PendingLoad *) malloc(num_loads * sizeof(PendingLoad));
+    scope_exit(free(order));
+
+    for(int i = 0; i < num_loads; i++) {
+        order[i].index     = i;
+        order[i].file_size = get_asset_file_size(batch.data[i].full_path);
     }
 
-    this->assets_to_reload.reset(true);
+    qsort(order, num_loads, sizeof(PendingLoad), compare_pending_loads);
+
+    for_array(order, num_loads) {
+        Asset * to_reload = &batch.data[it->index];
+
+        Asset * asset = find_or_create_asset(to_reload->full_path, to_reload->name);
+
+        if(!asset) { // Not a table manager, no async loading.
+            reload_or_create_asset(to_reload->full_path, to_reload->name);
+            for_array_continue;
+        }
+
+        if(asset->loading) {
+            // Can't have two loads of the same asset in flight, they could finish out of order. We'll go again once
+            // this one is done.
+            asset->reload_pending = true;
+            for_array_continue;
+        }
+
+        void * load = begin_async_load(asset);
+
+        if(!load) {
+            load_asset(asset);
+            for_array_continue;
+        }
+
+        asset->loading = true;
+
+        AsyncLoad * async_load = (AsyncLoad *) malloc(sizeof(AsyncLoad));
+        async_load->manager = this;
+        async_load->asset   = asset;
+        async_load->load    = load;
+
+        add_job(do_async_load_job, end_async_load_job, async_load);
+    }
+
+    batch.reset(true);
+}
+
+// Biggest first, ties keep the order the hotloader gave us.
+static int compare_pending_loads(const void * a, const void * b) {
+    PendingLoad * first  = (PendingLoad *) a;
+    PendingLoad * second = (PendingLoad *) b;
+
+    if(first->file_size != second->file_size) return (first->file_size > second->file_size) ? -1 : 1;
+
+    return first->index - second->index;
+}
+
+static void do_async_load_job(void * data) {
+    profile_zone("do_async_load");
+
+    AsyncLoad * async_load = (AsyncLoad *) data;
+    async_load->manager->do_async_load(async_load->load);
+}
+
+static void end_async_load_job(void * data) {
+    profile_zone("end_async_load");
+
+    AsyncLoad * async_load = (AsyncLoad *) data;
+    scope_exit(free(async_load));
+
+    Asset * asset = async_load->asset;
+
+    async_load->manager->end_async_load(async_load->load);
+
+    asset->loading = false;
+
+    if(asset->reload_pending) {
+        asset->reload_pending = false;
+
+        // The path we queue gets freed by find_or_create_asset since the asset exists, so give it a copy.
+        Asset reload = *asset;
+        reload.full_path.data = (char *) malloc(asset->full_path.count);
+        memcpy(reload.full_path.data, asset->full_path.data, asset->full_path.count);
+
+        async_load->manager->assets_to_reload.add(reload);
+    }
 }
@@ -11,6 +11,11 @@ struct Asset {
     String name;
     String full_path;
     String extension;
+
+    unsigned long long content_hash = 0; // murmur_hash_64a of the file it was last loaded from, 0 if it wasn't.
+
+    bool loading        = false; // A job is loading it on a worker thread, see AssetManager::perform_reloads.
+    bool reload_pending = false; // It changed again while it was loading.
 };
 
 struct AssetManager {
@@ -19,13 +24,41 @@ struct AssetManager {
     Array<Asset> assets_to_reload;
 
     // ------ Functions ------
-    virtual void create_placeholder(char * name, char * path);
+    virtual void create_placeholder(String name, String path);
     virtual void reload_or_create_asset(String file_path, String file_name);
 
+    virtual Asset * find_or_create_asset(String file_path, String file_name);
+
+    virtual void load_asset(Asset * asset); // Synchronous
+
+    // Asynchronous loading. begin runs on the main thread and returns whatever the worker needs (return NULL to load
+    // synchronously with load_asset instead), do runs on a worker thread and must not touch anything shared, end runs
+    // on the main thread to publish the result and free it.
+    virtual void * begin_async_load(Asset * asset);
+    virtual void   do_async_load   (void * load);
+    virtual void   end_async_load  (void * load);
+
     void perform_reloads();
 };
 
 template <typename T>
 struct AssetManager_Poly : AssetManager{
     Table<String, T *> table;
+
+    Asset * find_or_create_asset(String file_path, String file_name);
 };
+
+// Takes ownership of file_path if the asset gets created, frees it otherwise.
+template <typename T>
+Asset * AssetManager_Poly<T>::find_or_create_asset(String file_path, String file_name) {
+    T * asset = this->table.find(file_name);
+
+    if(!asset) {
+        this->create_placeholder(file_name, file_path);
+        asset = this->table.find(file_name);
+    } else {
+        free(file_path.data);
+    }
+
+    return asset;
+}
@@ -0,0 +1,525 @@
+#include "audio_manager.h"
+#include "job_system.h"
+#include "pack_file.h"
+#include "macros.h"
+#include "profiler.h"
+#include "os/layer.h"
+
+// Made every time a sound that streams plays. The mixer reads audio, decode_stream writes it, on the main thread
+// for the first chunk, then on the job system, one job at a time.
+struct SoundStream {
+    Sound * sound;
+
+    AudioStream audio;
+
+    // Read, not mapped, the track can be saved over while it plays. If it got shorter we get a short read and the
+    // stream ends there, where a mapping would have been a SIGBUS on Linux.
+    AssetFile file;
+    unsigned char * chunk; // The file's bytes for up to STREAM_CHUNK_FRAMES frames, decoded into the ring from there.
+    WavInfo wav;           // The sound's when it started, it can reload while we play.
+
+    int next_frame; // In the file
+    int loops;      // Times we go back to the start of the file, LOOP_FOREVER to never stop.
+
+    unsigned int voice;
+
+    bool decoding; // A job is writing to it.
+    bool stopped;  // The sound reloaded, nothing more gets decoded, it ends with what the ring has.
+};
+
+// Read and decoded on a worker thread, published by end_async_load.
+struct LoadedSound {
+    Sound * sound;
+
+    String full_path; // Copy, the sound's path can't be touched from the worker.
+
+    bool success;
+    WavInfo wav;
+    AudioClip * clip; // NULL if it streams.
+};
+
+// Private functions
+static bool read_sound_file(String full_path, WavInfo * wav, AudioClip ** clip);
+static bool parse_wav_header(char * c_path, String file_data, WavInfo * wav);
+static void decode_wav_frames(WavInfo * wav, unsigned char * source, int num_frames, float * destination);
+static bool should_stream(WavInfo * wav);
+
+static void decode_stream(SoundStream * stream, int max_frames);
+static void decode_stream_job(void * data);
+static void finish_stream_job(void * data);
+static long long get_clip_size(AudioClip * clip);
+static void free_sound_stream(SoundStream * stream);
+
+static unsigned int read_u16(unsigned char * data);
+static unsigned int read_u32(unsigned char * data);
+
+// Const
+const int WAV_FORMAT_PCM        = 1;
+const int WAV_FORMAT_FLOAT      = 3;
+const int WAV_FORMAT_EXTENSIBLE = 0xfffe; // The real format is at the start of the sub format GUID.
+
+void AudioManager::init() {
+    this->extensions.add("wav");
+}
+
+void AudioManager::create_placeholder(String name, String path) {
+    Sound * sound = (Sound *) malloc(sizeof(Sound));
+
+    sound->name      = name;
+    sound->full_path = path;
+
+    sound->loaded   = false;
+    sound->wav      = {};
+    sound->streamed = false;
+    sound->clip     = NULL;
+
+    sound->content_hash   = 0;
+    sound->loading        = false;
+    sound->reload_pending = false;
+
+    this->table.add(name, sound);
+}
+
+void AudioManager::reload_or_create_asset(String full_path, String file_name) {
+    Asset * asset = this->table.find(file_name);
+
+    if(!asset) {
+        create_placeholder(file_name, full_path);
+        asset = this->table.find(file_name);
+    } else {
+        free(full_path.data);
+    }
+
+    do_load_sound((Sound *) asset);
+}
+
+void AudioManager::load_asset(Asset * asset) {
+    do_load_sound((Sound *) asset);
+}
+
+void * AudioManager::begin_async_load(Asset * asset) {
+    LoadedSound * load = (LoadedSound *) malloc(sizeof(LoadedSound));
+
+    load->sound   = (Sound *) asset;
+    load->success = false;
+
+    load->full_path.count = asset->full_path.count;
+    load->full_path.data  = (char *) malloc(asset->full_path.count);
+    memcpy(load->full_path.data, asset->full_path.data, asset->full_path.count);
+
+    return load;
+}
+
+void AudioManager::do_async_load(void * data) {
+    LoadedSound * load = (LoadedSound *) data;
+    load->success = read_sound_file(load->full_path, &load->wav, &load->clip);
+}
+
+void AudioManager::end_async_load(void * data) {
+    LoadedSound * load = (LoadedSound *) data;
+    scope_exit(free(load));
+    scope_exit(free(load->full_path.data));
+
+    if(!load->success) return; // Keep whatever we had.
+
+    publish_sound(load->sound, &load->wav, load->clip);
+}
+
+void AudioManager::do_load_sound(Sound * sound) {
+    WavInfo wav;
+    AudioClip * clip;
+
+    if(!read_sound_file(sound->full_path, &wav, &clip)) return;
+
+    publish_sound(sound, &wav, clip);
+}
+
+// Whatever plays the old version stops: voices of its clip fade out, its streams end with what they already decoded.
+void AudioManager::publish_sound(Sound * sound, WavInfo * wav, AudioClip * clip) {
+    if(sound->clip) retire_clip(sound->clip);
+
+    for_array(this->streams.data, this->streams.count) {
+        SoundStream * stream = *it;
+
+        if(stream->sound != sound || stream->stopped) for_array_continue;
+
+        stop_voice(stream->voice);
+        stream->stopped = true;
+    }
+
+    sound->loaded   = true;
+    sound->wav      = *wav;
+    sound->streamed = clip == NULL;
+    sound->clip     = clip;
+}
+
+// Voices can be mixing it right now, it's freed by update_streams once the mixer is surely done with it.
+void AudioManager::retire_clip(AudioClip * clip) {
+    if(!stop_clip(clip)) {
+        log_print("load_sound", "Too many audio commands, the old version of a sound keeps playing and never gets freed"); // @Leak
+        return;
+    }
+
+    this->retired_clips.add(clip);
+    this->retired_at_blocks.add(get_mixed_block_count());
+}
+
+unsigned int AudioManager::play_sound(Sound * sound, float gain, float pan, int loops, SoundCategory category, int priority) { // @Default gain = 1.0f, pan = 0.0f, loops = 0, category = SOUND_CATEGORY_EFFECTS, priority = 0
+    if(!sound) return NO_VOICE;
+
+    if(!sound->loaded) {
+        do_load_sound(sound); // Not loaded yet, the hotloader hasn't gotten to it.
+
+        if(!sound->loaded) return NO_VOICE; // Already complained.
+    }
+
+    if(!sound->streamed) return play_clip(sound->clip, gain, pan, loops, category, priority);
+
+    WavInfo * wav = &sound->wav;
+
+    // It could have changed since we parsed it, we'd hear about it from the hotloader soon.
+    long long data_size = (long long) wav->num_frames * wav->num_channels * (wav->bits_per_sample / 8);
+
+    if(wav->data_offset + data_size > get_asset_file_size(sound->full_path)) {
+        char * c_name = to_c_string(sound->name);
+        scope_exit(free(c_name));
+        log_print("play_sound", "\"%s\" got shorter since it loaded, not playing it", c_name);
+
+        return NO_VOICE;
+    }
+
+    AssetFile file;
+    if(!open_asset_file(sound->full_path, &file)) return NO_VOICE; // Should have already errored.
+
+    SoundStream * stream = (SoundStream *) malloc(sizeof(SoundStream));
+
+    stream->sound      = sound;
+    stream->file       = file;
+    stream->chunk      = (unsigned char *) malloc(STREAM_CHUNK_FRAMES * wav->num_channels * (wav->bits_per_sample / 8));
+    stream->wav        = *wav;
+    stream->next_frame = 0;
+    stream->loops      = loops;
+    stream->decoding   = false;
+    stream->stopped    = false;
+
+    init_audio_stream(&stream->audio, wav->num_channels, wav->sample_rate, STREAM_RING_FRAMES);
+
+    // Right away, so the mixer has something when it starts the voice. update_streams takes it from there.
+    decode_stream(stream, STREAM_CHUNK_FRAMES);
+
+    stream->voice = play_stream(&stream->audio, gain, pan, category, priority);
+
+    if(stream->voice == NO_VOICE) {
+        free_sound_stream(stream);
+        return NO_VOICE;
+    }
+
+    this->streams.add(stream);
+
+    return stream->voice;
+}
+
+void AudioManager::update_streams() {
+    unsigned int mixed_blocks = get_mixed_block_count();
+
+    // The block that was mixing when we stopped the clip, then the one that faded it out.
+    int kept = 0;
+
+    for(int i = 0; i < this->retired_clips.count; i++) {
+        AudioClip * clip = this->retired_clips.data[i];
+
+        if(mixed_blocks - this->retired_at_blocks.data[i] >= 2) {
+            free(clip->samples);
+            free(clip);
+            continue;
+        }
+
+        this->retired_clips.data[kept]     = clip;
+        this->retired_at_blocks.data[kept] = this->retired_at_blocks.data[i];
+        kept += 1;
+    }
+
+    this->retired_clips.count     = kept;
+    this->retired_at_blocks.count = kept;
+
+    kept = 0;
+
+    for_array(this->streams.data, this->streams.count) {
+        SoundStream * stream = *it;
+
+        if(!stream->decoding) {
+            if(stream->audio.released.load(std::memory_order_acquire)) {
+                free_sound_stream(stream);
+                for_array_continue;
+            }
+
+            int underruns = stream->audio.underruns.exchange(0, std::memory_order_relaxed);
+
+            if(underruns) {
+                char * c_name = to_c_string(stream->sound->name);
+                scope_exit(free(c_name));
+                log_print("update_streams", "\"%s\" ran dry %d times, decoding can't keep up", c_name, underruns);
+            }
+
+            if(stream->stopped) {
+                stream->audio.finished.store(true, std::memory_order_release);
+            } else if(!stream->audio.finished.load(std::memory_order_relaxed) && get_stream_space(&stream->audio) >= STREAM_CHUNK_FRAMES) {
+                stream->decoding = true;
+                add_job(decode_stream_job, finish_stream_job, stream);
+            }
+        }
+
+        this->streams.data[kept] = stream;
+        kept += 1;
+    }
+
+    this->streams.count = kept;
+
+    // @Speed Walks every sound every frame, like TextureManager::update_residency.
+    this->cpu_bytes = 0;
+
+    for_array(this->table.mask.data, this->table.mask.allocated) {
+        if(!*it) for_array_continue;
+
+        Sound * sound = this->table.values.data[it_index];
+        if(sound->clip) this->cpu_bytes += get_clip_size(sound->clip);
+    }
+
+    for_array(this->retired_clips.data, this->retired_clips.count) {
+        this->cpu_bytes += get_clip_size(*it);
+    }
+
+    for_array(this->streams.data, this->streams.count) {
+        this->cpu_bytes += (long long) (*it)->audio.ring_frames * (*it)->audio.num_channels * sizeof(float);
+        this->cpu_bytes += (long long) STREAM_CHUNK_FRAMES * (*it)->wav.num_channels * ((*it)->wav.bits_per_sample / 8);
+    }
+}
+
+// As much as fits in the ring, up to max_frames, going back to the start of the file for loops. Sets finished at the
+// end. Only ever runs for one stream at a time, whatever the thread.
+static void decode_stream(SoundStream * stream, int max_frames) {
+    while(max_frames > 0) {
+        if(stream->next_frame == stream->wav.num_frames) {
+            if(stream->loops == 0) {
+                stream->audio.finished.store(true, std::memory_order_release);
+                return;
+            }
+
+            if(stream->loops > 0) stream->loops -= 1;
+
+            stream->next_frame = 0;
+        }
+
+        int count;
+        float * destination = get_stream_write_pointer(&stream->audio, &count);
+
+        int left_in_file = stream->wav.num_frames - stream->next_frame;
+
+        if(count > max_frames)          count = max_frames;
+        if(count > left_in_file)        count = left_in_file;
+        if(count > STREAM_CHUNK_FRAMES) count = STREAM_CHUNK_FRAMES;
+
+        if(count == 0) return; // The ring is full.
+
+        int frame_size = stream->wav.num_channels * (stream->wav.bits_per_sample / 8);
+        long long offset = stream->wav.data_offset + (long long) stream->next_frame * frame_size;
+
+        int bytes_read = read_asset_file_range(&stream->file, offset, stream->chunk, count * frame_size);
+        bool got_shorter = bytes_read < count * frame_size; // Saved over while it plays, or it can't be read anymore.
+
+        if(got_shorter) count = bytes_read > 0 ? bytes_read / frame_size : 0;
+
+        decode_wav_frames(&stream->wav, stream->chunk, count, destination);
+        advance_stream_write(&stream->audio, count);
+
+        stream->next_frame += count;
+        max_frames         -= count;
+
+        if(got_shorter) {
+            // The hotloader stops it soon anyway, we end with whatever frames we got.
+            char * c_name = to_c_string(stream->sound->name);
+            scope_exit(free(c_name));
+            log_print("decode_stream", "\"%s\" got shorter while it played, stopping it", c_name);
+
+            stream->audio.finished.store(true, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+static void decode_stream_job(void * data) {
+    profile_zone("decode_stream");
+
+    SoundStream * stream = (SoundStream *) data;
+    decode_stream(stream, get_stream_space(&stream->audio));
+}
+
+static void finish_stream_job(void * data) {
+    SoundStream * stream = (SoundStream *) data;
+    stream->decoding = false;
+}
+
+static long long get_clip_size(AudioClip * clip) {
+    return (long long) clip->num_frames * clip->num_channels * sizeof(float);
+}
+
+static void free_sound_stream(SoundStream * stream) {
+    close_asset_file(&stream->file);
+    free(stream->chunk);
+    free_audio_stream(&stream->audio);
+    free(stream);
+}
+
+// Thread safe. The file is mapped and only the header is read, unless it's short enough that we decode it whole in a
+// clip, otherwise *clip is NULL and it streams.
+static bool read_sound_file(String full_path, WavInfo * wav, AudioClip ** clip) {
+    String file_data = map_asset_file(full_path);
+
+    if(!file_data.data) return false; // Should have already errored.
+
+    scope_exit(unmap_asset_file(file_data));
+
+    char * c_path = to_c_string(full_path);
+    scope_exit(free(c_path));
+
+    if(!parse_wav_header(c_path, file_data, wav)) return false;
+
+    *clip = NULL;
+
+    if(should_stream(wav)) return true;
+
+    AudioClip * new_clip = (AudioClip *) malloc(sizeof(AudioClip));
+    new_clip->num_frames   = wav->num_frames;
+    new_clip->num_channels = wav->num_channels;
+    new_clip->sample_rate  = wav->sample_rate;
+    new_clip->samples      = (float *) malloc(wav->num_frames * wav->num_channels * sizeof(float));
+
+    decode_wav_frames(wav, (unsigned char *) file_data.data + wav->data_offset, wav->num_frames, new_clip->samples);
+
+    *clip = new_clip;
+
+    return true;
+}
+
+// RIFF chunks, we need fmt and data, anything else is skipped.
+static bool parse_wav_header(char * c_path, String file_data, WavInfo * wav) {
+    unsigned char * data = (unsigned char *) file_data.data;
+    int size = file_data.count;
+
+    if(size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+        log_print("load_sound", "%s isn't a WAV file", c_path);
+        return false;
+    }
+
+    int format = -1;
+    int offset = 12;
+
+    while(offset + 8 <= size) {
+        unsigned int chunk_size = read_u32(data + offset + 4);
+
+        int body = offset + 8;
+        int left = size - body;
+
+        if(memcmp(data + offset, "fmt ", 4) == 0 && chunk_size >= 16 && left >= 16) {
+            format                = read_u16(data + body);
+            wav->num_channels     = read_u16(data + body + 2);
+            wav->sample_rate      = read_u32(data + body + 4);
+            wav->bits_per_sample  = read_u16(data + body + 14);
+
+            if(format == WAV_FORMAT_EXTENSIBLE && chunk_size >= 26 && left >= 26) format = read_u16(data + body + 24);
+        } else if(memcmp(data + offset, "data", 4) == 0) {
+            if(format < 0) {
+                log_print("load_sound", "%s has its samples before their format", c_path);
+                return false;
+            }
+
+            // Some writers leave the size of the last chunk wrong, we take what's there.
+            int data_size = chunk_size > (unsigned int) left ? left : (int) chunk_size;
+
+            wav->is_float    = format == WAV_FORMAT_FLOAT;
+            wav->data_offset = body;
+
+            bool pcm_ok   = format == WAV_FORMAT_PCM && (wav->bits_per_sample == 8 || wav->bits_per_sample == 16 || wav->bits_per_sample == 24 || wav->bits_per_sample == 32);
+            bool float_ok = format == WAV_FORMAT_FLOAT && wav->bits_per_sample == 32;
+
+            if(!pcm_ok && !float_ok) {
+                log_print("load_sound", "%s is in a format we don't play (format %d, %d bits), it has to be 8, 16, 24 or 32 bit PCM or 32 bit float", c_path, format, wav->bits_per_sample);
+                return false;
+            }
+
+            if(wav->num_channels < 1 || wav->num_channels > 2 || wav->sample_rate <= 0) {
+                log_print("load_sound", "%s has %d channels at %d Hz, we only play mono and stereo", c_path, wav->num_channels, wav->sample_rate);
+                return false;
+            }
+
+            wav->num_frames = data_size / (wav->num_channels * (wav->bits_per_sample / 8));
+
+            if(wav->num_frames == 0) {
+                log_print("load_sound", "%s has no samples", c_path);
+                return false;
+            }
+
+            return true;
+        }
+
+        if(chunk_size > (unsigned int) left) break;
+
+        offset = body + (int) chunk_size + (chunk_size & 1); // Chunks are padded to an even size.
+    }
+
+    log_print("load_sound", "%s has no samples, or its chunks are broken", c_path);
+    return false;
+}
+
+// To floats from -1 to 1, interleaved like they are in the file. Little endian, and the data isn't always aligned.
+static void decode_wav_frames(WavInfo * wav, unsigned char * source, int num_frames, float * destination) {
+    int num_samples = num_frames * wav->num_channels;
+
+    if(wav->is_float) {
+        memcpy(destination, source, num_samples * sizeof(float));
+        return;
+    }
+
+    switch(wav->bits_per_sample) {
+        case 8: { // Unsigned
+            for(int i = 0; i < num_samples; i++) {
+                destination[i] = (source[i] - 128) * (1.0f / 128.0f);
+            }
+        } break;
+
+        case 16: {
+            for(int i = 0; i < num_samples; i++) {
+                short sample = (short) read_u16(source + i * 2);
+                destination[i] = sample * (1.0f / 32768.0f);
+            }
+        } break;
+
+        case 24: {
+            for(int i = 0; i < num_samples; i++) {
+                unsigned char * bytes = source + i * 3;
+
+                int sample = (int) ((bytes[0] << 8) | (bytes[1] << 16) | ((unsigned int) bytes[2] << 24)) >> 8; // Sign extended
+                destination[i] = sample * (1.0f / 8388608.0f);
+            }
+        } break;
+
+        case 32: {
+            for(int i = 0; i < num_samples; i++) {
+                int sample = (int) read_u32(source + i * 4);
+                destination[i] = sample * (1.0f / 2147483648.0f);
+            }
+        } break;
+    }
+}
+
+static bool should_stream(WavInfo * wav) {
+    return wav->num_frames > STREAM_MIN_SECONDS * wav->sample_rate;
+}
+
+static unsigned int read_u16(unsigned char * data) {
+    return data[0] | (data[1] << 8);
+}
+
+static unsigned int read_u32(unsigned char * data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int) data[3] << 24);
+}
@@ -0,0 +1,68 @@
+#include "asset_manager.h"
+#include "audio_mixer.h"
+
+// Sounds come from WAV files. Short ones are decoded whole when they load and play as clips. Long ones, music and
+// ambience mostly, would cost tens of megabytes decoded: those are only parsed when they load, and every time one
+// plays it gets its own stream, read from the file and decoded a chunk at a time on the job system, a ring ahead of
+// the mixer.
+
+struct SoundStream;
+
+struct WavInfo {
+    int num_channels; // 1 or 2
+    int sample_rate;
+    int bits_per_sample; // 8, 16, 24 or 32
+    bool is_float;       // 32 bit floats instead of integers.
+
+    int data_offset; // In bytes, where the first frame is in the file.
+    int num_frames;
+};
+
+struct Sound : Asset {
+    bool loaded; // There's nothing to play until it is.
+
+    WavInfo wav;
+
+    // Sounds longer than STREAM_MIN_SECONDS stream. Others have their clip, decoded, NULL if they stream.
+    bool streamed;
+    AudioClip * clip;
+};
+
+const double STREAM_MIN_SECONDS = 10.0;
+
+const int STREAM_RING_FRAMES  = 65536; // Has to be a power of two. About 1.5 seconds at 44.1 kHz.
+const int STREAM_CHUNK_FRAMES = 16384; // We don't bother decoding less than that at a time.
+
+struct AudioManager : AssetManager_Poly<Sound> {
+    Array<SoundStream *> streams;
+
+    // Clips we replaced that voices could still be reading, with the block count they were stopped at.
+    Array<AudioClip *> retired_clips;
+    Array<unsigned int> retired_at_blocks;
+
+    // As of the last update_streams, decoded clips and stream rings, retired clips included.
+    long long cpu_bytes = 0;
+
+    void init();
+
+    void reload_or_create_asset(String file_path, String file_name);
+    void create_placeholder(String name, String path);
+
+    void load_asset(Asset * asset);
+
+    void * begin_async_load(Asset * asset);
+    void   do_async_load   (void * load);
+    void   end_async_load  (void * load);
+
+    // Same as play_clip, see audio_mixer.h. Sounds that stream play once more for every loop, from the file.
+    unsigned int play_sound(Sound * sound, float gain = 1.0f, float pan = 0.0f, int loops = 0, SoundCategory category = SOUND_CATEGORY_EFFECTS, int priority = 0);
+
+    // Once per frame. Kicks the decoding of streams running low, frees what the mixer is done with and counts
+    // cpu_bytes.
+    void update_streams();
+
+private:
+    void do_load_sound(Sound * sound);
+    void publish_sound(Sound * sound, WavInfo * wav, AudioClip * clip);
+    void retire_clip(AudioClip * clip);
+};
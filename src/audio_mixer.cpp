@@ -0,0 +1,655 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "audio_mixer.h"
+#include "spsc_queue.h"
+#include "macros.h"
+#include "math_m.h"
+
+// MIXER_NO_SIMD forces the plain C paths, to compare against them.
+#if !defined(MIXER_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define MIXER_SSE2
+#include <emmintrin.h>
+#endif
+
+enum AudioCommandType {
+    AUDIO_COMMAND_PLAY,
+    AUDIO_COMMAND_STOP,
+    AUDIO_COMMAND_SET_GAIN,
+    AUDIO_COMMAND_STOP_CLIP,
+};
+
+struct AudioCommand {
+    AudioCommandType type;
+
+    unsigned int voice;
+
+    // Play only, and clip for stop clip
+    AudioClip * clip;
+    AudioStream * stream;
+    int loops;
+    SoundCategory category;
+    int priority;
+
+    float gain;
+    float pan;
+};
+
+// Private functions
+static unsigned int push_play_command(AudioClip * clip, AudioStream * stream, float gain, float pan, int loops, SoundCategory category, int priority);
+
+static void apply_commands();
+static void start_voice(AudioCommand * command);
+static int  find_voice_to_steal(AudioCommand * command, bool whole_pool);
+static void remove_voice(int index);
+static Voice * find_voice(unsigned int id);
+static void fade_out_voice(Voice * voice);
+static void get_clip_gains(AudioClip * clip, float gain, float pan, float * left, float * right);
+
+static bool mix_voice(Voice * voice, float * left, float * right, int num_frames);
+static bool fill_stream_window(Voice * voice, int num_frames);
+static int  resample(Voice * voice, float * channel_0, float * channel_1, int num_frames);
+static void resample_span(AudioClip * clip, unsigned long long position, unsigned long long step, float * channel_0, float * channel_1, int num_frames);
+static void add_with_gain(float * destination, float * source, int num_frames, float gain, float gain_step);
+static void convert_to_int16(float * left, float * right, short * output, int num_frames);
+
+// Const
+const unsigned long long FIXED_ONE = 1ull << 32; // 1.0 in the 32.32 voice positions
+const float FIXED_TO_FLOAT = 1.0f / 4294967296.0f;
+
+// Globals
+static SPSCQueue<AudioCommand> commands; // The game pushes, the mixing thread pops.
+
+static unsigned int next_voice_id = 1; // Game thread
+
+// Mixing thread
+static Voice voices[MAX_VOICES]; // Only the ones playing, packed at the front.
+static int   num_voices;
+
+static int category_voice_counts[NUM_SOUND_CATEGORIES]; // Voices that are stopping don't count.
+
+static std::atomic<int> playing_voice_count;
+static std::atomic<unsigned int> mixed_block_count;
+
+static float mix_left [MIX_BLOCK_FRAMES];
+static float mix_right[MIX_BLOCK_FRAMES];
+
+void init_audio_mixer() {
+    num_voices = 0;
+    memset(category_voice_counts, 0, sizeof(category_voice_counts));
+
+    commands.init(AUDIO_COMMAND_QUEUE_SIZE);
+
+    playing_voice_count.store(0, std::memory_order_relaxed);
+    mixed_block_count.store(0, std::memory_order_relaxed);
+}
+
+// The id is ours to give, the voice only starts with the next block.
+unsigned int play_clip(AudioClip * clip, float gain, float pan, int loops, SoundCategory category, int priority) { // @Default gain = 1.0f, pan = 0.0f, loops = 0, category = SOUND_CATEGORY_EFFECTS, priority = 0
+    if(!clip || clip->num_frames <= 0) return NO_VOICE;
+
+    return push_play_command(clip, NULL, gain, pan, loops, category, priority);
+}
+
+// Doesn't set released if it can't play, the caller still has the stream then.
+unsigned int play_stream(AudioStream * stream, float gain, float pan, SoundCategory category, int priority) { // @Default gain = 1.0f, pan = 0.0f, category = SOUND_CATEGORY_MUSIC, priority = 0
+    if(stream->sample_rate > MIXER_OUTPUT_RATE * MAX_STREAM_RATE_RATIO) {
+        log_print("audio_mixer", "Can't stream at %d Hz, the most we resample from is %d Hz", stream->sample_rate, MIXER_OUTPUT_RATE * MAX_STREAM_RATE_RATIO);
+        return NO_VOICE;
+    }
+
+    // Looping is the decoder's business, it starts over in the file, the ring never ends.
+    return push_play_command(&stream->window_clip, stream, gain, pan, 0, category, priority);
+}
+
+static unsigned int push_play_command(AudioClip * clip, AudioStream * stream, float gain, float pan, int loops, SoundCategory category, int priority) {
+    AudioCommand command;
+    command.type     = AUDIO_COMMAND_PLAY;
+    command.voice    = next_voice_id;
+    command.clip     = clip;
+    command.stream   = stream;
+    command.loops    = loops;
+    command.category = category;
+    command.priority = priority;
+    command.gain     = gain;
+    command.pan      = pan;
+
+    if(!commands.push(command)) {
+        log_print("audio_mixer", "Too many audio commands this block, a sound won't play");
+        return NO_VOICE;
+    }
+
+    next_voice_id += 1;
+    if(next_voice_id == NO_VOICE) next_voice_id += 1;
+
+    return command.voice;
+}
+
+void stop_voice(unsigned int id) {
+    AudioCommand command = {};
+    command.type  = AUDIO_COMMAND_STOP;
+    command.voice = id;
+
+    if(!commands.push(command)) log_print("audio_mixer", "Too many audio commands this block, a sound won't stop");
+}
+
+void set_voice_gain(unsigned int id, float gain, float pan) { // @Default pan = 0.0f
+    AudioCommand command = {};
+    command.type  = AUDIO_COMMAND_SET_GAIN;
+    command.voice = id;
+    command.gain  = gain;
+    command.pan   = pan;
+
+    if(!commands.push(command)) log_print("audio_mixer", "Too many audio commands this block, dropped a gain change");
+}
+
+bool stop_clip(AudioClip * clip) {
+    AudioCommand command = {};
+    command.type = AUDIO_COMMAND_STOP_CLIP;
+    command.clip = clip;
+
+    return commands.push(command);
+}
+
+void init_audio_stream(AudioStream * stream, int num_channels, int sample_rate, int ring_frames) {
+    stream->num_channels = num_channels;
+    stream->sample_rate  = sample_rate;
+
+    stream->ring        = (float *) malloc(ring_frames * num_channels * sizeof(float));
+    stream->ring_frames = ring_frames;
+
+    stream->read_frame.store(0, std::memory_order_relaxed);
+    stream->write_frame.store(0, std::memory_order_relaxed);
+
+    stream->finished.store(false, std::memory_order_relaxed);
+    stream->released.store(false, std::memory_order_relaxed);
+    stream->underruns.store(0, std::memory_order_relaxed);
+
+    stream->window_clip.samples      = (float *) malloc(STREAM_WINDOW_FRAMES * num_channels * sizeof(float));
+    stream->window_clip.num_frames   = 0;
+    stream->window_clip.num_channels = num_channels;
+    stream->window_clip.sample_rate  = sample_rate;
+}
+
+void free_audio_stream(AudioStream * stream) {
+    free(stream->ring);
+    free(stream->window_clip.samples);
+
+    stream->ring                = NULL;
+    stream->window_clip.samples = NULL;
+}
+
+int get_stream_space(AudioStream * stream) {
+    unsigned int read  = stream->read_frame.load(std::memory_order_acquire);
+    unsigned int write = stream->write_frame.load(std::memory_order_relaxed);
+
+    return (int) (stream->ring_frames - (write - read));
+}
+
+float * get_stream_write_pointer(AudioStream * stream, int * contiguous_frames) {
+    unsigned int write = stream->write_frame.load(std::memory_order_relaxed);
+    unsigned int index = write & (stream->ring_frames - 1);
+
+    int until_wrap = (int) (stream->ring_frames - index);
+    int space      = get_stream_space(stream);
+
+    *contiguous_frames = space < until_wrap ? space : until_wrap;
+
+    return stream->ring + index * stream->num_channels;
+}
+
+void advance_stream_write(AudioStream * stream, int num_frames) {
+    unsigned int write = stream->write_frame.load(std::memory_order_relaxed);
+    stream->write_frame.store(write + num_frames, std::memory_order_release);
+}
+
+int get_playing_voice_count() {
+    return playing_voice_count.load(std::memory_order_relaxed);
+}
+
+unsigned int get_mixed_block_count() {
+    return mixed_block_count.load(std::memory_order_acquire);
+}
+
+void mix_audio(short * output, int num_frames) {
+    while(num_frames > 0) {
+        int block_frames = num_frames < MIX_BLOCK_FRAMES ? num_frames : MIX_BLOCK_FRAMES;
+
+        apply_commands();
+
+        memset(mix_left,  0, block_frames * sizeof(float));
+        memset(mix_right, 0, block_frames * sizeof(float));
+
+        // Backwards, removing swaps the last voice in.
+        for(int i = num_voices - 1; i >= 0; i--) {
+            Voice * voice = &voices[i];
+
+            bool still_playing = mix_voice(voice, mix_left, mix_right, block_frames);
+
+            if(!still_playing || voice->stopping) remove_voice(i);
+        }
+
+        convert_to_int16(mix_left, mix_right, output, block_frames);
+
+        playing_voice_count.store(num_voices, std::memory_order_relaxed);
+        mixed_block_count.fetch_add(1, std::memory_order_release);
+
+        output     += block_frames * MIXER_OUTPUT_CHANNELS;
+        num_frames -= block_frames;
+    }
+}
+
+static void apply_commands() {
+    AudioCommand command;
+
+    while(commands.pop(&command)) {
+        if(command.type == AUDIO_COMMAND_PLAY) {
+            start_voice(&command);
+            continue;
+        }
+
+        if(command.type == AUDIO_COMMAND_STOP_CLIP) {
+            for(int i = 0; i < num_voices; i++) {
+                if(voices[i].clip == command.clip && !voices[i].stopping) fade_out_voice(&voices[i]);
+            }
+            continue;
+        }
+
+        Voice * voice = find_voice(command.voice);
+        if(!voice || voice->stopping) continue; // Already done playing.
+
+        if(command.type == AUDIO_COMMAND_STOP) {
+            fade_out_voice(voice);
+        } else {
+            get_clip_gains(voice->clip, command.gain, command.pan, &voice->target_gain_left, &voice->target_gain_right);
+        }
+    }
+}
+
+static void start_voice(AudioCommand * command) {
+    AudioClip * clip = command->clip;
+
+    // Over the category's limit: the voice we take the place of fades out over the block, like a stop.
+    if(category_voice_counts[command->category] >= SOUND_CATEGORY_VOICE_LIMITS[command->category]) {
+        int stolen = find_voice_to_steal(command, false);
+
+        if(stolen < 0) { // Everything playing in the category is more important.
+            if(command->stream) command->stream->released.store(true, std::memory_order_release);
+            return;
+        }
+
+        fade_out_voice(&voices[stolen]);
+    }
+
+    // No room at all: this one goes right away, it'll click. Voices already stopping go first, they're fading anyway.
+    if(num_voices == MAX_VOICES) {
+        int stolen = find_voice_to_steal(command, true);
+
+        if(stolen < 0) {
+            if(command->stream) command->stream->released.store(true, std::memory_order_release);
+            return;
+        }
+
+        remove_voice(stolen);
+    }
+
+    Voice voice = {};
+    voice.id       = command->voice;
+    voice.clip     = clip;
+    voice.stream   = command->stream;
+    voice.category = command->category;
+    voice.priority = command->priority;
+    voice.position = 0;
+    voice.step     = ((unsigned long long) clip->sample_rate << 32) / MIXER_OUTPUT_RATE;
+    voice.loops    = command->loops;
+
+    get_clip_gains(clip, command->gain, command->pan, &voice.target_gain_left, &voice.target_gain_right);
+
+    // Starts at full volume, the clip is supposed to start on a zero crossing.
+    voice.gain_left  = voice.target_gain_left;
+    voice.gain_right = voice.target_gain_right;
+
+    voices[num_voices] = voice;
+    num_voices += 1;
+
+    category_voice_counts[voice.category] += 1;
+}
+
+// The least important voice that isn't more important than the new one, the oldest on ties. Only in its category
+// unless whole_pool, where voices that are stopping come first. -1 if there isn't one.
+static int find_voice_to_steal(AudioCommand * command, bool whole_pool) {
+    int best = -1;
+
+    for(int i = 0; i < num_voices; i++) {
+        Voice * voice = &voices[i];
+
+        if(whole_pool) {
+            if(voice->stopping) return i;
+        } else {
+            if(voice->stopping || voice->category != command->category) continue;
+        }
+
+        if(voice->priority > command->priority) continue;
+
+        if(best < 0 || voice->priority < voices[best].priority || (voice->priority == voices[best].priority && voice->id < voices[best].id)) {
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+// Swaps the last voice in.
+static void remove_voice(int index) {
+    Voice * voice = &voices[index];
+
+    if(!voice->stopping) category_voice_counts[voice->category] -= 1;
+
+    if(voice->stream) voice->stream->released.store(true, std::memory_order_release); // Last time we touch it.
+
+    num_voices -= 1;
+    voices[index] = voices[num_voices];
+}
+
+// @Speed linear, but there are never more than MAX_VOICES.
+static Voice * find_voice(unsigned int id) {
+    for(int i = 0; i < num_voices; i++) {
+        if(voices[i].id == id) return &voices[i];
+    }
+
+    return NULL;
+}
+
+// Over the next block, then it goes away. It stops counting towards its category right away.
+static void fade_out_voice(Voice * voice) {
+    voice->stopping          = true;
+    voice->target_gain_left  = 0.0f;
+    voice->target_gain_right = 0.0f;
+
+    category_voice_counts[voice->category] -= 1;
+}
+
+// Mono clips pan with equal power, stereo clips get balance: the far channel fades out, the near one stays.
+static void get_clip_gains(AudioClip * clip, float gain, float pan, float * left, float * right) {
+    if(pan < -1.0f) pan = -1.0f;
+    if(pan >  1.0f) pan =  1.0f;
+
+    if(clip->num_channels == 1) {
+        float angle = (pan + 1.0f) * (float) (TAU / 8);
+
+        *left  = gain * cosf(angle);
+        *right = gain * sinf(angle);
+    } else {
+        *left  = gain * (pan > 0.0f ? 1.0f - pan : 1.0f);
+        *right = gain * (pan < 0.0f ? 1.0f + pan : 1.0f);
+    }
+}
+
+// Adds num_frames of the voice to the mix. Returns false once the clip is done.
+static bool mix_voice(Voice * voice, float * left, float * right, int num_frames) {
+    float channel_0[MIX_BLOCK_FRAMES];
+    float channel_1[MIX_BLOCK_FRAMES];
+
+    if(voice->stream && !fill_stream_window(voice, num_frames)) {
+        // Nothing to play until the decoder catches up, we'll go on from the same spot then.
+        voice->gain_left  = voice->target_gain_left;
+        voice->gain_right = voice->target_gain_right;
+
+        return true;
+    }
+
+    int produced = resample(voice, channel_0, channel_1, num_frames);
+
+    float step_left  = (voice->target_gain_left  - voice->gain_left)  / num_frames;
+    float step_right = (voice->target_gain_right - voice->gain_right) / num_frames;
+
+    float * source_right = voice->clip->num_channels == 1 ? channel_0 : channel_1;
+
+    add_with_gain(left,  channel_0,    produced, voice->gain_left,  step_left);
+    add_with_gain(right, source_right, produced, voice->gain_right, step_right);
+
+    voice->gain_left  = voice->target_gain_left;
+    voice->gain_right = voice->target_gain_right;
+
+    return produced == num_frames;
+}
+
+// Drops the frames of the window the voice is past, and moves in from the ring the ones the next num_frames need.
+// Returns false if the decoder hasn't written them yet. Once the stream is finished, the window ends where the stream
+// does, resample sees it as the end of a clip.
+static bool fill_stream_window(Voice * voice, int num_frames) {
+    AudioStream * stream = voice->stream;
+    AudioClip * window   = &stream->window_clip;
+
+    int num_channels = stream->num_channels;
+
+    int consumed = (int) (voice->position >> 32);
+    if(consumed > window->num_frames) consumed = window->num_frames;
+
+    window->num_frames -= consumed;
+    voice->position    -= (unsigned long long) consumed << 32;
+
+    memmove(window->samples, window->samples + consumed * num_channels, window->num_frames * num_channels * sizeof(float));
+
+    // The last frame we interpolate towards, plus one.
+    int needed = (int) ((voice->position + num_frames * voice->step) >> 32) + 2;
+    if(window->num_frames >= needed) return true;
+
+    // finished first: if it's set, write_frame is already the last one.
+    bool finished = stream->finished.load(std::memory_order_acquire);
+
+    unsigned int read  = stream->read_frame.load(std::memory_order_relaxed);
+    unsigned int write = stream->write_frame.load(std::memory_order_acquire);
+
+    int available = (int) (write - read);
+    int count     = needed - window->num_frames;
+    if(count > available) count = available;
+
+    // In up to two pieces, the ring wraps around.
+    unsigned int mask = stream->ring_frames - 1;
+
+    for(int copied = 0; copied < count;) {
+        unsigned int index = (read + copied) & mask;
+
+        int piece = count - copied;
+        if(piece > (int) (stream->ring_frames - index)) piece = (int) (stream->ring_frames - index);
+
+        memcpy(window->samples + (window->num_frames + copied) * num_channels, stream->ring + index * num_channels, piece * num_channels * sizeof(float));
+
+        copied += piece;
+    }
+
+    window->num_frames += count;
+    stream->read_frame.store(read + count, std::memory_order_release);
+
+    if(window->num_frames >= needed || finished) return true;
+
+    stream->underruns.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+// The clip's channels at the output rate, linearly interpolated. Returns how many frames it made, fewer than
+// num_frames if the clip ended.
+static int resample(Voice * voice, float * channel_0, float * channel_1, int num_frames) {
+    AudioClip * clip = voice->clip;
+
+    unsigned long long end       = (unsigned long long) clip->num_frames << 32;
+    unsigned long long last_safe = (unsigned long long) (clip->num_frames - 1) << 32; // Before it, both frames we interpolate are in the clip.
+
+    int produced = 0;
+
+    while(produced < num_frames) {
+        if(voice->position >= end) {
+            if(voice->loops == 0) break;
+            if(voice->loops > 0) voice->loops -= 1;
+
+            voice->position -= end;
+            continue;
+        }
+
+        if(voice->position < last_safe) {
+            unsigned long long safe = (last_safe - voice->position + voice->step - 1) / voice->step;
+
+            int count = num_frames - produced;
+            if(safe < (unsigned long long) count) count = (int) safe;
+
+            resample_span(clip, voice->position, voice->step, channel_0 + produced, channel_1 + produced, count);
+
+            voice->position += count * voice->step;
+            produced        += count;
+            continue;
+        }
+
+        // On the last frame: towards the first one if we loop, towards silence if we don't.
+        int index   = (int) (voice->position >> 32);
+        float t     = (voice->position & 0xffffffff) * FIXED_TO_FLOAT;
+        bool wraps  = voice->loops != 0;
+
+        for(int channel = 0; channel < clip->num_channels; channel++) {
+            float a = clip->samples[index * clip->num_channels + channel];
+            float b = wraps ? clip->samples[channel] : 0.0f;
+
+            float * destination = channel == 0 ? channel_0 : channel_1;
+            destination[produced] = a + (b - a) * t;
+        }
+
+        voice->position += voice->step;
+        produced        += 1;
+    }
+
+    return produced;
+}
+
+// Every frame we interpolate from here has its next frame in the clip too.
+static void resample_span(AudioClip * clip, unsigned long long position, unsigned long long step, float * channel_0, float * channel_1, int num_frames) {
+    float * samples  = clip->samples;
+    int num_channels = clip->num_channels;
+
+    // Same rate, on a frame: nothing to interpolate.
+    if(step == FIXED_ONE && (position & 0xffffffff) == 0) {
+        int first = (int) (position >> 32);
+
+        if(num_channels == 1) {
+            memcpy(channel_0, samples + first, num_frames * sizeof(float));
+        } else {
+            for(int i = 0; i < num_frames; i++) {
+                channel_0[i] = samples[(first + i) * 2];
+                channel_1[i] = samples[(first + i) * 2 + 1];
+            }
+        }
+
+        return;
+    }
+
+    int i = 0;
+
+#ifdef MIXER_SSE2
+    // The loads are scattered, we gather them by hand and interpolate four frames at a time.
+    for(; i + 4 <= num_frames; i += 4) {
+        float a_0[4], b_0[4], a_1[4], b_1[4], t[4];
+
+        for(int k = 0; k < 4; k++) {
+            unsigned long long frame_position = position + (i + k) * step;
+
+            int index = (int) (frame_position >> 32) * num_channels;
+            t[k] = (frame_position & 0xffffffff) * FIXED_TO_FLOAT;
+
+            a_0[k] = samples[index];
+            b_0[k] = samples[index + num_channels];
+
+            if(num_channels == 2) {
+                a_1[k] = samples[index + 1];
+                b_1[k] = samples[index + 3];
+            }
+        }
+
+        __m128 factor = _mm_loadu_ps(t);
+
+        __m128 a = _mm_loadu_ps(a_0);
+        __m128 b = _mm_loadu_ps(b_0);
+        _mm_storeu_ps(channel_0 + i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), factor)));
+
+        if(num_channels == 2) {
+            a = _mm_loadu_ps(a_1);
+            b = _mm_loadu_ps(b_1);
+            _mm_storeu_ps(channel_1 + i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), factor)));
+        }
+    }
+#endif
+
+    for(; i < num_frames; i++) {
+        unsigned long long frame_position = position + i * step;
+
+        int index = (int) (frame_position >> 32) * num_channels;
+        float t   = (frame_position & 0xffffffff) * FIXED_TO_FLOAT;
+
+        channel_0[i] = samples[index] + (samples[index + num_channels] - samples[index]) * t;
+
+        if(num_channels == 2) {
+            channel_1[i] = samples[index + 1] + (samples[index + 3] - samples[index + 1]) * t;
+        }
+    }
+}
+
+// destination += source * gain, with the gain moving by gain_step every frame.
+static void add_with_gain(float * destination, float * source, int num_frames, float gain, float gain_step) {
+    int i = 0;
+
+#ifdef MIXER_SSE2
+    // Each lane is gain + i * gain_step like the loop below, not a running sum, so both paths give the same samples.
+    __m128 start   = _mm_set1_ps(gain);
+    __m128 step    = _mm_set1_ps(gain_step);
+    __m128 indices = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    __m128 four    = _mm_set1_ps(4.0f);
+
+    for(; i + 4 <= num_frames; i += 4) {
+        __m128 gains = _mm_add_ps(start, _mm_mul_ps(indices, step));
+        __m128 mixed = _mm_add_ps(_mm_loadu_ps(destination + i), _mm_mul_ps(_mm_loadu_ps(source + i), gains));
+        _mm_storeu_ps(destination + i, mixed);
+
+        indices = _mm_add_ps(indices, four);
+    }
+#endif
+
+    for(; i < num_frames; i++) {
+        destination[i] += source[i] * (gain + i * gain_step);
+    }
+}
+
+// Clamped to -1, 1 then scaled, interleaved left right.
+static void convert_to_int16(float * left, float * right, short * output, int num_frames) {
+    int i = 0;
+
+#ifdef MIXER_SSE2
+    __m128 minimum = _mm_set1_ps(-1.0f);
+    __m128 maximum = _mm_set1_ps( 1.0f);
+    __m128 scale   = _mm_set1_ps(32767.0f);
+
+    for(; i + 4 <= num_frames; i += 4) {
+        __m128 l = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(left  + i), minimum), maximum), scale);
+        __m128 r = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(right + i), minimum), maximum), scale);
+
+        __m128i l_int = _mm_cvtps_epi32(l);
+        __m128i r_int = _mm_cvtps_epi32(r);
+
+        // l0 r0 l1 r1 and l2 r2 l3 r3, packed with saturation.
+        __m128i first  = _mm_unpacklo_epi32(l_int, r_int);
+        __m128i second = _mm_unpackhi_epi32(l_int, r_int);
+
+        _mm_storeu_si128((__m128i *) (output + i * 2), _mm_packs_epi32(first, second));
+    }
+#endif
+
+    for(; i < num_frames; i++) {
+        float l = left[i];
+        float r = right[i];
+
+        if(l < -1.0f) l = -1.0f;
+        if(l >  1.0f) l =  1.0f;
+        if(r < -1.0f) r = -1.0f;
+        if(r >  1.0f) r =  1.0f;
+
+        output[i * 2]     = (short) lrintf(l * 32767.0f);
+        output[i * 2 + 1] = (short) lrintf(r * 32767.0f);
+    }
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+
+// Platform independent mixer. Voices play clips, resampled to MIXER_OUTPUT_RATE, panned and mixed as float stereo in
+// blocks of MIX_BLOCK_FRAMES, with SSE2 where we have it. The platform backend asks mix_audio for 16 bit stereo
+// whenever its device wants more, from its own mixing thread.
+//
+// The game talks to the voices through a lock-free queue of commands that mix_audio applies before every block, so
+// neither side ever waits on the other. play_clip, stop_voice and set_voice_gain are for one thread only, the game's.
+//
+// There are never more than MAX_VOICES voices, and never more than its limit in a category, so the cost of a block is
+// bounded however many sounds get triggered. A voice that doesn't fit takes the place of the least important one, the
+// first to have started if there's a tie, if that one isn't more important than it.
+//
+// Sounds too long to keep decoded play from an AudioStream instead of a clip: a ring of samples that something else
+// decodes ahead of the mixer, see audio_manager.h.
+
+enum SoundCategory {
+    SOUND_CATEGORY_EFFECTS,
+    SOUND_CATEGORY_UI,
+    SOUND_CATEGORY_AMBIENCE,
+    SOUND_CATEGORY_MUSIC,
+
+    NUM_SOUND_CATEGORIES,
+};
+
+// Samples the clips play, the mixer doesn't own them.
+struct AudioClip {
+    float * samples;  // Interleaved if stereo, -1 to 1.
+    int num_frames;   // A frame is one sample per channel.
+    int num_channels; // 1 or 2
+    int sample_rate;
+};
+
+// One thread writes, the decoder, and one reads, the mixer. Both counters run freely and wrap around.
+struct AudioStream {
+    int num_channels; // 1 or 2
+    int sample_rate;
+
+    float * ring;             // Interleaved, ring_frames frames.
+    unsigned int ring_frames; // Has to be a power of two.
+
+    std::atomic<unsigned int> read_frame;  // Only the mixer writes it.
+    std::atomic<unsigned int> write_frame; // Only the decoder writes it.
+
+    std::atomic<bool> finished; // The decoder wrote the last frame, set after write_frame.
+    std::atomic<bool> released; // The mixer is done with it for good, it can be freed once nobody decodes into it.
+    std::atomic<int>  underruns; // Blocks the mixer had to leave silent because the decoder was behind.
+
+    // Mixer only. The frames the voice resamples from, moved out of the ring so they're contiguous, window_clip
+    // points at them.
+    AudioClip window_clip;
+};
+
+struct Voice {
+    unsigned int id;
+
+    AudioClip * clip;
+    AudioStream * stream; // NULL unless it plays a stream, then clip is its window_clip.
+
+    SoundCategory category;
+    int priority; // Higher is more important.
+
+    unsigned long long position; // In frames of the clip, 32.32 fixed point.
+    unsigned long long step;     // How much position moves per output frame.
+
+    int loops; // Times it plays again after this one, LOOP_FOREVER to never stop.
+
+    // Per channel gains we ramp from, over a block, and to, so changes don't click.
+    float gain_left;
+    float gain_right;
+    float target_gain_left;
+    float target_gain_right;
+
+    bool stopping; // Fades out over the next block, then goes away.
+};
+
+const int MIXER_OUTPUT_RATE     = 44100;
+const int MIXER_OUTPUT_CHANNELS = 2;
+
+const int MIX_BLOCK_FRAMES = 256; // Gain changes ramp over one block.
+
+const int LOOP_FOREVER = -1;
+
+const unsigned int NO_VOICE = 0;
+
+const int MAX_VOICES = 64;
+
+// How many voices each category can have at once, in SoundCategory order.
+const int SOUND_CATEGORY_VOICE_LIMITS[NUM_SOUND_CATEGORIES] = {
+    48, // Effects
+    8,  // UI
+    8,  // Ambience
+    2,  // Music, room for a crossfade
+};
+
+const int MAX_STREAM_RATE_RATIO = 8; // Streams can't be more than this many times MIXER_OUTPUT_RATE.
+const int STREAM_WINDOW_FRAMES  = MIX_BLOCK_FRAMES * MAX_STREAM_RATE_RATIO + 4; // Enough for any block.
+
+const int AUDIO_COMMAND_QUEUE_SIZE = 256; // Has to be a power of two. Commands past that in one block are dropped.
+
+void init_audio_mixer();
+
+// gain is linear, pan goes from -1 (left) to 1 (right), equal power. Returns NO_VOICE if it can't play. It can also
+// not get a voice when the mixer gets to it, or lose it to a more important sound later, that's as if it had stopped.
+unsigned int play_clip(AudioClip * clip, float gain = 1.0f, float pan = 0.0f, int loops = 0, SoundCategory category = SOUND_CATEGORY_EFFECTS, int priority = 0);
+void stop_voice(unsigned int voice);
+void set_voice_gain(unsigned int voice, float gain, float pan = 0.0f);
+
+// Every voice playing the clip, like stop_voice. The clip can be freed once get_mixed_block_count moved by 2 since.
+// Returns false if the command queue is full, the clip is still in use then.
+bool stop_clip(AudioClip * clip);
+
+// Streams play until the decoder says they're finished and the mixer caught up, or until they're stopped. Either
+// way, or if the voice never starts, the mixer sets released when it lets go of the stream.
+unsigned int play_stream(AudioStream * stream, float gain = 1.0f, float pan = 0.0f, SoundCategory category = SOUND_CATEGORY_MUSIC, int priority = 0);
+
+void init_audio_stream(AudioStream * stream, int num_channels, int sample_rate, int ring_frames);
+void free_audio_stream(AudioStream * stream);
+
+// Decoder side. How many frames fit in the ring, where the next one goes along with how many fit there before the
+// ring wraps around, and handing the ones written there to the mixer.
+int     get_stream_space(AudioStream * stream);
+float * get_stream_write_pointer(AudioStream * stream, int * contiguous_frames);
+void    advance_stream_write(AudioStream * stream, int num_frames);
+
+int get_playing_voice_count(); // As of the last block we mixed.
+unsigned int get_mixed_block_count(); // Wraps around.
+
+// Interleaved stereo, any number of frames, mixed a block at a time.
+void mix_audio(short * output, int num_frames);
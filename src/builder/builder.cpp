@@ -1,17 +1,53 @@
-#include <windows.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#ifdef LINUX
+#include <dirent.h>
+#include <sys/stat.h>
+#define PLATFORM "LINUX"
+#else
+#include <windows.h>
 #define PLATFORM "WINDOWS"
+#endif
+
+#include "builder/builder.h"
+#include "pack_file.h"
+#include "hash.h"
 
 #define B2S(arg) (arg? "TRUE":"FALSE")
 
+// A file going into the pack
+struct PackSource {
+    char * path;
+    String data;
+
+    PackEntry entry;
+};
+
+// Private functions
+static bool run_command(char * format, ...);
+static bool write_pack(char * directory, char * pack_path);
+static int  compare_pack_sources(const void * a, const void * b);
+
+// Const
+// Source files that stay out of the pack and the cooked directory, nothing reads them at runtime.
+static char * SOURCE_ONLY_EXTENSIONS[] = { "psd", "tmp", "txt" };
+
 int main(int argc, char * argv[]) {
 
     bool is_release_build = false;
     bool is_min_build     = true;
     bool do_dlls          = false;
     bool do_cleanup       = false;
+    bool do_pack          = false;
+    bool do_cook          = false;
+    bool do_tools         = false;
+
+    CookOptions cook_options;
+    cook_options.compress_textures = true;
+    cook_options.compression       = COMPRESSION_HIGH;
 
     for(int i = 0; i < argc; i++) {
         if(strcmp(argv[i], "/full") == 0) {
@@ -28,6 +64,34 @@ int main(int argc, char * argv[]) {
             is_release_build = true;
             is_min_build     = false; // That one happens anyway
             do_dlls          = true; // For release builds, we force to rebuild dlls
+            do_cook          = true; // and we ship cooked assets
+            do_pack          = true; // in a pack instead of the data directory
+            continue;
+        }
+
+        if(strcmp(argv[i], "/cook") == 0) {
+            do_cook = true;
+            continue;
+        }
+
+        if(strcmp(argv[i], "/fast_cook") == 0) {
+            do_cook = true;
+            cook_options.compression = COMPRESSION_FAST;
+            continue;
+        }
+
+        if(strcmp(argv[i], "/no_compression") == 0) {
+            cook_options.compress_textures = false;
+            continue;
+        }
+
+        if(strcmp(argv[i], "/pack") == 0) {
+            do_pack = true;
+            continue;
+        }
+
+        if(strcmp(argv[i], "/tools") == 0) {
+            do_tools = true;
             continue;
         }
 
@@ -39,7 +103,17 @@ int main(int argc, char * argv[]) {
 
     char flags[1024];
 
-    sprintf(flags, "%s %s /D %s /nologo /Zi /EHsc /I ../src", (is_min_build ? "/Gm":""), (is_release_build ? "/Ox /GL /Gw":"/Od"), PLATFORM);
+#ifdef LINUX
+    // No incremental builds with gcc, is_min_build is ignored. Debug builds have the profiler's zones, see profiler.h.
+    int flags_length = snprintf(flags, sizeof(flags), "%s -D %s -g -I ../src -Wno-write-strings", (is_release_build ? "-O2":"-O0 -D PERF_MON"), PLATFORM);
+#else
+    int flags_length = snprintf(flags, sizeof(flags), "%s %s /D %s /nologo /Zi /EHsc /I ../src", (is_min_build ? "/Gm":""), (is_release_build ? "/Ox /GL /Gw":"/Od /D PERF_MON"), PLATFORM);
+#endif
+
+    if(flags_length < 0 || flags_length >= (int) sizeof(flags)) {
+        printf("Compiler flags don't fit in %d bytes\n", (int) sizeof(flags));
+        return 1;
+    }
 
     printf("\n=================== Game3 Build System ===================\n\n");
 
@@ -47,25 +121,32 @@ int main(int argc, char * argv[]) {
     printf("Incremental::%s\n", B2S(is_min_build));
     printf("DLLs:::::::::%s\n", B2S(do_dlls));
     printf("Cleanup::::::%s\n", B2S(do_cleanup));
+    printf("Cook:::::::::%s\n", B2S(do_cook));
+    printf("Compression::%s\n", !cook_options.compress_textures ? "NONE" : (cook_options.compression == COMPRESSION_FAST) ? "FAST" : "HIGH");
+    printf("Pack:::::::::%s\n", B2S(do_pack));
+    printf("Tools::::::::%s\n", B2S(do_tools));
 
     printf("\n\n");
 
     if(do_dlls) {
         printf("--------------------- Compiling DLLs ---------------------\n");
+#ifdef LINUX
+        // null_renderer, headless builds have no GPU to talk to.
+        {
+            run_command("g++ -shared -fPIC %s -o null_renderer.so \
+                ../src/null_renderer.cpp", flags);
+        }
+#else
         // d3d_renderer
         {
-
-            char command[2048];
-            sprintf(command, "cl /LD %s /Fed3d_renderer ^ \
+            run_command("cl /LD %s /Fed3d_renderer ^ \
                 ../src/d3d_renderer.cpp         ^ \
-                ../src/asset_manager.cpp        ^ \
                 ../src/hash.cpp                 ^ \
                 ../src/parsing.cpp              ^ \
                 ../src/os/win32/file_loader.cpp ^ \
                 /link D3Dcompiler.lib d3d11.lib", flags);
-
-            system(command);
         }
+#endif
 
         printf("--------------------- DLLs Compiled ----------------------\n");
     }
@@ -76,15 +157,56 @@ int main(int argc, char * argv[]) {
     {
         printf("------------------ Compiling Main files ------------------\n");
 
-        char command[2048];
-        sprintf(command, "cl %s /Fewin32_game ^ \
+#ifdef LINUX
+        run_command("g++ %s -o linux_game \
+        ../src/game_main.cpp             \
+        ../src/renderer.cpp              \
+        ../src/asset_manager.cpp         \
+        ../src/job_system.cpp            \
+        ../src/pack_file.cpp             \
+        ../src/texture_manager.cpp       \
+        ../src/mip_maps.cpp              \
+        ../src/texture_compression.cpp   \
+        ../src/shader_manager.cpp        \
+        ../src/font_manager.cpp          \
+        ../src/glyph_cache.cpp           \
+        ../src/text_layout.cpp           \
+        ../src/audio_mixer.cpp           \
+        ../src/audio_manager.cpp         \
+        ../src/null_audio.cpp            \
+        ../src/profiler.cpp              \
+        ../src/room_manager.cpp          \
+        ../src/room_format.cpp           \
+        ../src/hotloader.cpp             \
+        ../src/hash.cpp                  \
+        ../src/parsing.cpp               \
+        ../src/math_m.cpp                \
+        ../src/os/linux/core.cpp         \
+        ../src/os/linux/hotloader.cpp    \
+        ../src/os/linux/file_loader.cpp  \
+        ../src/os/linux/sound_player.cpp \
+        -ldl -lpthread", flags);
+#else
+        run_command("cl %s /Fewin32_game ^ \
         ../src/game_main.cpp             ^ \
         ../src/renderer.cpp              ^ \
         ../src/asset_manager.cpp         ^ \
+        ../src/job_system.cpp            ^ \
+        ../src/pack_file.cpp             ^ \
         ../src/texture_manager.cpp       ^ \
+        ../src/mip_maps.cpp              ^ \
+        ../src/texture_compression.cpp   ^ \
         ../src/shader_manager.cpp        ^ \
         ../src/font_manager.cpp          ^ \
+        ../src/glyph_cache.cpp           ^ \
+        ../src/text_layout.cpp           ^ \
+        ../src/audio_mixer.cpp           ^ \
+        ../src/audio_manager.cpp         ^ \
+        ../src/null_audio.cpp            ^ \
+        ../src/profiler.cpp              ^ \
         ../src/room_manager.cpp          ^ \
+        ../src/room_format.cpp           ^ \
+        ../src/hotloader.cpp             ^ \
         ../src/hash.cpp                  ^ \
         ../src/parsing.cpp               ^ \
         ../src/math_m.cpp                ^ \
@@ -93,8 +215,7 @@ int main(int argc, char * argv[]) {
         ../src/os/win32/file_loader.cpp  ^ \
         ../src/os/win32/sound_player.cpp ^ \
         /link user32.lib dsound.lib dxguid.lib", flags);
-
-        system(command);
+#endif
 
         printf("------------------ Main files Compiled -------------------\n");
     }
@@ -102,8 +223,347 @@ int main(int argc, char * argv[]) {
 
     printf("__________________________________________________________\n\n");
 
+    if(do_tools) {
+        printf("--------------------- Compiling tools --------------------\n");
+
+        // audio_benchmark, always optimized, it's there to measure.
+        {
+#ifdef LINUX
+            run_command("g++ %s -O2 -o audio_benchmark \
+                ../src/tools/audio_benchmark.cpp \
+                ../src/audio_mixer.cpp           \
+                ../src/hash.cpp                  \
+                ../src/math_m.cpp                \
+                ../src/os/linux/core.cpp         \
+                -ldl -lpthread", flags);
+#else
+            run_command("cl %s /O2 /Feaudio_benchmark ^ \
+                ../src/tools/audio_benchmark.cpp ^ \
+                ../src/audio_mixer.cpp           ^ \
+                ../src/hash.cpp                  ^ \
+                ../src/math_m.cpp                ^ \
+                ../src/os/win32/core.cpp         ^ \
+                /link user32.lib", flags);
+#endif
+        }
+
+        // audio_render, same, and what it prints is what we compare between runs.
+        {
+#ifdef LINUX
+            run_command("g++ %s -O2 -o audio_render \
+                ../src/tools/audio_render.cpp       \
+                ../src/null_audio.cpp               \
+                ../src/audio_mixer.cpp              \
+                ../src/audio_manager.cpp            \
+                ../src/asset_manager.cpp            \
+                ../src/job_system.cpp               \
+                ../src/profiler.cpp                 \
+                ../src/pack_file.cpp                \
+                ../src/parsing.cpp                  \
+                ../src/hash.cpp                     \
+                ../src/math_m.cpp                   \
+                ../src/os/linux/core.cpp            \
+                ../src/os/linux/file_loader.cpp     \
+                -ldl -lpthread", flags);
+#else
+            run_command("cl %s /O2 /Feaudio_render ^ \
+                ../src/tools/audio_render.cpp       ^ \
+                ../src/null_audio.cpp               ^ \
+                ../src/audio_mixer.cpp              ^ \
+                ../src/audio_manager.cpp            ^ \
+                ../src/asset_manager.cpp            ^ \
+                ../src/job_system.cpp               ^ \
+                ../src/profiler.cpp                 ^ \
+                ../src/pack_file.cpp                ^ \
+                ../src/parsing.cpp                  ^ \
+                ../src/hash.cpp                     ^ \
+                ../src/math_m.cpp                   ^ \
+                ../src/os/win32/core.cpp            ^ \
+                ../src/os/win32/file_loader.cpp     ^ \
+                /link user32.lib", flags);
+#endif
+        }
+
+        printf("--------------------- Tools compiled ---------------------\n");
+        printf("__________________________________________________________\n\n");
+    }
+
+    if(do_cook) {
+        printf("--------------------- Cooking data -----------------------\n");
+
+        if(!cook_directory("data", "cooked", cook_options)) {
+            printf("Failed to cook the data directory\n");
+        }
+
+        printf("--------------------- Data cooked ------------------------\n");
+        printf("__________________________________________________________\n\n");
+    }
+
+    if(do_pack) {
+        printf("--------------------- Packing data -----------------------\n");
+
+        // The pack takes whatever we cooked if we did, the game doesn't care either way.
+        char * pack_source = (char *) (do_cook ? "cooked" : "data");
+        if(!write_pack(pack_source, "data.pack")) {
+            printf("Failed to write data.pack\n");
+        }
+
+        printf("--------------------- Data packed ------------------------\n");
+        printf("__________________________________________________________\n\n");
+    }
+
     if(do_cleanup) {
+#ifdef LINUX
+        system("rm -f *.o");
+#else
         system("del *.obj *.pdb *.ilk *.exp *.lib *.idb");
+#endif
         printf("All cleaned up!");
     }
 }
+
+// Formats the command into a buffer sized for it, the file lists only ever grow.
+static bool run_command(char * format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if(length < 0) {
+        printf("Failed to format command: %s\n", format);
+        return false;
+    }
+
+    char * command = (char *) malloc(length + 1);
+
+    va_start(args, format);
+    vsnprintf(command, length + 1, format, args);
+    va_end(args);
+
+    int result = system(command);
+    free(command);
+
+    return result == 0;
+}
+
+static bool write_pack(char * directory, char * pack_path) {
+    Array<char *> files;
+    list_files(directory, &files);
+
+    Array<PackSource> sources;
+
+    unsigned int names_size = 0;
+
+    for_array(files.data, files.count) {
+        if(is_source_only_file(*it) || strcmp(*it + strlen(directory), COOK_MANIFEST_NAME) == 0) {
+            free(*it);
+            for_array_continue;
+        }
+
+        PackSource source;
+        source.path = *it;
+
+        if(!read_whole_file(source.path, &source.data)) {
+            printf("Could not read %s\n", source.path);
+            free(*it);
+            for_array_continue;
+        }
+
+        // Names are what the game would have found in the data directory, whichever one we packed.
+        char name_buffer[256];
+        snprintf(name_buffer, 256, "data%s", source.path + strlen(directory));
+
+        String name = to_string(name_buffer);
+
+        source.entry.name_hash    = get_pack_name_hash(name);
+        source.entry.size         = source.data.count;
+        source.entry.content_hash = murmur_hash_64a(source.data.data, source.data.count, 0);
+        source.entry.name_offset  = names_size;
+        source.entry.name_length  = name.count;
+
+        names_size += name.count;
+
+        sources.add(source);
+    }
+
+    files.reset(true);
+
+    // The game does a binary search on the name hashes.
+    qsort(sources.data, sources.count, sizeof(PackSource), compare_pack_sources);
+
+    unsigned long long offset = sizeof(PackHeader) + sources.count * sizeof(PackEntry) + names_size;
+
+    for_array(sources.data, sources.count) {
+        offset = (offset + PACK_DATA_ALIGNMENT - 1) & ~((unsigned long long) PACK_DATA_ALIGNMENT - 1);
+
+        it->entry.offset = offset;
+        offset += it->entry.size;
+    }
+
+    FILE * pack = fopen(pack_path, "wb");
+
+    if(!pack) return false;
+
+    PackHeader header;
+    header.magic       = PACK_MAGIC;
+    header.version     = PACK_VERSION;
+    header.num_entries = sources.count;
+    header.names_size  = names_size;
+
+    fwrite(&header, sizeof(header), 1, pack);
+
+    for_array(sources.data, sources.count) {
+        fwrite(&it->entry, sizeof(PackEntry), 1, pack);
+    }
+
+    // Names were given offsets before sorting, write them back in that order.
+    char * names = (char *) malloc(names_size);
+    for_array(sources.data, sources.count) {
+        char name_buffer[256];
+        snprintf(name_buffer, 256, "data%s", it->path + strlen(directory));
+
+        memcpy(names + it->entry.name_offset, name_buffer, it->entry.name_length);
+    }
+    fwrite(names, 1, names_size, pack);
+    free(names);
+
+    static char padding[PACK_DATA_ALIGNMENT];
+
+    for_array(sources.data, sources.count) {
+        long position = ftell(pack);
+        fwrite(padding, 1, it->entry.offset - position, pack);
+
+        fwrite(it->data.data, 1, it->data.count, pack);
+
+        free(it->data.data);
+        free(it->path);
+    }
+
+    bool success = (ferror(pack) == 0);
+
+    fclose(pack);
+
+    printf("Packed %d files, %llu bytes\n", sources.count, offset);
+
+    sources.reset(true);
+
+    return success;
+}
+
+bool is_source_only_file(char * path) {
+    char * extension = strrchr(path, '.');
+
+    if(!extension) return true; // Not an asset
+
+    for(int i = 0; i < array_size(SOURCE_ONLY_EXTENSIONS); i++) {
+        if(strcmp(extension + 1, SOURCE_ONLY_EXTENSIONS[i]) == 0) return true;
+    }
+
+    return false;
+}
+
+// Paths are made of forward slashes on every platform, the game looks them up that way.
+void list_files(char * directory, Array<char *> * files) {
+#ifdef LINUX
+    DIR * handle = opendir(directory);
+
+    if(!handle) return;
+
+    while(struct dirent * entry = readdir(handle)) {
+        if((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0)) continue;
+
+        char path[256];
+        snprintf(path, 256, "%s/%s", directory, entry->d_name);
+
+        struct stat file_info;
+        if(stat(path, &file_info) != 0) continue;
+
+        if(S_ISDIR(file_info.st_mode)) {
+            list_files(path, files);
+        } else {
+            files->add(strdup(path));
+        }
+    }
+
+    closedir(handle);
+#else
+    char search_path[256];
+    snprintf(search_path, 256, "%s/*", directory);
+
+    WIN32_FIND_DATA result;
+    HANDLE handle = FindFirstFile(search_path, &result);
+
+    if(handle == INVALID_HANDLE_VALUE) return;
+
+    do {
+        if((strcmp(result.cFileName, ".") == 0) || (strcmp(result.cFileName, "..") == 0)) continue;
+
+        char path[256];
+        snprintf(path, 256, "%s/%s", directory, result.cFileName);
+
+        if(result.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            list_files(path, files);
+        } else {
+            files->add(strdup(path));
+        }
+    } while(FindNextFile(handle, &result));
+
+    FindClose(handle);
+#endif
+}
+
+bool read_whole_file(char * path, String * data) {
+    FILE * file = fopen(path, "rb");
+
+    if(!file) return false;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    data->data  = (char *) malloc(size > 0 ? size : 1);
+    data->count = (int) fread(data->data, 1, size, file);
+
+    fclose(file);
+
+    return data->count == size;
+}
+
+bool write_whole_file(char * path, void * data, int size) {
+    FILE * file = fopen(path, "wb");
+
+    if(!file) return false;
+
+    bool success = (fwrite(data, 1, size, file) == size);
+
+    fclose(file);
+
+    return success;
+}
+
+// Creates every directory leading to path, the file itself is left alone.
+void make_directories_for(char * path) {
+    char directory[256];
+    snprintf(directory, 256, "%s", path);
+
+    for(char * cursor = directory + 1; *cursor; cursor++) {
+        if(*cursor != '/') continue;
+
+        *cursor = 0;
+#ifdef LINUX
+        mkdir(directory, 0755);
+#else
+        CreateDirectory(directory, NULL);
+#endif
+        *cursor = '/';
+    }
+}
+
+static int compare_pack_sources(const void * a, const void * b) {
+    unsigned long long hash_a = ((PackSource *) a)->entry.name_hash;
+    unsigned long long hash_b = ((PackSource *) b)->entry.name_hash;
+
+    if(hash_a < hash_b) return -1;
+    if(hash_a > hash_b) return  1;
+    return 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "parsing.h"
+#include "texture_compression.h"
+
+// Manifest of what was cooked, lives in the cooked directory, see cook.cpp.
+#define COOK_MANIFEST_NAME "/manifest.txt"
+
+// builder.cpp
+bool is_source_only_file(char * path);
+
+void list_files(char * directory, Array<char *> * files);
+
+bool read_whole_file(char * path, String * data);
+bool write_whole_file(char * path, void * data, int size);
+
+void make_directories_for(char * path);
+
+// cook.cpp
+struct CookOptions {
+    bool compress_textures;         // BC1/BC3 for textures whose size allows it, RGBA8 for the others.
+    CompressionQuality compression; // /fast_cook trades quality for speed.
+};
+
+bool cook_directory(char * source_directory, char * cooked_directory, CookOptions options);
@@ -0,0 +1,378 @@
+// Offline asset cooking, see /cook in builder.cpp. Turns the data directory into files the game can use as they are:
+// textures are decoded, come with their mips and are block compressed, and rooms are binary. Everything else (shaders,
+// fonts) is copied as it is.
+// Formats are in cooked_assets.h.
+//
+// The manifest remembers the hash of every source we cooked, so running it again only cooks what changed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include "builder/builder.h"
+#include "cooked_assets.h"
+#include "room_manager.h"
+#include "hash.h"
+#include "macros.h"
+
+// The builder has no other users of stb, so the implementations live here.
+#define STBI_ONLY_PNG
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+struct ManifestEntry {
+    char * path; // Source path
+    unsigned long long source_hash;
+};
+
+// Private functions
+static bool cook_file(char * source_path, String source, char * cooked_path, CookOptions options);
+
+static bool cook_texture(char * source_path, String source, char * cooked_path, CookOptions options);
+static bool cook_room   (char * source_path, String source, char * cooked_path);
+
+static void compress_mip_chain_in_parallel(unsigned char * rgba_chain, int width, int height, int num_levels, TextureFormat format,
+                                           CompressionQuality quality, unsigned char * output);
+
+static Array<ManifestEntry> read_manifest(char * path, int options_key);
+static bool write_manifest(char * path, int options_key, Array<ManifestEntry> manifest);
+static int get_options_key(CookOptions options);
+static ManifestEntry * find_manifest_entry(Array<ManifestEntry> manifest, char * path);
+
+static int remove_stale_cooked_files(char * source_directory, char * cooked_directory, Array<ManifestEntry> manifest);
+
+static bool file_exists(char * path);
+
+// Const
+const int MAX_COOK_THREADS = 64;
+
+const int MAX_MANIFEST_LINE = 4096; // Longer lines are skipped, those files get cooked again.
+
+bool cook_directory(char * source_directory, char * cooked_directory, CookOptions options) {
+    char manifest_path[256];
+    snprintf(manifest_path, 256, "%s%s", cooked_directory, COOK_MANIFEST_NAME);
+
+    int options_key = get_options_key(options);
+
+    Array<ManifestEntry> old_manifest = read_manifest(manifest_path, options_key);
+    Array<ManifestEntry> new_manifest;
+
+    Array<char *> files;
+    list_files(source_directory, &files);
+
+    int num_cooked  = 0;
+    int num_skipped = 0;
+    int num_failed  = 0;
+
+    for_array(files.data, files.count) {
+        char * source_path = *it;
+
+        if(is_source_only_file(source_path)) {
+            free(source_path);
+            for_array_continue;
+        }
+
+        String source;
+        if(!read_whole_file(source_path, &source)) {
+            printf("Could not read %s\n", source_path);
+            num_failed += 1;
+            free(source.data);
+            free(source_path);
+            for_array_continue;
+        }
+
+        ManifestEntry entry;
+        entry.path        = source_path;
+        entry.source_hash = murmur_hash_64a(source.data, source.count, 0);
+
+        char cooked_path[256];
+        if(snprintf(cooked_path, 256, "%s%s", cooked_directory, source_path + strlen(source_directory)) >= 256) {
+            printf("The cooked path for %s is too long\n", source_path);
+            num_failed += 1;
+            free(source.data);
+            free(source_path);
+            for_array_continue;
+        }
+
+        ManifestEntry * old_entry = find_manifest_entry(old_manifest, source_path);
+
+        if(old_entry && old_entry->source_hash == entry.source_hash && file_exists(cooked_path)) {
+            num_skipped += 1;
+            new_manifest.add(entry);
+        } else if(cook_file(source_path, source, cooked_path, options)) {
+            num_cooked += 1;
+            new_manifest.add(entry);
+        } else {
+            printf("Failed to cook %s\n", source_path);
+            num_failed += 1;
+            free(source_path); // Not in the manifest, so we try again next time.
+        }
+
+        free(source.data);
+    }
+
+    files.reset(true);
+
+    bool success = write_manifest(manifest_path, options_key, new_manifest);
+
+    int num_removed = remove_stale_cooked_files(source_directory, cooked_directory, new_manifest);
+
+    printf("Cooked %d files, %d were up to date, %d failed, %d stale ones removed\n", num_cooked, num_skipped, num_failed, num_removed);
+
+    for_array(old_manifest.data, old_manifest.count) {
+        free(it->path);
+    }
+    old_manifest.reset(true);
+
+    for_array(new_manifest.data, new_manifest.count) {
+        free(it->path);
+    }
+    new_manifest.reset(true);
+
+    return success && (num_failed == 0);
+}
+
+static bool cook_file(char * source_path, String source, char * cooked_path, CookOptions options) {
+    make_directories_for(cooked_path);
+
+    char * extension = strrchr(source_path, '.') + 1; // is_source_only_file made sure there is one
+
+    if(strcmp(extension, "png")  == 0) return cook_texture(source_path, source, cooked_path, options);
+    if(strcmp(extension, "room") == 0) return cook_room   (source_path, source, cooked_path);
+
+    // Nothing to cook (shaders, fonts), copy it over so the cooked directory has everything.
+    return write_whole_file(cooked_path, source.data, source.count);
+}
+
+static bool cook_texture(char * source_path, String source, char * cooked_path, CookOptions options) {
+    int width;
+    int height;
+    int channels_in_file;
+    unsigned char * bitmap = stbi_load_from_memory((unsigned char *) source.data, source.count, &width, &height, &channels_in_file, 4);
+
+    if(!bitmap) return false;
+
+    scope_exit(stbi_image_free(bitmap));
+
+    int num_mip_levels = get_num_mip_levels(width, height);
+
+    unsigned char * chain = (unsigned char *) malloc(get_mip_chain_size(TEXTURE_FORMAT_RGBA8, width, height, num_mip_levels));
+    scope_exit(free(chain));
+
+    memcpy(chain, bitmap, width * height * 4);
+
+    // We have the time, so the sharper filter.
+    generate_mip_levels(chain, width, height, num_mip_levels, MIP_FILTER_KAISER);
+
+    TextureFormat format = TEXTURE_FORMAT_RGBA8;
+
+    if(options.compress_textures) {
+        if(can_block_compress(width, height)) {
+            format = pick_compressed_format(chain, width, height);
+        } else {
+            printf("%s is %dx%d, it needs to be a multiple of 4 on both sides to be compressed\n", source_path, width, height);
+        }
+    }
+
+    CookedTextureHeader header;
+    header.magic          = COOKED_TEXTURE_MAGIC;
+    header.version        = COOK_VERSION;
+    header.width          = width;
+    header.height         = height;
+    header.format         = format;
+    header.num_mip_levels = num_mip_levels;
+
+    int file_size = sizeof(header) + get_mip_chain_size(format, width, height, num_mip_levels);
+
+    unsigned char * file_data = (unsigned char *) malloc(file_size);
+    scope_exit(free(file_data));
+
+    memcpy(file_data, &header, sizeof(header));
+
+    if(format == TEXTURE_FORMAT_RGBA8) {
+        memcpy(file_data + sizeof(header), chain, file_size - sizeof(header));
+    } else {
+        compress_mip_chain_in_parallel(chain, width, height, num_mip_levels, format, options.compression, file_data + sizeof(header));
+    }
+
+    return write_whole_file(cooked_path, file_data, file_size);
+}
+
+// Every level is split in bands of block rows, one thread per band.
+static void compress_mip_chain_in_parallel(unsigned char * rgba_chain, int width, int height, int num_levels, TextureFormat format,
+                                           CompressionQuality quality, unsigned char * output) {
+    int num_threads = (int) std::thread::hardware_concurrency();
+
+    if(num_threads < 1)                num_threads = 1;
+    if(num_threads > MAX_COOK_THREADS) num_threads = MAX_COOK_THREADS;
+
+    for(int i = 0; i < num_levels; i++) {
+        int num_block_rows = get_num_rows(format, height);
+        int rows_per_band  = (num_block_rows + num_threads - 1) / num_threads;
+
+        std::thread threads[MAX_COOK_THREADS];
+        int num_bands = 0;
+
+        for(int first_row = 0; first_row < num_block_rows; first_row += rows_per_band) {
+            int num_rows = (first_row + rows_per_band <= num_block_rows) ? rows_per_band : num_block_rows - first_row;
+
+            threads[num_bands] = std::thread(compress_block_rows, rgba_chain, width, height, format, quality, output, first_row, num_rows);
+            num_bands += 1;
+        }
+
+        for(int j = 0; j < num_bands; j++) threads[j].join();
+
+        rgba_chain += get_level_size(TEXTURE_FORMAT_RGBA8, width, height);
+        output     += get_level_size(format, width, height);
+
+        width  = (width  > 1) ? width  / 2 : 1;
+        height = (height > 1) ? height / 2 : 1;
+    }
+}
+
+static bool cook_room(char * source_path, String source, char * cooked_path) {
+    Room room = {};
+    room.dimensions = { -1, -1 };
+
+    if(!parse_room_text(source_path, source, &room)) return false; // It already complained.
+
+    String cooked = write_cooked_room(&room);
+    scope_exit(free(cooked.data));
+
+    for_array(room.tiles.data, room.tiles.count) {
+        free(it->texture.data);
+    }
+
+    room.tiles.reset(true);
+    room.collision_blocks.reset(true);
+
+    return write_whole_file(cooked_path, cooked.data, cooked.count);
+}
+
+// Format: "COOK_VERSION <version> OPTIONS <options key>" on the first line, then "<source hash>\t<source path>" for every
+// file, the path running to the end of the line, spaces included. A manifest from another version, or cooked with
+// other options, is thrown away so everything gets cooked again. Lines we can't read are skipped, their files get
+// cooked again too.
+static Array<ManifestEntry> read_manifest(char * path, int options_key) {
+    Array<ManifestEntry> manifest;
+
+    FILE * file = fopen(path, "r");
+
+    if(!file) return manifest;
+
+    scope_exit(fclose(file));
+
+    unsigned int version;
+    int key;
+    if(fscanf(file, "COOK_VERSION %u OPTIONS %d\n", &version, &key) != 2 || version != COOK_VERSION || key != options_key) return manifest;
+
+    char line[MAX_MANIFEST_LINE];
+
+    while(fgets(line, MAX_MANIFEST_LINE, file)) {
+        int length = (int) strlen(line);
+
+        if(length && line[length - 1] == '\n') {
+            line[length - 1] = '\0';
+        } else if(!feof(file)) {
+            // Too long, skip the rest of it.
+            int c;
+            while((c = fgetc(file)) != EOF && c != '\n') {}
+            continue;
+        }
+
+        char * tab = strchr(line, '\t');
+        if(!tab || tab[1] == '\0') continue;
+
+        *tab = '\0';
+
+        char * end;
+        unsigned long long source_hash = strtoull(line, &end, 16);
+        if(end == line || *end != '\0') continue;
+
+        ManifestEntry entry;
+        entry.path        = strdup(tab + 1);
+        entry.source_hash = source_hash;
+
+        manifest.add(entry);
+    }
+
+    return manifest;
+}
+
+static bool write_manifest(char * path, int options_key, Array<ManifestEntry> manifest) {
+    make_directories_for(path);
+
+    FILE * file = fopen(path, "w");
+
+    if(!file) return false;
+
+    fprintf(file, "COOK_VERSION %u OPTIONS %d\n", COOK_VERSION, options_key);
+
+    for_array(manifest.data, manifest.count) {
+        fprintf(file, "%016llx\t%s\n", it->source_hash, it->path);
+    }
+
+    bool success = (ferror(file) == 0);
+
+    fclose(file);
+
+    return success;
+}
+
+// Anything that changes what we write goes in there.
+static int get_options_key(CookOptions options) {
+    return options.compress_textures ? 1 + options.compression : 0;
+}
+
+// @Speed Linear, but we only have a few dozen files.
+static ManifestEntry * find_manifest_entry(Array<ManifestEntry> manifest, char * path) {
+    for(int i = 0; i < manifest.count; i++) {
+        if(strcmp(manifest.data[i].path, path) == 0) return &manifest.data[i];
+    }
+
+    return NULL;
+}
+
+// Cooked files whose source is gone, or that no longer get cooked, so write_pack stops shipping them. Returns how many
+// were removed.
+static int remove_stale_cooked_files(char * source_directory, char * cooked_directory, Array<ManifestEntry> manifest) {
+    Array<char *> files;
+    list_files(cooked_directory, &files);
+
+    int num_removed = 0;
+
+    for_array(files.data, files.count) {
+        char * cooked_path = *it;
+        scope_exit(free(cooked_path));
+
+        char * relative_path = cooked_path + strlen(cooked_directory);
+        if(strcmp(relative_path, COOK_MANIFEST_NAME) == 0) for_array_continue;
+
+        char source_path[256];
+        snprintf(source_path, 256, "%s%s", source_directory, relative_path);
+
+        if(find_manifest_entry(manifest, source_path)) for_array_continue;
+        if(file_exists(source_path) && !is_source_only_file(source_path)) for_array_continue; // Failed to cook this time, it stays.
+
+        if(remove(cooked_path) == 0) {
+            printf("Removed %s, its source is gone\n", cooked_path);
+            num_removed += 1;
+        } else {
+            printf("Could not remove %s\n", cooked_path);
+        }
+    }
+
+    files.reset(true);
+
+    return num_removed;
+}
+
+static bool file_exists(char * path) {
+    FILE * file = fopen(path, "rb");
+
+    if(!file) return false;
+
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "math_m.h"
+#include "mip_maps.h"
+
+// Formats written by the builder's /cook mode and read by the managers. A cooked file keeps the name of its source
+// (tree.png stays tree.png in the cooked directory), the managers tell them apart by their magic number. Everything is
+// little endian.
+
+const unsigned int COOK_VERSION = 4; // Bump this when a format or the cooking itself changes, it recooks everything.
+
+// ------ Textures ------
+// CookedTextureHeader, then every mip level from the biggest to 1x1, back to back (see mip_maps.h). BC1 or BC3 when
+// the size allows it, RGBA8 otherwise. Straight alpha like the textures we load from PNGs.
+const unsigned int COOKED_TEXTURE_MAGIC = 0x58543347; // "G3TX"
+
+struct CookedTextureHeader {
+    unsigned int magic;
+    unsigned int version;
+
+    int width;
+    int height;
+    int format; // TextureFormat
+
+    int num_mip_levels;
+};
+
+// ------ Rooms ------
+// CookedRoomHeader, CookedTile * num_tiles, CookedCollisionBlock * num_collision_blocks, then the strings, not null
+// terminated.
+const unsigned int COOKED_ROOM_MAGIC = 0x4d523347; // "G3RM"
+
+struct CookedRoomHeader {
+    unsigned int magic;
+    unsigned int version;
+
+    Vector2 dimensions;
+
+    int num_tiles;
+    int num_collision_blocks;
+    int strings_size;
+};
+
+struct CookedString {
+    int offset; // From the beginning of the strings
+    int count;
+};
+
+struct CookedTile {
+    Vector2f position;
+    CookedString texture;
+};
+
+struct CookedCollisionBlock {
+    Quad quad;
+
+    unsigned int flags;
+    int action_type; // CollisionActionType
+
+    // TELEPORT
+    Vector2f target;
+    CookedString target_room_name;
+};
+
+// ------ Fonts ------
+// Not cooked, TTFs are copied as they are. The glyph cache rasterizes glyphs from them at runtime, see glyph_cache.h.
+
+// ------ Helpers ------
+inline bool is_cooked(void * data, int size, unsigned int magic) {
+    if(size < 2 * sizeof(unsigned int)) return false;
+
+    unsigned int * header = (unsigned int *) data;
+    return header[0] == magic && header[1] == COOK_VERSION;
+}
@@ -32,6 +32,13 @@ static void switch_to_shader(Shader * shader);
 const int MAX_VERTEX_BUFFER_SIZE = 8192;
 const int MAX_INDEX_BUFFER_SIZE  = 8192;
 
+static const DXGI_FORMAT DXGI_FORMATS[TEXTURE_FORMAT_COUNT] = { // Indexed by TextureFormat
+    DXGI_FORMAT_R8G8B8A8_UNORM,
+    DXGI_FORMAT_A8_UNORM, // Our fonts are greyscale
+    DXGI_FORMAT_BC1_UNORM,
+    DXGI_FORMAT_BC3_UNORM,
+};
+
 // Globals
 static IDXGISwapChain      * swap_chain;
 static ID3D11Device        * d3d_device;
@@ -234,6 +241,8 @@ void init_frame() {
 }
 
 void present_frame(int sync_interval) {
+    // @Incomplete DXGI_ERROR_DEVICE_REMOVED and DXGI_ERROR_DEVICE_RESET are ignored, we'd have to create the device and
+    // everything on it again, textures included.
     swap_chain->Present(sync_interval, 0);
 }
 
@@ -286,20 +295,17 @@ void draw_batch(DrawBatch * batch) {
             return;
         }
 
-        // This texture was modified, so let's reset its SRV. @Incomplete @Speed, we can probably
-        // just remap the data if the size and bit depth stay the same.
+        // This texture was replaced, so let's reset its SRV. If only part of it changed, we update that in place.
         if(texture->dirty) {
-			if (texture->platform_info) {
-				texture->platform_info->srv->Release(); // Release the D3D interface
-				free(texture->platform_info);
-				texture->platform_info = NULL;
-			}
-			texture->dirty = false;
+            release_texture(texture);
+        } else if(texture->platform_info && has_dirty_region(texture)) {
+            update_texture_region(texture, texture->dirty_rect);
         }
 
         if(texture->platform_info == NULL) {
             texture->platform_info = (PlatformTextureInfo *) malloc(sizeof(PlatformTextureInfo));
             bind_srv_to_texture(texture);
+            texture->dirty_rect = {}; // Uploaded with the rest.
         }
 
         if ((last_texture_set == NULL) || (last_texture_set != texture)) {
@@ -310,13 +316,58 @@ void draw_batch(DrawBatch * batch) {
     d3d_dc->DrawIndexed(batch->indices.count, 0, 0);
 }
 
+void release_texture(Texture * texture) {
+    if(texture->platform_info) {
+        texture->platform_info->srv->Release(); // Release the D3D interface
+        free(texture->platform_info);
+        texture->platform_info = NULL;
+    }
+
+    texture->dirty      = false;
+    texture->dirty_rect = {}; // The next upload takes everything.
+
+    // Whatever gets made next can land at the same address, or be this texture again with a new SRV.
+    if(last_texture_set == texture) last_texture_set = NULL;
+}
+
+void update_texture_region(Texture * texture, TextureRect rect) {
+    assert(texture->platform_info && texture->bitmap);
+
+    ID3D11Resource * d3d_texture;
+    texture->platform_info->srv->GetResource(&d3d_texture);
+
+    // Every level, whoever changed the bitmap rebuilt its mips already.
+    for(int i = 0; i < texture->num_mip_levels; i++) {
+        MipLevel    level      = get_mip_level(texture, i);
+        TextureRect level_rect = get_mip_level_rect(texture, rect, i);
+
+        if(level_rect.x1 <= level_rect.x0 || level_rect.y1 <= level_rect.y0) continue;
+
+        D3D11_BOX box;
+                  box.left   = level_rect.x0;
+                  box.top    = level_rect.y0;
+                  box.front  = 0;
+                  box.right  = level_rect.x1;
+                  box.bottom = level_rect.y1;
+                  box.back   = 1;
+
+        unsigned char * source = level.data + get_pixel_offset(texture->format, level.row_pitch, level_rect.x0, level_rect.y0);
+
+        d3d_dc->UpdateSubresource(d3d_texture, D3D11CalcSubresource(i, 0, texture->num_mip_levels), &box, source, level.row_pitch, 0);
+    }
+
+    d3d_texture->Release(); // GetResource adds a reference.
+
+    texture->dirty_rect = {};
+}
+
 static void bind_srv_to_texture(Texture * texture) {
     D3D11_TEXTURE2D_DESC texture_desc;
                          texture_desc.Width              = texture->width;
                          texture_desc.Height             = texture->height;
-                         texture_desc.MipLevels          = 1;
+                         texture_desc.MipLevels          = texture->num_mip_levels;
                          texture_desc.ArraySize          = 1;
-                         texture_desc.Format             = DXGI_FORMAT_R8G8B8A8_UNORM;
+                         texture_desc.Format             = DXGI_FORMATS[texture->format];
                          texture_desc.SampleDesc.Count   = 1;
                          texture_desc.SampleDesc.Quality = 0;
                          texture_desc.Usage              = D3D11_USAGE_DEFAULT;
@@ -324,30 +375,28 @@ static void bind_srv_to_texture(Texture * texture) {
                          texture_desc.CPUAccessFlags     = 0;
                          texture_desc.MiscFlags          = 0;
 
-    // Our fonts are greyscale, so let's make a special case for those
-    if(texture->bytes_per_pixel == 1) {
-        texture_desc.Format = DXGI_FORMAT_A8_UNORM;
-    }
+    // Every mip level the texture manager built or the cooker gave us.
+    D3D11_SUBRESOURCE_DATA texture_subresources[D3D11_REQ_MIP_LEVELS];
+
+    assert(texture->num_mip_levels <= D3D11_REQ_MIP_LEVELS);
 
-    D3D11_SUBRESOURCE_DATA texture_subresource;
-    texture_subresource.pSysMem             = texture->bitmap;
-    texture_subresource.SysMemPitch         = texture->width_in_bytes;
-    texture_subresource.SysMemSlicePitch    = texture->num_bytes;
+    for(int i = 0; i < texture->num_mip_levels; i++) {
+        MipLevel level = get_mip_level(texture, i);
+
+        texture_subresources[i].pSysMem          = level.data;
+        texture_subresources[i].SysMemPitch      = level.row_pitch;
+        texture_subresources[i].SysMemSlicePitch = level.num_bytes;
+    }
 
     ID3D11Texture2D * d3d_texture;
 
-    d3d_device->CreateTexture2D(&texture_desc, &texture_subresource, &d3d_texture);
+    d3d_device->CreateTexture2D(&texture_desc, texture_subresources, &d3d_texture);
 
     D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc;
-                                    srv_desc.Format                    = DXGI_FORMAT_R8G8B8A8_UNORM;
+                                    srv_desc.Format                    = DXGI_FORMATS[texture->format];
                                     srv_desc.ViewDimension             = D3D11_SRV_DIMENSION_TEXTURE2D;
                                     srv_desc.Texture2D.MostDetailedMip = 0;
-                                    srv_desc.Texture2D.MipLevels       = 1;
-
-    // Our fonts are greyscale, so let's make a special case for those
-    if(texture->bytes_per_pixel == 1) {
-        srv_desc.Format = DXGI_FORMAT_A8_UNORM;
-    }
+                                    srv_desc.Texture2D.MipLevels       = texture->num_mip_levels;
 
     d3d_device->CreateShaderResourceView(d3d_texture, &srv_desc, &texture->platform_info->srv);
 
@@ -494,7 +543,9 @@ InputLayout * assign_or_create_input_layout(Shader * shader) {
     }
 }
 
-bool compile_shader(Shader * shader) {
+// @Incomplete #includes in the shader are still resolved from the loose files by D3DCompile, even when the source
+// came from the pack.
+bool compile_shader(Shader * shader, String file_data) {
     shader->VS = NULL;
     shader->PS = NULL;
 
@@ -509,15 +560,9 @@ bool compile_shader(Shader * shader) {
 
     ID3DBlob * error = NULL;
 
-    String file_data = os_specific_read_file(shader->full_path);
-
     char * c_name = to_c_string(shader->name);
     scope_exit(free(c_name));
 
-    if(!file_data.data) {
-        return false; // we already reported an error.
-    }
-
     HRESULT error_code = D3DCompile(file_data.data, file_data.count, NULL, NULL, D3D_COMPILE_STANDARD_FILE_INCLUDE,
                        "VS", "vs_5_0", 0, 0, &VS_bytecode, &error);
 
@@ -583,7 +628,12 @@ static bool create_shader(String filename, Shader * shader) {
     shader->full_path.count = path_length;
     memcpy(shader->full_path.data, path, path_length);
 
-    return compile_shader(shader);
+    String file_data = os_specific_read_file(shader->full_path);
+    scope_exit(free(file_data.data));
+
+    if(!file_data.data) return false; // We already reported an error.
+
+    return compile_shader(shader, file_data);
 }
 
 static void switch_to_shader(Shader * shader) {
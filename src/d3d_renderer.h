@@ -1,11 +1,14 @@
 #pragma once
 #include "macros.h"
 #include "math_m.h"
+#include "parsing.h"
 
 struct GraphicsBuffer;
 struct TextureManager;
 struct Shader;
 struct DrawBatch;
+struct Texture;
+struct TextureRect;
 
 extern "C" {
     // Init
@@ -18,6 +21,10 @@ extern "C" {
 
     DLLEXPORT void present_frame(int sync_interval);
 
+    // Textures
+    DLLEXPORT void release_texture(Texture * texture);
+    DLLEXPORT void update_texture_region(Texture * texture, TextureRect rect); // Uploads rect of the bitmap, every level. Size and format have to be the same.
+
     // Shaders
-    DLLEXPORT bool compile_shader(Shader * shader);
+    DLLEXPORT bool compile_shader(Shader * shader, String file_data); // file_data is the shader source, we don't keep it.
 }
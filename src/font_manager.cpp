@@ -1,23 +1,33 @@
 #include "font_manager.h"
 #include "texture_manager.h"
+#include "glyph_cache.h"
 #include "macros.h"
 
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb_truetype.h"
 #include "os/layer.h"
+#include "pack_file.h"
 
-static TextureManager * tm; // Make this a member ?
+// Read and parsed on a worker thread, published by end_async_load.
+struct LoadedFont {
+    Font * font;
 
-static int get_file_size(FILE * file) {
-    fseek (file , 0 , SEEK_END);
-    int size = ftell (file);
-    fseek (file , 0 , SEEK_SET);
-    return size;
-}
+    String full_path; // Copy, the font's path can't be touched from the worker.
+    unsigned long long previous_hash;
+
+    String file_data;
+    stbtt_fontinfo info;
+    unsigned long long content_hash;
+};
+
+// Private functions
+static bool read_font_file(String name, String full_path, unsigned long long previous_hash, unsigned long long * content_hash, String * file_data, stbtt_fontinfo * info);
+static void publish_font(Font * font, String file_data, stbtt_fontinfo * info, unsigned long long content_hash);
 
 void FontManager::init(TextureManager * texture_manager) {
     this->extensions.add("ttf");
-    tm = texture_manager;
+
+    init_glyph_cache(texture_manager);
 }
 
 SpecificFont * FontManager::get_font_at_size(Font * font, int size) {
@@ -30,64 +40,170 @@ SpecificFont * FontManager::get_font_at_size(Font * font, int size) {
 
 }
 
+// Nothing gets rasterized here, glyphs go in the atlas the first time they're drawn.
 SpecificFont * FontManager::load_font_at_specific_size(Font * font, int size) {
+    if(!font->file_data.data) {
+        do_load_font(font); // Not loaded yet, the hotloader hasn't gotten to it.
+
+        if(!font->file_data.data) return NULL; // Already complained.
+    }
+
     SpecificFont * specific_font = (SpecificFont *) malloc(sizeof(SpecificFont));
-    specific_font->size = size;
+    specific_font->font         = font;
+    specific_font->size         = size;
+    specific_font->sdf          = this->use_sdf;
+    specific_font->glyph_source = specific_font;
+    specific_font->texture      = get_glyph_atlas();
+
+    if(specific_font->sdf && size != SDF_GLYPH_SIZE) {
+        specific_font->glyph_source = get_font_at_size(font, SDF_GLYPH_SIZE);
+    }
+
+    int ascent;
+    stbtt_GetFontVMetrics(&font->info, &ascent, NULL, NULL);
 
-    String file_data = os_specific_read_file(font->full_path);
+    specific_font->scale  = stbtt_ScaleForPixelHeight(&font->info, size);
+    specific_font->ascent = ascent * specific_font->scale;
 
-    if(!file_data.data) return NULL;
+    font->specific_fonts.add(specific_font);
 
-    scope_exit(free(file_data.data));
+    return specific_font;
+}
+
+void get_glyph_quad(SpecificFont * font, int codepoint, float * x, float * y, stbtt_aligned_quad * quad, CachedGlyph * cached) { // @Default cached = NULL
+    CachedGlyph glyph = get_glyph(font->glyph_source, codepoint);
+    if(cached) *cached = glyph;
 
-    unsigned char * c_file_data = (unsigned char *) to_c_string(file_data);
-    scope_exit(free(c_file_data));
+    Texture * atlas = font->texture;
 
-    unsigned char * bitmap = (unsigned char *) malloc(512 * 512 * 4); // Our bitmap is 512x512 pixels and each pixel takes 4 bytes @Robustness, make sure the bitmap is big enough for the font
-    int result = stbtt_BakeFontBitmap(c_file_data, 0, size, bitmap, 512, 512, 32, 96, specific_font->char_data); // @Robustness From stb_truetype.h : "no guarantee this fits!""
+    if(font->sdf) {
+        // Scaled from SDF_GLYPH_SIZE, and no need to snap to pixels, the shader antialiases wherever it lands.
+        float glyph_scale = font->size / (float) font->glyph_source->size;
 
-    char * c_name = to_c_string(font->name);
-    scope_exit(free(c_name));
+        quad->x0 = *x + glyph.x_offset * glyph_scale;
+        quad->y0 = *y + glyph.y_offset * glyph_scale;
+        quad->x1 = quad->x0 + glyph.width  * glyph_scale;
+        quad->y1 = quad->y0 + glyph.height * glyph_scale;
 
-    if(result <= 0) {
+        glyph.advance *= glyph_scale;
+    } else {
+        float round_x = floorf(*x + glyph.x_offset + 0.5f);
+        float round_y = floorf(*y + glyph.y_offset + 0.5f);
 
-        log_print("load_font", "The font %s could not be loaded for size %d, it is too large to fit in a 512x512 bitmap", c_name, size);
-        return NULL;
+        quad->x0 = round_x;
+        quad->y0 = round_y;
+        quad->x1 = round_x + glyph.width;
+        quad->y1 = round_y + glyph.height;
     }
 
-    if(tm) {
-        char texture_name_buffer[128];
-        snprintf(texture_name_buffer, 128, "%s%d", c_name, size);
+    quad->s0 = glyph.x / (float) atlas->width;
+    quad->t0 = glyph.y / (float) atlas->height;
+    quad->s1 = (glyph.x + glyph.width)  / (float) atlas->width;
+    quad->t1 = (glyph.y + glyph.height) / (float) atlas->height;
 
-        String texture_name = to_string(strdup(texture_name_buffer));
-        specific_font->texture = tm->table.find(texture_name);
-        if(specific_font->texture) {
-            free(texture_name.data);
-            // We already made a texture for that font size, we'll just update the bitmap.
-            free(specific_font->texture->bitmap);
-            specific_font->texture->bitmap = bitmap;
-            specific_font->texture->dirty  = true;
-        } else {
-            specific_font->texture = tm->create_texture(texture_name, bitmap, 512, 512, 1);
-        }
+    *x += glyph.advance;
+}
+
+void FontManager::load_asset(Asset * asset) {
+    do_load_font((Font *) asset);
+}
 
-        font->specific_fonts.add(specific_font);
+void * FontManager::begin_async_load(Asset * asset) {
+    LoadedFont * load = (LoadedFont *) malloc(sizeof(LoadedFont));
 
-        // log_print("load_font", "Loaded font %s at size %d", c_name, size);
+    load->font           = (Font *) asset;
+    load->previous_hash  = asset->content_hash;
+    load->file_data.data = NULL;
 
-        return specific_font;
-    } else {
-        log_print("load_font", "Tried creating font %s with size %d, but no TextureManager is assigned to the font manager, so the texture could not be registered", c_name, size);
+    load->full_path.count = asset->full_path.count;
+    load->full_path.data  = (char *) malloc(asset->full_path.count);
+    memcpy(load->full_path.data, asset->full_path.data, asset->full_path.count);
+
+    return load;
+}
+
+void FontManager::do_async_load(void * data) {
+    LoadedFont * load = (LoadedFont *) data;
+    read_font_file(load->font->name, load->full_path, load->previous_hash, &load->content_hash, &load->file_data, &load->info);
+}
+
+void FontManager::end_async_load(void * data) {
+    LoadedFont * load = (LoadedFont *) data;
+    scope_exit(free(load));
+    scope_exit(free(load->full_path.data));
+
+    if(!load->file_data.data) return; // Keep whatever we had.
+
+    // get_font_at_size may have loaded the same file while we were at it.
+    if(load->content_hash == load->font->content_hash) {
+        free_asset_file(load->file_data);
+        return;
     }
 
-	return NULL;
+    publish_font(load->font, load->file_data, &load->info, load->content_hash);
 }
 
 void FontManager::do_load_font(Font * font) {
+    String file_data;
+    stbtt_fontinfo info;
+    unsigned long long content_hash;
+
+    if(!read_font_file(font->name, font->full_path, font->content_hash, &content_hash, &file_data, &info)) return;
+
+    publish_font(font, file_data, &info, content_hash);
+}
+
+// Thread safe, it only reads the file and parses its tables. Returns false if it failed, or if the file still hashes to
+// previous_hash, in which case the glyphs we have are still good. name is only read.
+static bool read_font_file(String name, String full_path, unsigned long long previous_hash, unsigned long long * content_hash, String * file_data, stbtt_fontinfo * info) {
+    *file_data = read_asset_file(full_path, content_hash);
+
+    if(!file_data->data) return false; // Should have already errored.
+
+    if(*content_hash == previous_hash) {
+        char * c_name = to_c_string(name);
+        scope_exit(free(c_name));
+        log_print("load_font", "Skipped reloading font \"%s\", its contents didn't change", c_name);
+
+        free_asset_file(*file_data);
+        file_data->data = NULL;
+        return false;
+    }
+
+    unsigned char * data = (unsigned char *) file_data->data;
+
+    if(!stbtt_InitFont(info, data, stbtt_GetFontOffsetForIndex(data, 0))) {
+        char * c_path = to_c_string(full_path);
+        scope_exit(free(c_path));
+        log_print("load_font", "%s isn't a font stb_truetype can read", c_path);
+
+        free_asset_file(*file_data);
+        file_data->data = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+// Every size we already have gets its metrics again, in place, so the SpecificFont pointers handed out by
+// get_font_at_size stay valid. Their glyphs come from the old file, they have to go.
+static void publish_font(Font * font, String file_data, stbtt_fontinfo * info, unsigned long long content_hash) {
+    if(font->file_data.data) free_asset_file(font->file_data);
+
+    font->file_data    = file_data;
+    font->info         = *info;
+    font->content_hash = content_hash;
+
+    int ascent;
+    stbtt_GetFontVMetrics(&font->info, &ascent, NULL, NULL);
+
     for_array(font->specific_fonts.data, font->specific_fonts.count) {
-        load_font_at_specific_size(font, (*it)->size);
-        font->specific_fonts.remove_by_index(it_index);
-        free(it);
+        SpecificFont * specific_font = *it;
+
+        remove_glyphs(specific_font);
+
+        specific_font->scale  = stbtt_ScaleForPixelHeight(&font->info, specific_font->size);
+        specific_font->ascent = ascent * specific_font->scale;
     }
 }
 
@@ -99,6 +215,12 @@ void FontManager::create_placeholder(String name, String path) {
 
 	font->specific_fonts = {};
 
+    font->file_data = {};
+
+    font->content_hash   = 0;
+    font->loading        = false;
+    font->reload_pending = false;
+
     this->table.add(name, font);
 }
 
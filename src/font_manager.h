@@ -4,18 +4,41 @@
 
 struct TextureManager;
 struct Texture;
+struct Font;
+struct CachedGlyph;
 
+// A font at a pixel height. Glyphs come from the glyph cache, see glyph_cache.h.
 struct SpecificFont {
+    Font * font;
     int size;
-    Texture * texture;
-    stbtt_bakedchar char_data[96]; // 96 ASCII characters @Temporary
+
+    float scale;  // stbtt_ScaleForPixelHeight
+    float ascent; // In pixels, from the baseline up
+
+    // Signed distance field glyphs, drawn with sdf_font.shader. Every size of the font scales the glyphs of the size
+    // they were made at, SDF_GLYPH_SIZE, that's glyph_source. Without SDF, glyph_source is the font itself.
+    bool sdf;
+    SpecificFont * glyph_source;
+
+    Texture * texture; // The glyph atlas, shared by every font and size.
 };
 
+const int SDF_GLYPH_SIZE = 32;
+
 struct Font : Asset {
     Array<SpecificFont *> specific_fonts;
+
+    // The TTF and its parsed tables, one of each for every size. file_data points in the pack when there is one,
+    // otherwise we own it, see free_asset_file. Replaced when the file changes, data is NULL until it's loaded.
+    String file_data;
+    stbtt_fontinfo info;
 };
 
 struct FontManager : AssetManager_Poly<Font> {
+    // Fonts asked for from now on are signed distance fields: one set of glyphs in the atlas for every size, sharp
+    // at any scale, but without hinting so small sizes are a bit softer. Set it before asking for sizes.
+    bool use_sdf = false;
+
     void init(TextureManager * texture_manager);
 
     void reload_or_create_asset(String file_path, String file_name);
@@ -23,7 +46,17 @@ struct FontManager : AssetManager_Poly<Font> {
 
     SpecificFont * get_font_at_size(Font * font, int size);
 
+    void load_asset(Asset * asset);
+
+    void * begin_async_load(Asset * asset);
+    void   do_async_load   (void * load);
+    void   end_async_load  (void * load);
+
 private:
     void do_load_font(Font * font);
     SpecificFont * load_font_at_specific_size(Font * font, int size);
 };
+
+// Like stbtt_GetBakedQuad: the quad of codepoint with the pen at (*x, *y), y down, then moves *x to the next one.
+// cached gets the glyph it looked up, for its page, so callers don't look it up (and maybe make room for it) twice.
+void get_glyph_quad(SpecificFont * font, int codepoint, float * x, float * y, stbtt_aligned_quad * quad, CachedGlyph * cached = NULL);
@@ -6,12 +6,13 @@
 
 
 #include <assert.h>
+#include <math.h>
+#include <stdarg.h>
 
 #include "game_main.h"
 
 #include "os/layer.h"
-#include "os/win32/hotloader.h" // @Temporary, I'd like to move the hotloader out of win32.
-#include "os/win32/sound_player.h" // @Temporary
+#include "hotloader.h"
 
 #include "macros.h"
 
@@ -19,8 +20,14 @@
 
 #include "texture_manager.h"
 #include "font_manager.h"
+#include "glyph_cache.h"
+#include "text_layout.h"
 #include "shader_manager.h"
 #include "room_manager.h"
+#include "audio_manager.h"
+#include "job_system.h"
+#include "pack_file.h"
+#include "profiler.h"
 
 // Structs
 struct WindowData {
@@ -86,6 +93,11 @@ struct Camera {
     Vector2f offset;
 };
 
+struct DebugOverlayRow {
+    char label[64];
+    char value[64];
+};
+
 // Prototypes
 void init_game();
 
@@ -111,6 +123,9 @@ void buffer_tiles(Array<Tile> tile);
 void buffer_menu();
 
 void buffer_debug_overlay();
+void update_debug_overlay_rows();
+void reset_debug_overlay_averages();
+void add_debug_overlay_row(char * label, char * format, ...);
 
 void buffer_editor_blocks_overlay(Room * room);
 // void buffer_editor_tile_overlay(Room * room);
@@ -144,8 +159,14 @@ const float MIN_ENTITY_Z                   = 0.0000002f;
 
 const int MAX_NUMBER_ENTITIES = 1;
 
+const long long TEXTURE_MEMORY_BUDGET = 0; // Bytes, 0 keeps every texture resident. See TextureManager::memory_budget.
+const bool SDF_FONTS = true; // One set of glyphs for every text size, see FontManager::use_sdf.
+
+const char * PROFILE_CAPTURE_PATH = "profile_capture.json"; // In the working directory, F4 or /capture write it, see profiler.h.
+
 // Globals
 static Shader * font_shader;
+static Shader * sdf_font_shader;
 static Shader * textured_shader;
 static Shader * colored_shader;
 
@@ -170,13 +191,15 @@ static TextureManager texture_manager;
 static FontManager font_manager;
 static ShaderManager shader_manager;
 static RoomManager room_manager;
+static AudioManager audio_manager;
 
 static Array<AssetManager *> managers;
 
 static Font * my_font;
 
-static void init_shaders() {
+void init_shaders() {
     font_shader     = shader_manager.table.find(to_string("font.shader"));
+    sdf_font_shader = shader_manager.table.find(to_string("sdf_font.shader"));
     textured_shader = shader_manager.table.find(to_string("textured.shader"));
     colored_shader  = shader_manager.table.find(to_string("colored.shader"));
 }
@@ -223,7 +246,7 @@ void init_game() {
 // because I now need to take into account the size of the entity/size.
 
 void game() {
-    perf_monitor();
+    profile_function();
 
     main_camera.size.x = main_camera.size.y * window_data.aspect_ratio;
 
@@ -285,6 +308,7 @@ void switch_to_room(Room * room) {
 GameMode previous_game_mode = TITLE_SCREEN;
 
 void handle_user_input() {
+    profile_function();
 
     if(keyboard.key_ESC && !previous_keyboard.key_ESC) {
         if(game_mode == MENU) game_mode = previous_game_mode;
@@ -301,12 +325,22 @@ void handle_user_input() {
 
     if(keyboard.key_F2 && !previous_keyboard.key_F2) {
         debug_overlay_enabled = !debug_overlay_enabled;
+
+        if(debug_overlay_enabled) reset_debug_overlay_averages();
     }
 
     if(keyboard.key_F3 && !previous_keyboard.key_F3) {
         window_data.locked_fps = !window_data.locked_fps;
     }
 
+#ifdef PERF_MON
+    if(keyboard.key_F4 && !previous_keyboard.key_F4) {
+        if(start_profile_capture((char *) PROFILE_CAPTURE_PATH)) {
+            log_print("profiler", "Capturing the next %d frames", PROFILE_CAPTURE_FRAMES);
+        }
+    }
+#endif
+
     if(game_mode == GAME) {
         // Handle player movement
         {
@@ -484,6 +518,7 @@ void handle_user_input() {
 }
 
 void buffer_menu() {
+    profile_function();
     // Buffer background
     buffer_colored_quad(0.0f, 0.0f, BOTTOM_LEFT, 1.0f, 1.0f, MENU_BACKGROUND_Z, {0.0f, 1.0f, 0.0f, 0.6f});
 
@@ -702,6 +737,7 @@ void buffer_editor_left_panel() {
 }*/
 
 void buffer_editor_overlay() {
+    profile_function();
     buffer_editor_blocks_overlay(current_room);
     buffer_editor_left_panel();
 }
@@ -710,23 +746,149 @@ int frame_time_print_counter = 0;
 
 const int FRAME_TIME_UPDATE_DELAY = 15; // in frames
 
+const int   FRAME_TIME_GRAPH_LENGTH = 120;          // in frames
+const float FRAME_TIME_GRAPH_MAX    = 1.0f / 30.0f; // in seconds, longer frames are cut at the top
+const float FRAME_TIME_TARGET       = 1.0f / 60.0f; // in seconds, drawn as a line
+
+const int MAX_DEBUG_OVERLAY_ROWS = 32;
+
 float displayed_frame_time = 0.0f;
 float summed_frame_rate = 0.0f;
 
+float frame_time_graph[FRAME_TIME_GRAPH_LENGTH]; // in seconds, oldest first from frame_time_graph_cursor
+int frame_time_graph_cursor = 0;
+
+long long allocation_count_at_update = 0;
+
+DebugOverlayRow debug_overlay_rows[MAX_DEBUG_OVERLAY_ROWS];
+int num_debug_overlay_rows = 0;
+
+void add_debug_overlay_row(char * label, char * format, ...) {
+    if(num_debug_overlay_rows == MAX_DEBUG_OVERLAY_ROWS) return;
+
+    DebugOverlayRow * row = &debug_overlay_rows[num_debug_overlay_rows];
+    num_debug_overlay_rows += 1;
+
+    snprintf(row->label, sizeof(row->label), "%s", label);
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(row->value, sizeof(row->value), format, args);
+    va_end(args);
+}
+
+// The overlay only counts while it's shown. Without this, the first averages after it comes back would cover all the
+// time it was hidden.
+void reset_debug_overlay_averages() {
+    summed_frame_rate        = 0.0f;
+    frame_time_print_counter = FRAME_TIME_UPDATE_DELAY;
+
+    allocation_count_at_update = get_array_allocation_count();
+}
+
+// The rows only change along with the frame time average, numbers that change every frame can't be read.
+void update_debug_overlay_rows() {
+    num_debug_overlay_rows = 0;
+
+    add_debug_overlay_row("Frame Time (ms):", "%.3f", displayed_frame_time * 1000);
+
+    // CPU time of the main thread's top level zones and of the other threads, as of the last frame.
+    {
+        ProfileFrame * frame = get_profile_frame();
+
+        if(frame->first_root < 0) {
+            add_debug_overlay_row("CPU (ms):", "no zones");
+        } else {
+            add_debug_overlay_row("CPU (ms):", "");
+        }
+
+        if(frame->main_root >= 0) {
+            for(int child = frame->nodes[frame->main_root].first_child; child >= 0; child = frame->nodes[child].next_sibling) {
+                ProfileNode * node = &frame->nodes[child];
+
+                char label[64];
+                snprintf(label, sizeof(label), "  %s", node->name);
+
+                add_debug_overlay_row(label, "%.3f", node->total_time * 1000);
+            }
+        }
+
+        for(int root = frame->first_root; root >= 0; root = frame->nodes[root].next_sibling) {
+            if(root == frame->main_root) continue;
+
+            ProfileNode * node = &frame->nodes[root];
+
+            char label[64];
+            snprintf(label, sizeof(label), "  %s thread", node->name);
+
+            add_debug_overlay_row(label, "%.3f", node->total_time * 1000);
+        }
+    }
+
+    // Last frame's, the one being buffered isn't drawn yet.
+    {
+        RenderStats stats = get_render_stats();
+
+        add_debug_overlay_row("Batches:",            "%d", stats.num_batches);
+        add_debug_overlay_row("Vertices / Indices:", "%d / %d", stats.num_vertices, stats.num_indices);
+        add_debug_overlay_row("Texture Switches:",   "%d", stats.texture_switches);
+    }
+
+    // Averaged like the frame time.
+    {
+        long long allocation_count = get_array_allocation_count();
+
+        if(allocation_count < 0) {
+            add_debug_overlay_row("Array Allocs / Frame:", "n/a");
+        } else {
+            add_debug_overlay_row("Array Allocs / Frame:", "%.1f", (double) (allocation_count - allocation_count_at_update) / FRAME_TIME_UPDATE_DELAY);
+        }
+
+        allocation_count_at_update = allocation_count;
+    }
+
+    add_debug_overlay_row("Textures (MB):", "CPU %.1f / GPU %.1f", texture_manager.cpu_bytes / (1024.0 * 1024.0), texture_manager.gpu_bytes / (1024.0 * 1024.0));
+    add_debug_overlay_row("Sounds (MB):",   "%.1f", audio_manager.cpu_bytes / (1024.0 * 1024.0));
+
+    {
+        char * c_name = to_c_string(current_room->name);
+        scope_exit(free(c_name));
+
+        add_debug_overlay_row("Current World:", "%s", c_name);
+    }
+}
+
 void buffer_debug_overlay() {
+    profile_function();
 
     SpecificFont * normal_font = font_manager.get_font_at_size(my_font, 16.0f);
 
     float DEBUG_OVERLAY_PADDING = 0.004f;
 
-    float DEBUG_OVERLAY_WIDTH = 0.15f;
+    float DEBUG_OVERLAY_WIDTH = 0.3f;
     float DEBUG_OVERLAY_ROW_HEIGHT = DEBUG_OVERLAY_PADDING * 2 * window_data.aspect_ratio + 14.0f / window_data.height; // @Temporary Current distance from baseline to top of capital letter is 12px
 
-    float DEBUG_OVERLAY_NUM_ROWS = 4; // @Harcoded
+    float DEBUG_OVERLAY_GRAPH_HEIGHT = 0.1f;
+
+    // Compute frame time average
+    if(frame_time_print_counter == 0) {
+        displayed_frame_time = summed_frame_rate / FRAME_TIME_UPDATE_DELAY;
+
+        summed_frame_rate = 0.0f;
+        frame_time_print_counter = FRAME_TIME_UPDATE_DELAY;
+
+        update_debug_overlay_rows();
+    }
+
+    summed_frame_rate += window_data.current_dt;
+    frame_time_print_counter--;
+
+    frame_time_graph[frame_time_graph_cursor] = window_data.current_dt;
+    frame_time_graph_cursor = (frame_time_graph_cursor + 1) % FRAME_TIME_GRAPH_LENGTH;
 
     // Buffer debug overlay background
     {
-        for(int i = 0; i < DEBUG_OVERLAY_NUM_ROWS; i++) {
+        for(int i = 0; i < num_debug_overlay_rows; i++) {
             Vector2f position;
 
             position.x = 1.0f - DEBUG_OVERLAY_WIDTH;
@@ -742,51 +904,56 @@ void buffer_debug_overlay() {
 
             buffer_colored_quad(position, TOP_LEFT, DEBUG_OVERLAY_WIDTH, DEBUG_OVERLAY_ROW_HEIGHT, DEBUG_OVERLAY_BACKGROUND_Z, color);
         }
-
     }
 
-    // Compute frame time average
-    if(frame_time_print_counter == 0) {
-        displayed_frame_time = summed_frame_rate / FRAME_TIME_UPDATE_DELAY;
+    // Buffer frame time graph, under the rows. Green bars made the target, yellow ones made half of it.
+    {
+        float graph_top    = 1.0f - num_debug_overlay_rows * DEBUG_OVERLAY_ROW_HEIGHT;
+        float graph_bottom = graph_top - DEBUG_OVERLAY_GRAPH_HEIGHT;
 
-        // log_print("perf_counter", "Average of %d frames is %f", FRAME_TIME_UPDATE_DELAY, displayed_frame_time);
+        buffer_colored_quad(1.0f - DEBUG_OVERLAY_WIDTH, graph_top, TOP_LEFT, DEBUG_OVERLAY_WIDTH, DEBUG_OVERLAY_GRAPH_HEIGHT, DEBUG_OVERLAY_BACKGROUND_Z, { 0.2f, 0.2f, 0.3f, 0.8f });
 
-        summed_frame_rate = 0.0f;
-        frame_time_print_counter = FRAME_TIME_UPDATE_DELAY;
-    }
+        float graph_left   = 1.0f - DEBUG_OVERLAY_WIDTH + DEBUG_OVERLAY_PADDING;
+        float graph_width  = DEBUG_OVERLAY_WIDTH - 2 * DEBUG_OVERLAY_PADDING;
+        float graph_height = DEBUG_OVERLAY_GRAPH_HEIGHT - 2 * DEBUG_OVERLAY_PADDING;
+        float bar_width    = graph_width / FRAME_TIME_GRAPH_LENGTH;
 
-    summed_frame_rate += window_data.current_dt;
-    frame_time_print_counter--;
+        graph_bottom += DEBUG_OVERLAY_PADDING;
 
-    float left_x  = 1.0f - DEBUG_OVERLAY_WIDTH + DEBUG_OVERLAY_PADDING;
-    float right_x = 1.0f - DEBUG_OVERLAY_PADDING;
-    float y       = 1.0f - DEBUG_OVERLAY_ROW_HEIGHT / 2;
-    // Buffer Frame time (text must always be buffered last if it has AA / transparency);
-    {
-        char buffer[64];
+        for(int i = 0; i < FRAME_TIME_GRAPH_LENGTH; i++) {
+            float frame_time = frame_time_graph[(frame_time_graph_cursor + i) % FRAME_TIME_GRAPH_LENGTH];
+            if(frame_time <= 0.0f) continue; // Not there yet.
 
-        snprintf(buffer, sizeof(buffer), "%.3f", displayed_frame_time * 1000);
+            float height = graph_height * (frame_time < FRAME_TIME_GRAPH_MAX ? frame_time / FRAME_TIME_GRAPH_MAX : 1.0f);
 
-        buffer_string("Frame Time (ms):", left_x, y, DEBUG_OVERLAY_Z, normal_font, CENTER_LEFT);
-        y -= DEBUG_OVERLAY_ROW_HEIGHT;
+            Color4f color;
 
-        buffer_string(buffer, right_x, y, DEBUG_OVERLAY_Z, normal_font, CENTER_RIGHT);
-        y -= DEBUG_OVERLAY_ROW_HEIGHT;
-    }
+            if(frame_time <= FRAME_TIME_TARGET) {
+                color = { 0.2f, 0.8f, 0.2f, 0.9f };
+            } else if(frame_time <= FRAME_TIME_TARGET * 2) {
+                color = { 0.9f, 0.8f, 0.2f, 0.9f };
+            } else {
+                color = { 0.9f, 0.2f, 0.2f, 0.9f };
+            }
 
-    // Buffer Current world (text must always be buffered last if it has AA / transparency);
-    {
-        char buffer[64];
-        char * c_name = to_c_string(current_room->name);
-        scope_exit(free(c_name));
+            buffer_colored_quad(graph_left + i * bar_width, graph_bottom, BOTTOM_LEFT, bar_width, height, DEBUG_OVERLAY_Z, color);
+        }
 
-        snprintf(buffer, sizeof(buffer), "%s", c_name);
+        float target_y = graph_bottom + graph_height * FRAME_TIME_TARGET / FRAME_TIME_GRAPH_MAX;
 
-        buffer_string("Current World:", left_x, y, DEBUG_OVERLAY_Z, normal_font, CENTER_LEFT);
+        buffer_colored_quad(graph_left, target_y, BOTTOM_LEFT, graph_width, 0.002f, DEBUG_OVERLAY_Z, { 1.0f, 1.0f, 1.0f, 0.5f });
+    }
 
-        y -= DEBUG_OVERLAY_ROW_HEIGHT;
+    float left_x  = 1.0f - DEBUG_OVERLAY_WIDTH + DEBUG_OVERLAY_PADDING;
+    float right_x = 1.0f - DEBUG_OVERLAY_PADDING;
+    float y       = 1.0f - DEBUG_OVERLAY_ROW_HEIGHT / 2;
 
-        buffer_string(buffer, right_x, y, DEBUG_OVERLAY_Z, normal_font, CENTER_RIGHT);
+    // Buffer rows (text must always be buffered last if it has AA / transparency);
+    for(int i = 0; i < num_debug_overlay_rows; i++) {
+        DebugOverlayRow * row = &debug_overlay_rows[i];
+
+        buffer_string(row->label, left_x,  y, DEBUG_OVERLAY_Z, normal_font, CENTER_LEFT);
+        buffer_string(row->value, right_x, y, DEBUG_OVERLAY_Z, normal_font, CENTER_RIGHT);
 
         y -= DEBUG_OVERLAY_ROW_HEIGHT;
     }
@@ -857,6 +1024,7 @@ void buffer_editor_blocks_overlay(Room * room) {
 }
 
 void buffer_entities() {
+    profile_function();
     for(int i = 0; i< array_size(entities); i++) {
         buffer_entity(entities[i]);
     }
@@ -894,6 +1062,7 @@ void buffer_entity(Entity entity) {
 }
 
 void buffer_tiles(Array<Tile> tiles) {
+    profile_function();
     for_array(tiles.data, tiles.count) {
         Tile * tile = it;
 
@@ -917,111 +1086,59 @@ void buffer_tiles(Array<Tile> tiles) {
 }
 
 
-float buffer_string(String text, float x, float y, float z,  SpecificFont * font, Alignement alignement, Color4f color) { // Default : alignement = BOTTOM_LEFT, color = {1.0f, 1.0f, 1.0f, 1.0f}
-    char * c_text = to_c_string(text);
-    scope_exit(free(c_text));
-
-    return buffer_string(c_text, x, y, z, font, alignement);
+float buffer_string(char * text, float x, float y, float z,  SpecificFont * font, Alignement alignement, Color4f color) { // Default : alignement = BOTTOM_LEFT, color = {1.0f, 1.0f, 1.0f, 1.0f}
+    return buffer_string(to_string(text), x, y, z, font, alignement, color);
 }
 
 // @Incomplete. Use is_out_of_screen once the width and height are computed.
-float buffer_string(char * text, float x, float y, float z,  SpecificFont * font, Alignement alignement, Color4f color) { // Default : alignement = BOTTOM_LEFT, color = {1.0f, 1.0f, 1.0f, 1.0f}
+float buffer_string(String text, float x, float y, float z,  SpecificFont * font, Alignement alignement, Color4f color) { // Default : alignement = BOTTOM_LEFT, color = {1.0f, 1.0f, 1.0f, 1.0f}
+    TextLayout * layout = get_text_layout(font, text.data, text.count);
 
     float pixel_x = x * window_data.width;
     float pixel_y = y * window_data.height;
 
-    float text_width = 0.0f;
-    float text_height = 0.0f;
-
-    // Compute height
     if(alignement == TOP_RIGHT || alignement == TOP_LEFT || alignement == TOP_CENTER) {
-        float zero_x = 0.0f;
-        float zero_y = 0.0f;
-
-        stbtt_aligned_quad q;
-        stbtt_GetBakedQuad(font->char_data, font->texture->width, font->texture->height, 'A' - 32, &zero_x, &zero_y, &q, 1); // 'A' is used as a reference character
-
-        text_height = (float) ((int)(q.y0 + 0.5f)) / window_data.height;
-
-        pixel_y += text_height * window_data.height;
+        pixel_y += layout->reference_y;
     }
 
     if(alignement == CENTER_RIGHT || alignement == CENTER_LEFT || alignement == CENTER) { // Horizontal centering
-        float zero_x = 0.0f;
-        float zero_y = 0.0f;
-
-        stbtt_aligned_quad q;
-        stbtt_GetBakedQuad(font->char_data, font->texture->width, font->texture->height, 'A' - 32, &zero_x, &zero_y, &q, 1); // 'A' is used as a reference character
-
-        text_height = (float) ((int)(q.y0 + 0.5f)) / window_data.height;
-
-        pixel_y += text_height * window_data.height / 2;
+        pixel_y += layout->reference_y / 2;
     }
 
-    // Compute width
-    {
-        float zero_x = 0.0f;
-        float zero_y = 0.0f;
-
-        char * cursor = text;
+    if((alignement == TOP_RIGHT) || (alignement == BOTTOM_RIGHT) || (alignement == CENTER_RIGHT)) {
+        pixel_x -= layout->width;
+    }
 
-        while (*cursor) {
-            // Make sure it's an ascii character // @Incomplete
-            if (*cursor >= 32 && *cursor < 128) {
-                stbtt_aligned_quad q;
-                stbtt_GetBakedQuad(font->char_data, font->texture->width, font->texture->height, *cursor - ' ', &zero_x, &zero_y, &q, 1);
-            }
-            ++cursor;
-        }
+    if((alignement == TOP_CENTER) || (alignement == BOTTOM_CENTER) || (alignement == CENTER)) {
+        pixel_x -= layout->width / 2;
+    }
 
-        text_width = (float) ((int)(zero_x + 0.5f)) / window_data.width;
+    // Bitmap glyphs were laid out on whole pixels, keep them there.
+    if(!font->sdf) {
+        pixel_x = floorf(pixel_x + 0.5f);
+        pixel_y = floorf(pixel_y + 0.5f);
     }
 
     set_texture(font->texture);
-    set_shader(font_shader);
+    set_shader(font->sdf ? sdf_font_shader : font_shader);
 
     start_buffer();
 
-    while(*text) {
-        // Make sure it's an ascii character
-        if (*text >= 32 && *text < 128) {
-            stbtt_aligned_quad q;
-            stbtt_GetBakedQuad(font->char_data, font->texture->width, font->texture->height, *text-32, &pixel_x, &pixel_y, &q, 1);
-
-
-            // top > bottom
-            float height_above_bl = q.y1 - pixel_y;
-            float height_below_bl = q.y0 - pixel_y;
-
-            float inverted_y_top   = (int)((pixel_y - height_below_bl) + 0.5f);
-            float inverted_y_below = (int)((pixel_y - height_above_bl) + 0.5f);
-
-            float x0 = q.x0            / window_data.width;
-            float y0 = inverted_y_below/ window_data.height;
-            float x1 = q.x1            / window_data.width;
-            float y1 = inverted_y_top  / window_data.height;
-
-            if((alignement == TOP_RIGHT) || (alignement == BOTTOM_RIGHT) || (alignement == CENTER_RIGHT)) {
-                x0 -= text_width;
-                x1 -= text_width;
-            }
-
-            if((alignement == TOP_CENTER) || (alignement == BOTTOM_CENTER) || (alignement == CENTER)) {
-                x0 -= text_width/2;
-                x1 -= text_width/2;
-            }
+    for_array(layout->quads.data, layout->quads.count) {
+        float x0 = (pixel_x + it->x0) / window_data.width;
+        float y0 = (pixel_y + it->y0) / window_data.height;
+        float x1 = (pixel_x + it->x1) / window_data.width;
+        float y1 = (pixel_y + it->y1) / window_data.height;
 
-            add_vertex(x0, y0, z, q.s0, q.t1, color);
-            add_vertex(x0, y1, z, q.s0, q.t0, color);
-            add_vertex(x1, y0, z, q.s1, q.t1, color);
-            add_vertex(x1, y1, z, q.s1, q.t0, color);
-        }
-        ++text;
+        add_vertex(x0, y0, z, it->s0, it->t1, color);
+        add_vertex(x0, y1, z, it->s0, it->t0, color);
+        add_vertex(x1, y0, z, it->s1, it->t1, color);
+        add_vertex(x1, y1, z, it->s1, it->t0, color);
     }
 
     end_buffer();
 
-    return text_width;
+    return layout->width / window_data.width;
 }
 
 
@@ -1112,27 +1229,48 @@ void update_time() {
 }
 
 void init_managers(){
+    texture_manager.memory_budget            = TEXTURE_MEMORY_BUDGET;
+    texture_manager.release_uploaded_bitmaps = true;
+
+    font_manager.use_sdf = SDF_FONTS;
+
     texture_manager.init();
     shader_manager.init();
     font_manager.init(&texture_manager);
     room_manager.init();
+    audio_manager.init();
 
     register_manager(&texture_manager);
     register_manager(&font_manager);
     register_manager(&shader_manager);
     register_manager(&room_manager);
+    register_manager(&audio_manager);
 
     managers.add(&texture_manager);
     managers.add(&shader_manager);
     managers.add(&font_manager);
     managers.add(&room_manager);
+    managers.add(&audio_manager);
 }
 
-void main() {
+int main(int argc, char * argv[]) {
     scope_exit(printf("Exiting."));
 
     os_specific_init_clock();
 
+    set_profiler_thread_name("main");
+
+    // /capture traces the first frames, loading included, as F4 would later on.
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "/capture") == 0) {
+#ifdef PERF_MON
+            start_profile_capture((char *) PROFILE_CAPTURE_PATH);
+#else
+            log_print("profiler", "/capture needs a build with PERF_MON, this one has no zones");
+#endif
+        }
+    }
+
     // Init window
     {
         window_data.width  = 960;
@@ -1147,20 +1285,30 @@ void main() {
         window_data.handle = os_specific_create_window(window_data.width, window_data.height, window_name);
     }
 
-    win32_init_sound_player(window_data.handle);
+    os_specific_init_sound_player(window_data.handle);
 
     init_renderer(window_data.width, window_data.height, window_data.handle); // Has to happen before we load the shaders
 
+    init_job_system();
+
     init_managers();
 
-    init_hotloader();
+    set_texture_manager(&texture_manager);
 
-    hotloader_register_loose_files();
+    // Shipping builds come with a pack, and there is nothing to hotload in there.
+    if(open_pack_file("data.pack")) {
+        hotloader_register_packed_files();
+    } else {
+        init_hotloader();
+        hotloader_register_loose_files();
+    }
 
     for_array(managers.data, managers.count) {
         (*it)->perform_reloads();
     }
 
+    wait_for_all_jobs(); // Everything has to be there before the game starts.
+
     init_shaders();
 
     init_game();
@@ -1169,7 +1317,6 @@ void main() {
 
     log_print("perf_counter", "Startup time : %.3f seconds", os_specific_get_time());
 
-    win32_play_sound_wave(400);
     bool test = false;
     bool should_quit = false;
     while(!should_quit) {
@@ -1184,14 +1331,37 @@ void main() {
 
         draw_frame(window_data.locked_fps);
 
-        //win32_play_sounds(window_data.current_dt);
+        {
+            profile_zone("end_of_frame");
 
+            texture_manager.update_residency();
+            next_glyph_cache_frame();
+            next_text_layout_frame();
+        }
 
+        {
+            profile_zone("reloads");
+
+            check_hotloader_modifications();
+            texture_manager.perform_reloads();
+            font_manager.perform_reloads();
+            shader_manager.perform_reloads();
+            room_manager.perform_reloads();
+            audio_manager.perform_reloads();
+        }
 
-        check_hotloader_modifications();
-        texture_manager.perform_reloads();
-        // font_manager.perform_reloads(); // @Incomplete: make sure this works
-        shader_manager.perform_reloads();
-        room_manager.perform_reloads();
+        audio_manager.update_streams();
+
+        run_finished_jobs();
+
+        next_profiler_frame();
     }
+
+#ifdef PERF_MON
+    print_profile_frame(get_profile_frame()); // How the last frame went, for a quick look without the overlay.
+#endif
+
+    shutdown_hotloader(); // Joins the watcher thread, before anything it could still be touching goes away.
+    os_specific_shutdown_sound_player();
+    shutdown_job_system();
 }
@@ -0,0 +1,545 @@
+#include <limits.h>
+#include <math.h>
+
+#include "glyph_cache.h"
+#include "font_manager.h"
+#include "texture_manager.h"
+#include "hash.h"
+#include "macros.h"
+
+// One stretch of the skyline: the pixels [x, x + width) of the page are taken up to y.
+struct SkylineNode {
+    int x;
+    int y;
+    int width;
+};
+
+struct AtlasPage {
+    int top; // First row of the page in the atlas
+
+    Array<SkylineNode> skyline; // Left to right, covers the whole width.
+
+    int last_used_frame; // -1 if nothing was ever asked from it
+};
+
+// Private functions
+static bool find_space(int width, int height, int * page, int * x, int * y);
+static bool find_space_in_page(AtlasPage * page, int width, int height, int * x, int * y, int * node_index);
+static void add_skyline_node(AtlasPage * page, int node_index, int x, int y, int width, int height);
+static void clear_page(int page);
+
+static int find_glyph_slot(SpecificFont * font, int codepoint);
+static void rebuild_glyph_index();
+
+static unsigned int get_glyph_hash(SpecificFont * font, int codepoint);
+
+static void get_sdf_glyph_box(stbtt_fontinfo * info, int codepoint, float scale, int * x0, int * y0, int * x1, int * y1);
+static void make_sdf_glyph(stbtt_fontinfo * info, int codepoint, float scale, int x0, int y0, int width, int height, unsigned char * destination, int stride);
+static void distance_transform(float * grid, int width, int height);
+static void distance_transform_1d(float * f, int count, int stride, float * distances, int * parabolas, float * boundaries);
+
+// Const
+const int GLYPH_ATLAS_WIDTH  = 1024;
+const int GLYPH_ATLAS_HEIGHT = 1024;
+
+const int NUM_ATLAS_PAGES   = 4;
+const int ATLAS_PAGE_HEIGHT = GLYPH_ATLAS_HEIGHT / NUM_ATLAS_PAGES;
+
+const int GLYPH_PADDING = 1; // Empty pixels around every glyph, so bilinear filtering doesn't pick up the neighbours.
+
+const int MIN_GLYPH_INDEX_SIZE = 256; // Has to be a power of two.
+
+// SDF glyphs get rasterized this many times bigger, and the distances measured there, then averaged back down.
+const int SDF_OVERSAMPLE = 4;
+
+// How far from the outline the distance field goes, in pixels of the SDF glyph. Values go from 255 inside, through
+// 128 on the outline, to 0 outside at this distance. The glyphs get this many extra pixels on every side.
+const int SDF_SPREAD = 4;
+
+const float SDF_INFINITY = 1e20f;
+
+// Globals
+static Texture * atlas; // A8, keeps its bitmap, we write the glyphs in there and upload the rect they cover.
+
+static AtlasPage pages[NUM_ATLAS_PAGES];
+
+static Array<CachedGlyph> glyphs;
+
+// Open addressing, indices in glyphs, -1 for empty slots. Never more than half full.
+static int * glyph_index;
+static int   glyph_index_size;
+
+static int current_frame;
+static int generation;
+
+void init_glyph_cache(TextureManager * texture_manager) {
+    unsigned char * bitmap = (unsigned char *) calloc(GLYPH_ATLAS_WIDTH * GLYPH_ATLAS_HEIGHT, 1);
+
+    atlas = texture_manager->create_texture(to_string("glyph_atlas"), bitmap, GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_HEIGHT, 1);
+
+    for(int i = 0; i < NUM_ATLAS_PAGES; i++) {
+        pages[i].top             = i * ATLAS_PAGE_HEIGHT;
+        pages[i].skyline         = {};
+        pages[i].last_used_frame = -1;
+
+        pages[i].skyline.add({0, 0, GLYPH_ATLAS_WIDTH});
+    }
+
+    rebuild_glyph_index();
+}
+
+Texture * get_glyph_atlas() {
+    return atlas;
+}
+
+CachedGlyph get_glyph(SpecificFont * font, int codepoint) {
+    int slot = find_glyph_slot(font, codepoint);
+
+    if(glyph_index[slot] >= 0) {
+        CachedGlyph * glyph = &glyphs.data[glyph_index[slot]];
+
+        if(glyph->page != NO_GLYPH_PAGE) pages[glyph->page].last_used_frame = current_frame;
+
+        return *glyph;
+    }
+
+    stbtt_fontinfo * info = &font->font->info;
+    float scale = font->scale;
+
+    CachedGlyph glyph = {};
+    glyph.font      = font;
+    glyph.codepoint = codepoint;
+    glyph.page      = NO_GLYPH_PAGE;
+
+    int advance;
+    stbtt_GetCodepointHMetrics(info, codepoint, &advance, NULL);
+    glyph.advance = advance * scale;
+
+    int x0, y0, x1, y1;
+
+    if(font->sdf) {
+        get_sdf_glyph_box(info, codepoint, scale, &x0, &y0, &x1, &y1);
+    } else {
+        stbtt_GetCodepointBitmapBox(info, codepoint, scale, scale, &x0, &y0, &x1, &y1);
+    }
+
+    glyph.x_offset = x0;
+    glyph.y_offset = y0;
+
+    int width  = x1 - x0;
+    int height = y1 - y0;
+
+    if(width > 0 && height > 0) {
+        int page, x, y;
+
+        if(!find_space(width + 2 * GLYPH_PADDING, height + 2 * GLYPH_PADDING, &page, &x, &y)) {
+            return glyph; // Nothing to draw this time, don't remember it.
+        }
+
+        glyph.page   = page;
+        glyph.x      = x + GLYPH_PADDING;
+        glyph.y      = pages[page].top + y + GLYPH_PADDING;
+        glyph.width  = width;
+        glyph.height = height;
+
+        unsigned char * destination = atlas->bitmap + glyph.y * GLYPH_ATLAS_WIDTH + glyph.x;
+
+        if(font->sdf) {
+            make_sdf_glyph(info, codepoint, scale, x0, y0, width, height, destination, GLYPH_ATLAS_WIDTH);
+        } else {
+            stbtt_MakeCodepointBitmap(info, destination, width, height, GLYPH_ATLAS_WIDTH, scale, scale, codepoint);
+        }
+
+        mark_texture_region_dirty(atlas, glyph.x, glyph.y, width, height);
+
+        pages[page].last_used_frame = current_frame;
+
+        slot = find_glyph_slot(font, codepoint); // find_space can clear a page, which moves the glyphs around.
+    }
+
+    glyph_index[slot] = glyphs.count;
+    glyphs.add(glyph);
+
+    if(glyphs.count * 2 > glyph_index_size) rebuild_glyph_index();
+
+    return glyph;
+}
+
+void remove_glyphs(SpecificFont * font) {
+    int kept = 0;
+
+    for_array(glyphs.data, glyphs.count) {
+        if(it->font == font) for_array_continue;
+
+        glyphs.data[kept] = *it;
+        kept += 1;
+    }
+
+    glyphs.count = kept;
+    generation  += 1;
+
+    rebuild_glyph_index();
+}
+
+void next_glyph_cache_frame() {
+    current_frame += 1;
+}
+
+int get_glyph_cache_generation() {
+    return generation;
+}
+
+void use_glyph_pages(unsigned int page_mask) {
+    for(int i = 0; i < NUM_ATLAS_PAGES; i++) {
+        if(page_mask & (1 << i)) pages[i].last_used_frame = current_frame;
+    }
+}
+
+// Tries every page before clearing one, the page used the longest ago.
+static bool find_space(int width, int height, int * page, int * x, int * y) {
+    if(width > GLYPH_ATLAS_WIDTH || height > ATLAS_PAGE_HEIGHT) {
+        log_print("glyph_cache", "A %dx%d glyph can't fit in a %dx%d atlas page", width, height, GLYPH_ATLAS_WIDTH, ATLAS_PAGE_HEIGHT);
+        return false;
+    }
+
+    int best_page  = -1;
+    int best_x     = 0;
+    int best_y     = 0;
+    int best_node  = 0;
+
+    for(int i = 0; i < NUM_ATLAS_PAGES; i++) {
+        int page_x, page_y, node;
+
+        if(!find_space_in_page(&pages[i], width, height, &page_x, &page_y, &node)) continue;
+
+        if(best_page < 0 || page_y < best_y) {
+            best_page = i;
+            best_x    = page_x;
+            best_y    = page_y;
+            best_node = node;
+        }
+    }
+
+    if(best_page < 0) {
+        int oldest = -1;
+
+        for(int i = 0; i < NUM_ATLAS_PAGES; i++) {
+            if(pages[i].last_used_frame == current_frame) continue; // We already buffered quads that sample it.
+
+            if(oldest < 0 || pages[i].last_used_frame < pages[oldest].last_used_frame) oldest = i;
+        }
+
+        if(oldest < 0) {
+            log_print("glyph_cache", "The glyph atlas is full of glyphs used this frame, some text won't show");
+            return false;
+        }
+
+        clear_page(oldest);
+
+        best_page = oldest;
+        find_space_in_page(&pages[oldest], width, height, &best_x, &best_y, &best_node); // Can't fail, it's empty.
+    }
+
+    add_skyline_node(&pages[best_page], best_node, best_x, best_y, width, height);
+
+    *page = best_page;
+    *x    = best_x;
+    *y    = best_y;
+
+    return true;
+}
+
+// Skyline bottom left, with the skyline growing down from the top of the page: the spot where the bottom of the rect
+// ends up the closest to the top, the narrowest stretch of skyline on ties.
+static bool find_space_in_page(AtlasPage * page, int width, int height, int * x, int * y, int * node_index) {
+    int best_top   = INT_MAX;
+    int best_width = INT_MAX;
+
+    bool found = false;
+
+    for(int i = 0; i < page->skyline.count; i++) {
+        SkylineNode * node = &page->skyline.data[i];
+
+        if(node->x + width > GLYPH_ATLAS_WIDTH) break;
+
+        // The rect sits on the highest node it spans.
+        int top       = 0;
+        int remaining = width;
+
+        for(int j = i; remaining > 0; j++) {
+            SkylineNode * spanned = &page->skyline.data[j];
+
+            if(spanned->y > top) top = spanned->y;
+            remaining -= spanned->width;
+        }
+
+        if(top + height > ATLAS_PAGE_HEIGHT) continue;
+
+        if(top + height < best_top || (top + height == best_top && node->width < best_width)) {
+            best_top   = top + height;
+            best_width = node->width;
+
+            *x          = node->x;
+            *y          = top;
+            *node_index = i;
+
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+static void add_skyline_node(AtlasPage * page, int node_index, int x, int y, int width, int height) {
+    Array<SkylineNode> * skyline = &page->skyline;
+
+    // Insert, the skyline has to stay sorted.
+    skyline->add({});
+    memmove(&skyline->data[node_index + 1], &skyline->data[node_index], (skyline->count - 1 - node_index) * sizeof(SkylineNode));
+
+    skyline->data[node_index] = {x, y + height, width};
+
+    // Trim or remove the nodes the new one covers.
+    int right = x + width;
+    int i = node_index + 1;
+
+    while(i < skyline->count && skyline->data[i].x < right) {
+        SkylineNode * node = &skyline->data[i];
+
+        int covered = right - node->x;
+
+        if(covered < node->width) {
+            node->x     += covered;
+            node->width -= covered;
+            break;
+        }
+
+        memmove(&skyline->data[i], &skyline->data[i + 1], (skyline->count - 1 - i) * sizeof(SkylineNode));
+        skyline->count -= 1;
+    }
+
+    // Merge the neighbours at the same height.
+    i = 0;
+
+    while(i < skyline->count - 1) {
+        SkylineNode * node = &skyline->data[i];
+        SkylineNode * next = &skyline->data[i + 1];
+
+        if(node->y != next->y) {
+            i += 1;
+            continue;
+        }
+
+        node->width += next->width;
+
+        memmove(next, next + 1, (skyline->count - 2 - i) * sizeof(SkylineNode));
+        skyline->count -= 1;
+    }
+}
+
+// Forgets every glyph in it and zeroes its pixels, the padding around new glyphs has to be empty.
+static void clear_page(int page) {
+    AtlasPage * atlas_page = &pages[page];
+
+    atlas_page->skyline.reset();
+    atlas_page->skyline.add({0, 0, GLYPH_ATLAS_WIDTH});
+
+    memset(atlas->bitmap + atlas_page->top * GLYPH_ATLAS_WIDTH, 0, ATLAS_PAGE_HEIGHT * GLYPH_ATLAS_WIDTH);
+    mark_texture_region_dirty(atlas, 0, atlas_page->top, GLYPH_ATLAS_WIDTH, ATLAS_PAGE_HEIGHT);
+
+    int kept = 0;
+
+    for_array(glyphs.data, glyphs.count) {
+        if(it->page == page) for_array_continue;
+
+        glyphs.data[kept] = *it;
+        kept += 1;
+    }
+
+    glyphs.count = kept;
+    generation  += 1;
+
+    rebuild_glyph_index();
+}
+
+// The slot holding the glyph, or the empty slot where it would go.
+static int find_glyph_slot(SpecificFont * font, int codepoint) {
+    int mask = glyph_index_size - 1;
+    int slot = get_glyph_hash(font, codepoint) & mask;
+
+    while(glyph_index[slot] >= 0) {
+        CachedGlyph * glyph = &glyphs.data[glyph_index[slot]];
+
+        if(glyph->font == font && glyph->codepoint == codepoint) break;
+
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+// Sized for the glyphs we have, with room to grow.
+static void rebuild_glyph_index() {
+    int size = MIN_GLYPH_INDEX_SIZE;
+    while(size < glyphs.count * 4) size *= 2;
+
+    if(size != glyph_index_size) {
+        free(glyph_index);
+
+        glyph_index      = (int *) malloc(size * sizeof(int));
+        glyph_index_size = size;
+    }
+
+    memset(glyph_index, 0xff, size * sizeof(int)); // -1
+
+    for(int i = 0; i < glyphs.count; i++) {
+        int slot = find_glyph_slot(glyphs.data[i].font, glyphs.data[i].codepoint);
+        glyph_index[slot] = i;
+    }
+}
+
+static unsigned int get_glyph_hash(SpecificFont * font, int codepoint) {
+    unsigned long long key[2] = {(unsigned long long) font, (unsigned long long) codepoint};
+
+    return murmur_hash_2(key, sizeof(key), 0);
+}
+
+// The bitmap box of the oversampled glyph brought back to scale, grown by the spread. Empty for glyphs with no shape.
+static void get_sdf_glyph_box(stbtt_fontinfo * info, int codepoint, float scale, int * x0, int * y0, int * x1, int * y1) {
+    float big_scale = scale * SDF_OVERSAMPLE;
+
+    int big_x0, big_y0, big_x1, big_y1;
+    stbtt_GetCodepointBitmapBox(info, codepoint, big_scale, big_scale, &big_x0, &big_y0, &big_x1, &big_y1);
+
+    if(big_x1 <= big_x0 || big_y1 <= big_y0) {
+        *x0 = *y0 = *x1 = *y1 = 0;
+        return;
+    }
+
+    *x0 = (int) floorf(big_x0 / (float) SDF_OVERSAMPLE) - SDF_SPREAD;
+    *y0 = (int) floorf(big_y0 / (float) SDF_OVERSAMPLE) - SDF_SPREAD;
+    *x1 = (int) ceilf (big_x1 / (float) SDF_OVERSAMPLE) + SDF_SPREAD;
+    *y1 = (int) ceilf (big_y1 / (float) SDF_OVERSAMPLE) + SDF_SPREAD;
+}
+
+// stb_truetype has no SDF of its own in our version. We rasterize the glyph SDF_OVERSAMPLE times bigger, take the
+// exact euclidean distance from every pixel to the closest pixel on the other side of the outline, and average the
+// signed distances down to the box get_sdf_glyph_box gave.
+static void make_sdf_glyph(stbtt_fontinfo * info, int codepoint, float scale, int x0, int y0, int width, int height, unsigned char * destination, int stride) {
+    float big_scale = scale * SDF_OVERSAMPLE;
+
+    int big_width  = width  * SDF_OVERSAMPLE;
+    int big_height = height * SDF_OVERSAMPLE;
+    int big_count  = big_width * big_height;
+
+    int big_x0, big_y0, big_x1, big_y1;
+    stbtt_GetCodepointBitmapBox(info, codepoint, big_scale, big_scale, &big_x0, &big_y0, &big_x1, &big_y1);
+
+    unsigned char * coverage = (unsigned char *) calloc(big_count, 1);
+    scope_exit(free(coverage));
+
+    int offset = (big_y0 - y0 * SDF_OVERSAMPLE) * big_width + (big_x0 - x0 * SDF_OVERSAMPLE);
+    stbtt_MakeCodepointBitmap(info, coverage + offset, big_x1 - big_x0, big_y1 - big_y0, big_width, big_scale, big_scale, codepoint);
+
+    // Squared distances to the closest pixel inside, and to the closest one outside.
+    float * to_inside  = (float *) malloc(big_count * sizeof(float));
+    float * to_outside = (float *) malloc(big_count * sizeof(float));
+    scope_exit(free(to_inside));
+    scope_exit(free(to_outside));
+
+    for(int i = 0; i < big_count; i++) {
+        bool inside = coverage[i] >= 128;
+
+        to_inside[i]  = inside ? 0 : SDF_INFINITY;
+        to_outside[i] = inside ? SDF_INFINITY : 0;
+    }
+
+    distance_transform(to_inside,  big_width, big_height);
+    distance_transform(to_outside, big_width, big_height);
+
+    for(int y = 0; y < height; y++) {
+        for(int x = 0; x < width; x++) {
+            float sum = 0;
+
+            for(int sample_y = 0; sample_y < SDF_OVERSAMPLE; sample_y++) {
+                for(int sample_x = 0; sample_x < SDF_OVERSAMPLE; sample_x++) {
+                    int i = (y * SDF_OVERSAMPLE + sample_y) * big_width + x * SDF_OVERSAMPLE + sample_x;
+
+                    // The outline runs between pixel centers, half a pixel from either side. Positive outside.
+                    if(to_inside[i] > 0) {
+                        sum += sqrtf(to_inside[i]) - 0.5f;
+                    } else {
+                        sum -= sqrtf(to_outside[i]) - 0.5f;
+                    }
+                }
+            }
+
+            float distance = sum / (SDF_OVERSAMPLE * SDF_OVERSAMPLE) / SDF_OVERSAMPLE; // In pixels of the SDF glyph
+
+            float value = 0.5f - distance / (2 * SDF_SPREAD);
+            if(value < 0) value = 0;
+            if(value > 1) value = 1;
+
+            destination[y * stride + x] = (unsigned char) (value * 255 + 0.5f);
+        }
+    }
+}
+
+// In place, squared distances: every column, then every row.
+static void distance_transform(float * grid, int width, int height) {
+    int longest = width > height ? width : height;
+
+    float * distances  = (float *) malloc(longest * sizeof(float));
+    int   * parabolas  = (int   *) malloc(longest * sizeof(int));
+    float * boundaries = (float *) malloc((longest + 1) * sizeof(float));
+    scope_exit(free(distances));
+    scope_exit(free(parabolas));
+    scope_exit(free(boundaries));
+
+    for(int x = 0; x < width; x++) {
+        distance_transform_1d(grid + x, height, width, distances, parabolas, boundaries);
+    }
+
+    for(int y = 0; y < height; y++) {
+        distance_transform_1d(grid + y * width, width, 1, distances, parabolas, boundaries);
+    }
+}
+
+// Felzenszwalb and Huttenlocher: the lower envelope of the parabolas rooted at every sample, f[q] + (p - q)^2.
+static void distance_transform_1d(float * f, int count, int stride, float * distances, int * parabolas, float * boundaries) {
+    int k = 0;
+
+    parabolas[0]  = 0;
+    boundaries[0] = -SDF_INFINITY;
+    boundaries[1] =  SDF_INFINITY;
+
+    for(int q = 1; q < count; q++) {
+        float f_q = f[q * stride];
+        float s;
+
+        // Drop the parabolas the new one hides. The first boundary is -infinity, so k never goes below 0.
+        while(true) {
+            int p = parabolas[k];
+            s = ((f_q + q * q) - (f[p * stride] + p * p)) / (2.0f * (q - p));
+
+            if(s > boundaries[k]) break;
+            k -= 1;
+        }
+
+        k += 1;
+        parabolas[k]      = q;
+        boundaries[k]     = s;
+        boundaries[k + 1] = SDF_INFINITY;
+    }
+
+    k = 0;
+
+    for(int q = 0; q < count; q++) {
+        while(boundaries[k + 1] < q) k += 1;
+
+        int p = parabolas[k];
+        distances[q] = (q - p) * (q - p) + f[p * stride];
+    }
+
+    for(int q = 0; q < count; q++) f[q * stride] = distances[q];
+}
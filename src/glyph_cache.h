@@ -0,0 +1,51 @@
+#pragma once
+
+// Glyphs get rasterized the first time they're asked for, any size and any codepoint the font has, into one atlas
+// that every font shares. The atlas is split in pages, each packed with a skyline, and when nothing fits anymore the
+// page that was used the longest ago is cleared. Pages used this frame are never cleared, the quads we already
+// buffered point into them.
+
+struct Texture;
+struct TextureManager;
+struct SpecificFont;
+
+struct CachedGlyph {
+    SpecificFont * font;
+    int codepoint;
+
+    int page; // NO_GLYPH_PAGE if there is nothing to draw (spaces)
+
+    // In the atlas, in pixels, padding excluded.
+    int x;
+    int y;
+    int width;
+    int height;
+
+    // From the pen position on the baseline to the top left of the bitmap, in pixels, y down.
+    int x_offset;
+    int y_offset;
+
+    float advance; // In pixels
+};
+
+const int NO_GLYPH_PAGE = -1;
+
+void init_glyph_cache(TextureManager * texture_manager);
+
+Texture * get_glyph_atlas();
+
+// Rasterizes it if it isn't there yet. The metrics are always filled, but width and height are 0 if the glyph didn't
+// fit anywhere, in which case we try again next time.
+CachedGlyph get_glyph(SpecificFont * font, int codepoint);
+
+// When a font reloads. Their space in the atlas stays taken until their page gets cleared.
+void remove_glyphs(SpecificFont * font);
+
+// Once per frame, after drawing.
+void next_glyph_cache_frame();
+
+// Changes whenever glyphs leave the atlas. Whatever kept atlas coordinates from an older generation has to get them again.
+int get_glyph_cache_generation();
+
+// For quads kept from an earlier frame: their pages can't be cleared this frame. Bit n is page n.
+void use_glyph_pages(unsigned int page_mask);
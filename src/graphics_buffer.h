@@ -3,8 +3,6 @@
 #include "array.h"
 #include "math_m.h"
 
-enum BufferMode;
-
 struct Shader;
 struct DrawBatch;
 struct DrawBatchInfo;
@@ -40,3 +38,10 @@ struct DrawBatch {
 	DrawBatchInfo info;
 };
 
+struct RenderStats {
+    int num_batches; // One draw call each.
+    int num_vertices;
+    int num_indices;
+
+    int texture_switches; // Batches drawn with another texture than the last textured one.
+};
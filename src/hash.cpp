@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "hash.h"
 
 //-----------------------------------------------------------------------------
@@ -64,11 +66,62 @@ unsigned int murmur_hash_2 ( const void * key, int len, unsigned int seed )
 
 	return h;
 }
+
+//-----------------------------------------------------------------------------
+// MurmurHash64A, by Austin Appleby
+
+// 64-bit version for 64-bit platforms, used for file contents where a 32 bit
+// hash would collide too often. Same limitations as above, except that reads
+// go through memcpy so the key doesn't need to be aligned.
+
+unsigned long long murmur_hash_64a ( const void * key, int len, unsigned long long seed )
+{
+	const unsigned long long m = 0xc6a4a7935bd1e995ULL;
+	const int r = 47;
+
+	unsigned long long h = seed ^ (len * m);
+
+	const unsigned char * data = (const unsigned char *)key;
+	const unsigned char * end  = data + (len / 8) * 8;
+
+	while(data != end)
+	{
+		unsigned long long k;
+		memcpy(&k, data, sizeof(k));
+
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+
+		data += 8;
+	}
+
+	switch(len & 7)
+	{
+	case 7: h ^= (unsigned long long)(data[6]) << 48;
+	case 6: h ^= (unsigned long long)(data[5]) << 40;
+	case 5: h ^= (unsigned long long)(data[4]) << 32;
+	case 4: h ^= (unsigned long long)(data[3]) << 24;
+	case 3: h ^= (unsigned long long)(data[2]) << 16;
+	case 2: h ^= (unsigned long long)(data[1]) << 8;
+	case 1: h ^= (unsigned long long)(data[0]);
+	        h *= m;
+	};
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+
+	return h;
+}
 //-----------------------------------------------------------------------------
 
 // @License
 
-// Murmur Hash 2.0:
+// Murmur Hash 2.0 and MurmurHash64A:
 	// Copyright (c) <year> <copyright holders>
 
 	// Permission is hereby granted, free of charge, to any person obtaining a copy
@@ -1 +1,4 @@
+#pragma once
+
 unsigned int murmur_hash_2 (const void * key, int len, unsigned int seed);
+unsigned long long murmur_hash_64a (const void * key, int len, unsigned long long seed);
@@ -0,0 +1,193 @@
+// Platform independent part of the hotloader. The platform backends (os/<platform>/hotloader.cpp) run a thread that
+// watches the data directory and pushes the paths that changed with push_asset_change, the main thread picks them up
+// in check_hotloader_modifications.
+
+#include "hotloader.h"
+#include "asset_manager.h"
+#include "macros.h"
+#include "spsc_queue.h"
+#include "pack_file.h"
+#include "os/layer.h"
+
+struct AssetChange {
+    Asset asset;
+
+    double last_event_time; // Pushed back every time the file is touched again, see dispatch_settled_asset_changes.
+};
+
+// Private functions
+static void queue_asset_change(AssetChange change);
+
+static void dispatch_settled_asset_changes();
+
+static void register_files(Array<char *> files);
+
+// Const
+// Editors usually touch a file several times when saving it (PS writes the PNG, then its attributes, sometimes
+// through a temporary file). We wait until a file has been quiet for that long before reloading it, so that it only
+// gets reloaded once.
+const double COALESCING_WINDOW = 0.1; // in seconds
+
+const int CHANGE_QUEUE_LENGTH = 1024; // Has to be a power of two.
+
+// Globals
+static Array<AssetManager *> managers;
+
+static SPSCQueue<AssetChange> change_queue; // Watcher thread -> main thread
+
+static Array<AssetChange> asset_changes; // Main thread only, waiting for their file to settle.
+
+void release(AssetChange * ac) {
+    free(ac->asset.full_path.data);
+}
+
+void init_hotloader() {
+    change_queue.init(CHANGE_QUEUE_LENGTH);
+
+    if(!start_hotloader_thread()) {
+        log_print("init_hotloader", "Failed to start the hotloader thread, hotloading is disabled.");
+    }
+}
+
+void shutdown_hotloader() {
+    stop_hotloader_thread();
+
+    AssetChange change;
+    while(change_queue.pop(&change)) {
+        release(&change);
+    }
+
+    for_array(asset_changes.data, asset_changes.count) {
+        release(it);
+    }
+    asset_changes.reset(true);
+
+    change_queue.release();
+}
+
+void register_manager(AssetManager * am) {
+    managers.add(am);
+}
+
+// Called from the watcher thread. Takes ownership of asset.full_path.data.
+void push_asset_change(Asset asset) {
+    AssetChange change;
+    change.asset           = asset;
+    change.last_event_time = os_specific_get_time();
+
+    // The main thread empties the queue every frame, so this only happens on huge bursts. Waiting is fine, we're not
+    // on the main thread, but dropping the change is not.
+    while(!change_queue.push(change)) {
+        os_specific_sleep(1);
+    }
+}
+
+// This is all the main thread does every frame, when nothing changed it's a single atomic load.
+void check_hotloader_modifications() {
+    AssetChange change;
+    while(change_queue.pop(&change)) {
+        queue_asset_change(change);
+    }
+
+    dispatch_settled_asset_changes();
+}
+
+static void queue_asset_change(AssetChange change) {
+    for_array(asset_changes.data, asset_changes.count) {
+        if(it->asset.full_path == change.asset.full_path) {
+            it->last_event_time = change.last_event_time;
+            release(&change);
+            return;
+        }
+    }
+
+    asset_changes.add(change);
+}
+
+static void dispatch_settled_asset_changes() {
+    if(!asset_changes.count) return;
+
+    double now = os_specific_get_time();
+
+    for(int i = 0; i < asset_changes.count; i++) {
+        AssetChange * change = &asset_changes.data[i];
+
+        if(now - change->last_event_time < COALESCING_WINDOW) continue;
+
+        dispatch_file_to_managers(change->asset); // Managers own the path from now on.
+
+        // remove_by_index moves the last change here, so look at this index again.
+        asset_changes.remove_by_index(i);
+        i -= 1;
+    }
+}
+
+// Fills the asset from a path relative to the data directory. Takes ownership of full_path.data on success, returns
+// false if the file isn't something the managers care about (directories, PS tmp files).
+bool make_asset_from_path(String full_path, Asset * asset) {
+    asset->full_path = full_path;
+
+    // Replace Windows' \ by /
+    for (int i = 0; i < asset->full_path.count; i++) {
+        if (asset->full_path[i] == '\\') asset->full_path[i] = '/';
+    }
+
+    // Isolate file name from the path
+    String file_name = find_char_from_right('/', asset->full_path);
+    if (file_name.count) {
+        asset->name = file_name;
+    } else {
+        asset->name = asset->full_path;
+    }
+
+    String extension = find_char_from_left('.', asset->name);
+
+    if (extension.count) { // Check that we have an extension
+        if (extension == "tmp") return false; // PS tmp file. We skip those.
+    } else {
+        return false; // Directory change, we ignore that.
+    }
+
+    asset->extension = extension;
+
+    return true;
+}
+
+void dispatch_file_to_managers(Asset asset) {
+    // Look for a manager who's interested in changes of files with this extension
+    for_array(managers.data, managers.count) {
+        AssetManager * am = *it;
+        for(int j = 0; j < am->extensions.count; j++) { // @Cleanup This should be another for_array, but I can't nest them without redeclaring it and it_index, which is no good. We should be able to name it manually
+            if(string_compare(asset.extension, to_string(am->extensions.data[j]))) {
+                am->assets_to_reload.add(asset);
+            }
+        }
+    }
+}
+
+void hotloader_register_loose_files() {
+    register_files(os_specific_list_all_files_in_directory("data"));
+}
+
+void hotloader_register_packed_files() {
+    register_files(list_packed_files());
+}
+
+// Takes ownership of the paths.
+static void register_files(Array<char *> files) {
+    for_array(files.data, files.count) {
+        String full_path;
+        full_path.data  = *it;
+        full_path.count = strlen(*it);
+
+        Asset asset;
+        if(!make_asset_from_path(full_path, &asset)) {
+            free(*it);
+            continue;
+        }
+
+        dispatch_file_to_managers(asset);
+    }
+
+    files.reset(true);
+}
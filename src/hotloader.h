@@ -0,0 +1,29 @@
+#include "parsing.h"
+
+struct Asset;
+struct AssetChange;
+struct AssetManager;
+
+void release(AssetChange * ac);
+
+void init_hotloader();
+
+void register_manager(AssetManager * am);
+
+void check_hotloader_modifications();
+
+void shutdown_hotloader();
+
+void hotloader_register_loose_files();
+void hotloader_register_packed_files(); // See pack_file.h
+
+// Implemented by the platform backends, the watcher thread is theirs.
+bool start_hotloader_thread();
+void stop_hotloader_thread();
+
+// Shared by the platform backends
+bool make_asset_from_path(String full_path, Asset * asset);
+
+void push_asset_change(Asset asset); // Watcher thread only.
+
+void dispatch_file_to_managers(Asset asset);
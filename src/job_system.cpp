@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <atomic>
+
+#include "job_system.h"
+#include "spsc_queue.h"
+#include "macros.h"
+#include "profiler.h"
+#include "os/layer.h"
+
+struct Job {
+    JobProc work;
+    JobProc finish;
+    void * data;
+};
+
+struct Worker {
+    void * thread;
+
+    SPSCQueue<Job> finished_jobs; // Worker -> main thread
+};
+
+// Private functions
+static void worker_thread_proc(void * data);
+
+static bool take_job(Job * job);
+
+static void finish_job(Job job);
+
+// Const
+const int JOB_QUEUE_LENGTH      = 1024; // Has to be a power of two.
+const int FINISHED_QUEUE_LENGTH = 256;  // Has to be a power of two.
+
+const int MAX_WORKERS = 64;
+
+// Globals
+// Pending jobs. Only the main thread writes, so next_to_write doesn't need to be atomic for it, but workers read it.
+// Any thread can take a job by bumping next_to_read with a compare-exchange.
+static Job jobs[JOB_QUEUE_LENGTH];
+static std::atomic<unsigned int> next_to_write;
+static std::atomic<unsigned int> next_to_read;
+
+static void * work_available; // Semaphore, signaled once per job added.
+
+static std::atomic<bool> running;
+
+static Worker * workers;
+static int num_workers;
+
+static int jobs_in_flight; // Added but not finished yet, main thread only.
+
+void init_job_system(int requested_workers) { // @Default requested_workers = 0
+    if(requested_workers <= 0) {
+        requested_workers = os_specific_get_processor_count() - 1; // The main thread helps out when it's waiting.
+    }
+
+    if(requested_workers < 1)           requested_workers = 1;
+    if(requested_workers > MAX_WORKERS) requested_workers = MAX_WORKERS;
+
+    next_to_write.store(0);
+    next_to_read.store(0);
+    running.store(true);
+
+    work_available = os_specific_create_semaphore(0);
+
+    workers = (Worker *) calloc(requested_workers, sizeof(Worker));
+
+    for(int i = 0; i < requested_workers; i++) {
+        workers[i].finished_jobs.init(FINISHED_QUEUE_LENGTH);
+        workers[i].thread = os_specific_create_thread(worker_thread_proc, &workers[i]);
+
+        if(!workers[i].thread) {
+            workers[i].finished_jobs.release();
+            break;
+        }
+
+        num_workers += 1;
+    }
+
+    log_print("job_system", "Started %d worker threads", num_workers);
+}
+
+int get_num_job_workers() {
+    return num_workers;
+}
+
+void add_job(JobProc work, JobProc finish, void * data) {
+    Job job;
+    job.work   = work;
+    job.finish = finish;
+    job.data   = data;
+
+    jobs_in_flight += 1;
+
+    if(!num_workers) { // No threads, or we failed to start them. Just do it now.
+        job.work(job.data);
+        finish_job(job);
+        return;
+    }
+
+    // Queue is full, help the workers until there's some room.
+    while(next_to_write.load(std::memory_order_relaxed) - next_to_read.load(std::memory_order_acquire) >= JOB_QUEUE_LENGTH) {
+        Job other;
+        if(take_job(&other)) {
+            other.work(other.data);
+            finish_job(other);
+        }
+    }
+
+    unsigned int index = next_to_write.load(std::memory_order_relaxed);
+    jobs[index & (JOB_QUEUE_LENGTH - 1)] = job;
+
+    next_to_write.store(index + 1, std::memory_order_release); // Publishes the job.
+
+    os_specific_signal_semaphore(work_available);
+}
+
+void run_finished_jobs() {
+    for(int i = 0; i < num_workers; i++) {
+        Job job;
+        while(workers[i].finished_jobs.pop(&job)) {
+            finish_job(job);
+        }
+    }
+}
+
+void wait_for_all_jobs() {
+    profile_function();
+
+    while(jobs_in_flight) {
+        run_finished_jobs();
+
+        // Rather than sleeping, do some of the work ourselves.
+        Job job;
+        if(take_job(&job)) {
+            job.work(job.data);
+            finish_job(job);
+        } else if(jobs_in_flight) {
+            os_specific_sleep(0); // Everything is being worked on, give the workers our time slice.
+        }
+    }
+}
+
+void shutdown_job_system() {
+    wait_for_all_jobs();
+
+    running.store(false);
+    os_specific_signal_semaphore(work_available, num_workers);
+
+    for(int i = 0; i < num_workers; i++) {
+        os_specific_join_thread(workers[i].thread);
+        workers[i].finished_jobs.release();
+    }
+
+    free(workers);
+    workers     = NULL;
+    num_workers = 0;
+}
+
+static void finish_job(Job job) {
+    if(job.finish) job.finish(job.data);
+    jobs_in_flight -= 1;
+}
+
+static bool take_job(Job * job) {
+    while(true) {
+        unsigned int index = next_to_read.load(std::memory_order_relaxed);
+
+        if(index == next_to_write.load(std::memory_order_acquire)) return false; // Empty
+
+        // Copy before claiming it. The main thread can't overwrite this slot until next_to_read moves past it, and if
+        // someone else claimed it first, the exchange fails and we try again with the next one.
+        *job = jobs[index & (JOB_QUEUE_LENGTH - 1)];
+
+        if(next_to_read.compare_exchange_weak(index, index + 1, std::memory_order_acq_rel)) return true;
+    }
+}
+
+static void worker_thread_proc(void * data) {
+    Worker * worker = (Worker *) data;
+
+    set_profiler_thread_name("job_worker");
+
+    while(true) {
+        os_specific_wait_semaphore(work_available);
+
+        if(!running.load()) return;
+
+        // The semaphore counts jobs, but another thread (or the main thread helping out) might have taken ours.
+        Job job;
+        if(!take_job(&job)) continue;
+
+        job.work(job.data);
+
+        // The main thread empties these every frame and while waiting, so this only spins on huge bursts.
+        while(!worker->finished_jobs.push(job)) {
+            os_specific_sleep(1);
+        }
+    }
+}
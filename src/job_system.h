@@ -0,0 +1,17 @@
+// Worker threads for work that doesn't touch shared state (file I/O, decoding, parsing). Jobs are added and finished
+// on the main thread: the work function runs on any thread, then the finish function runs on the main thread the
+// next time it calls run_finished_jobs or wait_for_all_jobs. That's where results get published to the rest of the
+// engine.
+
+typedef void (*JobProc)(void * data);
+
+void init_job_system(int num_workers = 0); // 0 means one worker per core, minus the main thread.
+
+void add_job(JobProc work, JobProc finish, void * data); // finish can be NULL.
+
+void run_finished_jobs();
+void wait_for_all_jobs();
+
+int  get_num_job_workers();
+
+void shutdown_job_system();
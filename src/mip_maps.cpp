@@ -0,0 +1,259 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xmmintrin.h>
+
+#include "mip_maps.h"
+
+// Every pixel is a single __m128 (r, g, b, a), linear and premultiplied while we filter. The filters are separable,
+// so each level is a horizontal pass followed by a vertical one, and both are just multiply-adds on whole pixels.
+
+struct MipKernel {
+    int first_tap; // Offset from 2 * x of the first source texel we read.
+    int num_taps;
+    float weights[6];
+};
+
+// Private functions
+static void decode_level(unsigned char * level, int num_pixels, __m128 * pixels);
+static void encode_level(__m128 * pixels, int num_pixels, unsigned char * level);
+
+static void downsample_row    (__m128 * source, int source_width, __m128 * destination, int width, __m128 * weights, MipKernel * kernel);
+static void downsample_columns(__m128 * source, int width, int source_height, __m128 * destination, int height, MipKernel * kernel);
+
+static MipKernel get_kernel(MipFilter filter);
+static float bessel_i0(float x);
+
+static bool build_tables();
+
+// Const
+const int LINEAR_TO_SRGB_TABLE_SIZE = 4096;
+
+const float KAISER_RADIUS = 3.0f; // In source texels
+const float KAISER_ALPHA  = 4.0f;
+
+// Globals
+// Built before main, workers only ever read them.
+static float srgb_to_linear[256];
+static unsigned char linear_to_srgb[LINEAR_TO_SRGB_TABLE_SIZE];
+static bool tables_built = build_tables();
+
+void generate_mip_levels(unsigned char * chain, int width, int height, int num_levels, MipFilter filter) {
+    if(num_levels <= 1) return;
+
+    MipKernel kernel = get_kernel(filter);
+
+    int first_width  = (width  > 1) ? width  / 2 : 1;
+    int first_height = (height > 1) ? height / 2 : 1;
+
+    __m128 weights[6];
+    for(int t = 0; t < kernel.num_taps; t++) weights[t] = _mm_set1_ps(kernel.weights[t]);
+
+    // Each level is filtered from the float version of the one above, so rounding doesn't pile up down the chain. The
+    // first level is decoded a row at a time instead, it's the biggest by far and we only need it once. Buffers get
+    // swapped as we go, every level is smaller than the one before so they're always big enough.
+    __m128 * current = (__m128 *) _mm_malloc(first_width * first_height * sizeof(__m128), 16);
+    __m128 * next    = (__m128 *) _mm_malloc(first_width * first_height * sizeof(__m128), 16);
+    __m128 * rows    = (__m128 *) _mm_malloc(first_width * height * sizeof(__m128), 16); // After the horizontal pass
+    __m128 * decoded = (__m128 *) _mm_malloc(width * sizeof(__m128), 16);               // One row of the first level
+
+    unsigned char * level = chain;
+
+    for(int i = 1; i < num_levels; i++) {
+        int next_width  = (width  > 1) ? width  / 2 : 1;
+        int next_height = (height > 1) ? height / 2 : 1;
+
+        for(int y = 0; y < height; y++) {
+            __m128 * source_row = current + y * width;
+
+            if(i == 1) {
+                decode_level(level + y * width * 4, width, decoded);
+                source_row = decoded;
+            }
+
+            downsample_row(source_row, width, rows + y * next_width, next_width, weights, &kernel);
+        }
+
+        downsample_columns(rows, next_width, height, next, next_height, &kernel);
+
+        level += width * height * 4;
+        encode_level(next, next_width * next_height, level);
+
+        __m128 * swap = current;
+        current = next;
+        next    = swap;
+
+        width  = next_width;
+        height = next_height;
+    }
+
+    _mm_free(current);
+    _mm_free(next);
+    _mm_free(rows);
+    _mm_free(decoded);
+}
+
+static void decode_level(unsigned char * level, int num_pixels, __m128 * pixels) {
+    for(int i = 0; i < num_pixels; i++) {
+        unsigned char * texel = level + i * 4;
+
+        float alpha = texel[3] * (1.0f / 255.0f);
+
+        pixels[i] = _mm_set_ps(alpha, srgb_to_linear[texel[2]] * alpha, srgb_to_linear[texel[1]] * alpha, srgb_to_linear[texel[0]] * alpha);
+    }
+}
+
+static void encode_level(__m128 * pixels, int num_pixels, unsigned char * level) {
+    __m128 zero = _mm_setzero_ps();
+    __m128 one  = _mm_set1_ps(1.0f);
+
+    for(int i = 0; i < num_pixels; i++) {
+        unsigned char * texel = level + i * 4;
+
+        // Kaiser has negative lobes, so we can overshoot either way.
+        __m128 pixel = _mm_min_ps(_mm_max_ps(pixels[i], zero), one);
+
+        float alpha = _mm_cvtss_f32(_mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 3, 3, 3)));
+
+        texel[3] = (unsigned char) (alpha * 255.0f + 0.5f);
+
+        if(alpha <= 0.0f) {
+            texel[0] = texel[1] = texel[2] = 0;
+            continue;
+        }
+
+        float color[4];
+        _mm_storeu_ps(color, _mm_min_ps(_mm_div_ps(pixel, _mm_set1_ps(alpha)), one));
+
+        for(int c = 0; c < 3; c++) {
+            texel[c] = linear_to_srgb[(int) (color[c] * (LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5f)];
+        }
+    }
+}
+
+// Source texels past the edges are clamped, which also takes care of sides that are already 1 texel wide.
+static void downsample_row(__m128 * source, int source_width, __m128 * destination, int width, __m128 * weights, MipKernel * kernel) {
+    // Texels whose taps are all inside the row skip the clamping, that's all of them but a couple on each side.
+    int first_inside = (-kernel->first_tap + 1) / 2;
+    int last_inside  = source_width - kernel->first_tap - kernel->num_taps;
+
+    last_inside = (last_inside < 0) ? -1 : last_inside / 2;
+
+    if(first_inside > width) first_inside = width;
+    if(last_inside >= width) last_inside  = width - 1;
+
+    for(int x = 0; x < width; x++) {
+        __m128 sum = _mm_setzero_ps();
+
+        if(x >= first_inside && x <= last_inside) {
+            __m128 * taps = source + 2 * x + kernel->first_tap;
+
+            for(int t = 0; t < kernel->num_taps; t++) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(taps[t], weights[t]));
+            }
+        } else {
+            for(int t = 0; t < kernel->num_taps; t++) {
+                int source_x = 2 * x + kernel->first_tap + t;
+
+                if(source_x < 0)                source_x = 0;
+                if(source_x > source_width - 1) source_x = source_width - 1;
+
+                sum = _mm_add_ps(sum, _mm_mul_ps(source[source_x], weights[t]));
+            }
+        }
+
+        destination[x] = sum;
+    }
+}
+
+// Whole rows at a time, so we walk memory in order.
+static void downsample_columns(__m128 * source, int width, int source_height, __m128 * destination, int height, MipKernel * kernel) {
+    for(int y = 0; y < height; y++) {
+        __m128 * out = destination + y * width;
+
+        for(int x = 0; x < width; x++) out[x] = _mm_setzero_ps();
+
+        for(int t = 0; t < kernel->num_taps; t++) {
+            int source_y = 2 * y + kernel->first_tap + t;
+
+            if(source_y < 0)                 source_y = 0;
+            if(source_y > source_height - 1) source_y = source_height - 1;
+
+            __m128 * in     = source + source_y * width;
+            __m128   weight = _mm_set1_ps(kernel->weights[t]);
+
+            for(int x = 0; x < width; x++) {
+                out[x] = _mm_add_ps(out[x], _mm_mul_ps(in[x], weight));
+            }
+        }
+    }
+}
+
+static MipKernel get_kernel(MipFilter filter) {
+    MipKernel kernel;
+
+    if(filter == MIP_FILTER_BOX) {
+        kernel.first_tap  = 0;
+        kernel.num_taps   = 2;
+        kernel.weights[0] = 0.5f;
+        kernel.weights[1] = 0.5f;
+
+        return kernel;
+    }
+
+    // The destination texel is centered between source texels 2x and 2x + 1, so the taps sit 0.5, 1.5 and 2.5 source
+    // texels away on each side. The sinc is in destination texels, since that's the rate we're resampling to.
+    kernel.first_tap = -2;
+    kernel.num_taps  = 6;
+
+    float sum = 0.0f;
+
+    for(int t = 0; t < kernel.num_taps; t++) {
+        float distance = (float) t - 2.5f;
+
+        float x    = 3.14159265f * distance * 0.5f;
+        float sinc = sinf(x) / x; // distance is never 0
+
+        float window_position = distance / KAISER_RADIUS;
+        float window = bessel_i0(KAISER_ALPHA * sqrtf(1.0f - window_position * window_position)) / bessel_i0(KAISER_ALPHA);
+
+        kernel.weights[t] = sinc * window;
+        sum += kernel.weights[t];
+    }
+
+    for(int t = 0; t < kernel.num_taps; t++) kernel.weights[t] /= sum;
+
+    return kernel;
+}
+
+// Modified Bessel function of the first kind, order 0. The series converges quickly for the values we use.
+static float bessel_i0(float x) {
+    float sum  = 1.0f;
+    float term = 1.0f;
+
+    for(int k = 1; k < 32; k++) {
+        float factor = x / (2.0f * k);
+        term *= factor * factor;
+        sum  += term;
+
+        if(term < sum * 1e-8f) break;
+    }
+
+    return sum;
+}
+
+static bool build_tables() {
+    for(int i = 0; i < 256; i++) {
+        float c = i / 255.0f;
+        srgb_to_linear[i] = (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    for(int i = 0; i < LINEAR_TO_SRGB_TABLE_SIZE; i++) {
+        float l = (float) i / (LINEAR_TO_SRGB_TABLE_SIZE - 1);
+        float c = (l <= 0.0031308f) ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+
+        linear_to_srgb[i] = (unsigned char) (c * 255.0f + 0.5f);
+    }
+
+    return true;
+}
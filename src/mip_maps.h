@@ -0,0 +1,41 @@
+#pragma once
+
+#include "texture_format.h"
+
+// Mip chains are stored back to back, from width x height down to 1x1, each side halved (rounded down, never below 1)
+// at every level. That's the layout of Texture::bitmap, cooked textures and what D3D11 expects for its subresources.
+
+enum MipFilter {
+    MIP_FILTER_BOX,    // 2x2 average. Cheap, what we use when loading loose files.
+    MIP_FILTER_KAISER, // Kaiser windowed sinc, 6 taps per side. Sharper, what the cooker uses.
+};
+
+// Fills levels 1 to num_levels - 1 of chain from level 0. RGBA8, sRGB color, straight alpha. Filtering happens in
+// linear space with the color weighted by alpha, so mips don't get darker and transparent texels don't bleed into
+// their neighbours. Thread safe.
+void generate_mip_levels(unsigned char * chain, int width, int height, int num_levels, MipFilter filter);
+
+inline int get_num_mip_levels(int width, int height) {
+    int num_levels = 1;
+
+    while(width > 1 || height > 1) {
+        width  = (width  > 1) ? width  / 2 : 1;
+        height = (height > 1) ? height / 2 : 1;
+        num_levels += 1;
+    }
+
+    return num_levels;
+}
+
+inline int get_mip_chain_size(TextureFormat format, int width, int height, int num_levels) {
+    int size = 0;
+
+    for(int i = 0; i < num_levels; i++) {
+        size += get_level_size(format, width, height);
+
+        width  = (width  > 1) ? width  / 2 : 1;
+        height = (height > 1) ? height / 2 : 1;
+    }
+
+    return size;
+}
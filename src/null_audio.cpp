@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <atomic>
+
+#include "null_audio.h"
+#include "audio_mixer.h"
+#include "os/layer.h"
+#include "hash.h"
+#include "macros.h"
+#include "array.h"
+#include "profiler.h"
+
+// Private functions
+static void pull_in_real_time(void * data);
+static void write_wav_header(FILE * file, unsigned int data_size);
+
+// Const
+const int WAV_HEADER_SIZE = 44;
+
+const int NULL_AUDIO_MAX_LAG = MIXER_OUTPUT_RATE; // In frames. A thread that's this far behind skips ahead instead.
+
+// Globals
+static NullAudioTarget target;
+
+static FILE * wav_file;
+static Array<short> output; // For NULL_AUDIO_MEMORY
+
+static unsigned long long checksum;
+static long long frame_count;
+
+static void * pulling_thread;
+static std::atomic<bool> keep_pulling;
+
+static short block[MIX_BLOCK_FRAMES * MIXER_OUTPUT_CHANNELS];
+
+bool init_null_audio(NullAudioTarget new_target, char * wav_path) { // @Default wav_path = NULL
+    target      = new_target;
+    checksum    = 0;
+    frame_count = 0;
+
+    if(target == NULL_AUDIO_WAV_FILE) {
+        wav_file = fopen(wav_path, "wb");
+
+        if(!wav_file) {
+            log_print("null_audio", "Could not create the file \"%s\"", wav_path);
+            return false;
+        }
+
+        write_wav_header(wav_file, 0); // For now, we don't know how long it'll be.
+    }
+
+    init_audio_mixer();
+
+    return true;
+}
+
+void shutdown_null_audio() {
+    if(pulling_thread) {
+        keep_pulling.store(false);
+        os_specific_join_thread(pulling_thread);
+        pulling_thread = NULL;
+    }
+
+    if(wav_file) {
+        long long data_size = frame_count * MIXER_OUTPUT_CHANNELS * sizeof(short);
+        if(data_size > 0xffffffffll - WAV_HEADER_SIZE) data_size = 0xffffffffll - WAV_HEADER_SIZE; // What fits in a WAV.
+
+        fseek(wav_file, 0, SEEK_SET);
+        write_wav_header(wav_file, (unsigned int) data_size);
+
+        fclose(wav_file);
+        wav_file = NULL;
+    }
+
+    output.reset(true);
+}
+
+void start_null_audio_thread() {
+    keep_pulling.store(true);
+    pulling_thread = os_specific_create_thread(pull_in_real_time, NULL);
+}
+
+void render_null_audio(int num_frames) {
+    while(num_frames > 0) {
+        int block_frames = num_frames < MIX_BLOCK_FRAMES ? num_frames : MIX_BLOCK_FRAMES;
+        int block_size   = block_frames * MIXER_OUTPUT_CHANNELS;
+
+        mix_audio(block, block_frames);
+
+        checksum = murmur_hash_64a(block, block_size * sizeof(short), checksum);
+
+        if(target == NULL_AUDIO_MEMORY) {
+            if(output.count + block_size > output.allocated) {
+                int size = output.allocated * 2;
+                if(size < output.count + block_size) size = output.count + block_size;
+
+                output.reserve(size);
+            }
+
+            memcpy(output.data + output.count, block, block_size * sizeof(short));
+            output.count += block_size;
+        } else if(target == NULL_AUDIO_WAV_FILE) {
+            fwrite(block, sizeof(short), block_size, wav_file); // @Robustness little endian hosts only, like the header.
+        }
+
+        frame_count += block_frames;
+        num_frames  -= block_frames;
+    }
+}
+
+short * get_null_audio_output(int * num_frames) {
+    *num_frames = output.count / MIXER_OUTPUT_CHANNELS;
+    return output.data;
+}
+
+unsigned long long get_null_audio_checksum() {
+    return checksum;
+}
+
+long long get_null_audio_frame_count() {
+    return frame_count;
+}
+
+// The thread. Mixes whole blocks of what's due since it started, like a device asking for more.
+static void pull_in_real_time(void * data) {
+    set_profiler_thread_name("audio");
+
+    double start_time = os_specific_get_time();
+    long long pulled  = 0;
+
+    while(keep_pulling.load()) {
+        long long due = (long long) ((os_specific_get_time() - start_time) * MIXER_OUTPUT_RATE);
+
+        if(due - pulled > NULL_AUDIO_MAX_LAG) {
+            log_print("null_audio", "Fell behind by %.2f seconds, skipping ahead", (double) (due - pulled) / MIXER_OUTPUT_RATE);
+            pulled = due - MIX_BLOCK_FRAMES;
+        }
+
+        int frames = (int) ((due - pulled) / MIX_BLOCK_FRAMES * MIX_BLOCK_FRAMES);
+
+        if(frames) {
+            profile_zone("mix_audio");
+
+            render_null_audio(frames);
+            pulled += frames;
+        }
+
+        os_specific_sleep(NULL_AUDIO_PERIOD_MS);
+    }
+}
+
+// 16 bit stereo PCM at the mixer's rate.
+static void write_wav_header(FILE * file, unsigned int data_size) {
+    unsigned int   riff_size       = data_size + WAV_HEADER_SIZE - 8;
+    unsigned int   format_size     = 16;
+    unsigned short format          = 1; // PCM
+    unsigned short num_channels    = MIXER_OUTPUT_CHANNELS;
+    unsigned int   sample_rate     = MIXER_OUTPUT_RATE;
+    unsigned int   bytes_per_sec   = MIXER_OUTPUT_RATE * MIXER_OUTPUT_CHANNELS * sizeof(short);
+    unsigned short block_align     = MIXER_OUTPUT_CHANNELS * sizeof(short);
+    unsigned short bits_per_sample = sizeof(short) * 8;
+
+    fwrite("RIFF", 1, 4, file);
+    fwrite(&riff_size, 4, 1, file);
+    fwrite("WAVE", 1, 4, file);
+
+    fwrite("fmt ", 1, 4, file);
+    fwrite(&format_size,     4, 1, file);
+    fwrite(&format,          2, 1, file);
+    fwrite(&num_channels,    2, 1, file);
+    fwrite(&sample_rate,     4, 1, file);
+    fwrite(&bytes_per_sec,   4, 1, file);
+    fwrite(&block_align,     2, 1, file);
+    fwrite(&bits_per_sample, 2, 1, file);
+
+    fwrite("data", 1, 4, file);
+    fwrite(&data_size, 4, 1, file);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h> // NULL
+
+// An audio device that isn't there, for headless machines and tests. It pulls from the mixer like a device would and
+// keeps what it gets in memory, writes it to a WAV file, or drops it, with a checksum of all of it either way.
+//
+// It either pulls on its own thread, MIXER_OUTPUT_RATE frames a second like a device, or on the calling thread with
+// render_null_audio, as fast as it can. Then the output only depends on what was played and between which blocks,
+// never on timing, which is what tests and benchmarks want.
+
+enum NullAudioTarget {
+    NULL_AUDIO_DISCARD,
+    NULL_AUDIO_MEMORY,
+    NULL_AUDIO_WAV_FILE,
+};
+
+const int NULL_AUDIO_PERIOD_MS = 10; // How often the thread wakes up.
+
+// Inits the mixer too. Returns false if the WAV file can't be created.
+bool init_null_audio(NullAudioTarget target, char * wav_path = NULL);
+void shutdown_null_audio(); // Stops the thread, and fills in the sizes of the WAV file.
+
+void start_null_audio_thread();
+
+// Mixes num_frames right away, a block at a time. Not while the thread runs.
+void render_null_audio(int num_frames);
+
+// Not while the thread runs either.
+short * get_null_audio_output(int * num_frames); // Interleaved stereo, NULL unless the target is memory.
+unsigned long long get_null_audio_checksum();    // murmur_hash_64a of every block, each seeded with the one before.
+long long get_null_audio_frame_count();
@@ -0,0 +1,64 @@
+// Renderer backend that draws nothing. Headless builds load this instead of d3d_renderer.dll so that the whole
+// frame (game code, buffering, batching) still runs and can be timed without a GPU.
+
+#include "d3d_renderer.h" // @Cleanup This declares the interface of every backend, not just d3d.
+
+#include "shader_manager.h"
+#include "texture_manager.h"
+#include "graphics_buffer.h"
+
+// Nothing to hold, but textures go through the same life cycle as with d3d, so the texture manager's bookkeeping
+// (released bitmaps, GPU bytes, eviction) runs headless too.
+struct PlatformTextureInfo {
+    int unused;
+};
+
+void init_platform_renderer(Vector2f rendering_resolution, void * handle) {}
+
+void init_frame() {}
+
+void draw_batch(DrawBatch * batch) {
+    Texture * texture = batch->info.texture;
+
+    if(texture == NULL) return;
+
+    if(texture->dirty) {
+        release_texture(texture);
+    } else if(texture->platform_info && has_dirty_region(texture)) {
+        update_texture_region(texture, texture->dirty_rect);
+    }
+
+    if(texture->platform_info == NULL) {
+        texture->platform_info = (PlatformTextureInfo *) malloc(sizeof(PlatformTextureInfo));
+        texture->dirty_rect    = {};
+    }
+}
+
+void present_frame(int sync_interval) {}
+
+void release_texture(Texture * texture) {
+    free(texture->platform_info);
+    texture->platform_info = NULL;
+
+    texture->dirty      = false;
+    texture->dirty_rect = {};
+}
+
+void update_texture_region(Texture * texture, TextureRect rect) {
+    texture->dirty_rect = {};
+}
+
+bool compile_shader(Shader * shader, String file_data) {
+    shader->VS = NULL;
+    shader->PS = NULL;
+
+    shader->input_layout = NULL;
+
+    // We don't compile anything, so assume every input is there. That keeps batching as close as possible to what
+    // the d3d backend does, since it only looks at whether the indices are set.
+    shader->position_index = 0;
+    shader->color_index    = 1;
+    shader->uv_index       = 2;
+
+    return true;
+}
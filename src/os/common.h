@@ -13,6 +13,7 @@ struct Keyboard { //@Cleanup, should probably break up Keyboard and Mouse
     bool key_F1 = false;
     bool key_F2 = false;
     bool key_F3 = false;
+    bool key_F4 = false;
 
     bool key_ESC = false;
 
@@ -2,8 +2,19 @@
 
 #ifdef WINDOWS
 #define PLATFORM win32
+#define PLATFORM_RENDERER_DLL "d3d_renderer.dll"
 #include "os/win32/core.h"
 #include "os/win32/file_loader.h"
+#include "os/win32/sound_player.h"
+#endif
+
+#ifdef LINUX
+#undef linux // GCC predefines linux to 1 outside of strict ISO mode, which breaks the name generation below.
+#define PLATFORM linux
+#define PLATFORM_RENDERER_DLL "null_renderer.so"
+#include "os/linux/core.h"
+#include "os/linux/file_loader.h"
+#include "os/linux/sound_player.h"
 #endif
 
 //Name generating macros
@@ -20,10 +31,29 @@
 #define os_specific_get_time                      GENERATE_FUNC_NAME(PLATFORM, get_time)
 #define os_specific_sleep                         GENERATE_FUNC_NAME(PLATFORM, sleep)
 
+// Threads
+#define os_specific_create_thread                 GENERATE_FUNC_NAME(PLATFORM, create_thread)
+#define os_specific_join_thread                   GENERATE_FUNC_NAME(PLATFORM, join_thread)
+#define os_specific_get_processor_count           GENERATE_FUNC_NAME(PLATFORM, get_processor_count)
+#define os_specific_create_semaphore              GENERATE_FUNC_NAME(PLATFORM, create_semaphore)
+#define os_specific_signal_semaphore              GENERATE_FUNC_NAME(PLATFORM, signal_semaphore)
+#define os_specific_wait_semaphore                GENERATE_FUNC_NAME(PLATFORM, wait_semaphore)
+
 // DLL
 #define os_specific_load_dll                      GENERATE_FUNC_NAME(PLATFORM, load_dll)
 #define os_specific_get_address_from_dll          GENERATE_FUNC_NAME(PLATFORM, get_address_from_dll)
 
 // Files
 #define os_specific_read_file                     GENERATE_FUNC_NAME(PLATFORM, read_file)
+#define os_specific_get_file_size                 GENERATE_FUNC_NAME(PLATFORM, get_file_size)
+#define os_specific_map_file                      GENERATE_FUNC_NAME(PLATFORM, map_file)
+#define os_specific_unmap_file                    GENERATE_FUNC_NAME(PLATFORM, unmap_file)
+#define os_specific_open_file                     GENERATE_FUNC_NAME(PLATFORM, open_file)
+#define os_specific_read_file_range               GENERATE_FUNC_NAME(PLATFORM, read_file_range)
+#define os_specific_close_file                    GENERATE_FUNC_NAME(PLATFORM, close_file)
 #define os_specific_list_all_files_in_directory   GENERATE_FUNC_NAME(PLATFORM, list_all_files_in_directory)
+
+// Sound
+#define os_specific_init_sound_player             GENERATE_FUNC_NAME(PLATFORM, init_sound_player)
+#define os_specific_shutdown_sound_player         GENERATE_FUNC_NAME(PLATFORM, shutdown_sound_player)
+#define os_specific_play_sound_wave               GENERATE_FUNC_NAME(PLATFORM, play_sound_wave)
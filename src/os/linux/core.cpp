@@ -0,0 +1,159 @@
+// Headless platform layer. There is no window and no input, this is only meant to run the engine on our Linux build
+// machines (asset cooking, performance regression benchmarks). The "window" stays open until we get SIGINT or SIGTERM.
+
+#include <time.h>
+#include <signal.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "os/linux/core.h"
+
+#include "os/common.h"
+
+#include "macros.h"
+
+static Keyboard local_keyboard; // Never touched, nobody is typing on a build machine.
+static volatile sig_atomic_t local_should_quit;
+
+static void handle_quit_signal(int signal_number) {
+    local_should_quit = true;
+}
+
+void * linux_create_window(int width, int height, char * name) {
+    struct sigaction action = {};
+    action.sa_handler = handle_quit_signal;
+
+    sigaction(SIGINT,  &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    log_print("create_window", "Running headless, no window will be created for \"%s\" (%dx%d)", name, width, height);
+
+    // Callers check the handle against NULL, so give them something that isn't.
+    return (void *) &local_keyboard;
+}
+
+Keyboard linux_update_keyboard() {
+    return local_keyboard;
+}
+
+bool linux_update_window_events(void * handle) {
+    return local_should_quit;
+}
+
+// Time functions
+static struct timespec start_time;
+
+void linux_init_clock() {
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+double linux_get_time() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (time.tv_sec - start_time.tv_sec) + (time.tv_nsec - start_time.tv_nsec) / 1000000000.0;
+}
+
+void linux_sleep(int ms) {
+    struct timespec duration;
+    duration.tv_sec  = ms / 1000;
+    duration.tv_nsec = (ms % 1000) * 1000000L;
+
+    // Keep sleeping if a signal woke us up early.
+    while(nanosleep(&duration, &duration) == -1) {}
+}
+
+// Threads
+struct ThreadStart {
+    ThreadProc proc;
+    void * data;
+};
+
+static void * thread_trampoline(void * parameter) {
+    ThreadStart start = *(ThreadStart *) parameter;
+    free(parameter);
+
+    start.proc(start.data);
+
+    return NULL;
+}
+
+void * linux_create_thread(ThreadProc proc, void * data) {
+    ThreadStart * start = (ThreadStart *) malloc(sizeof(ThreadStart));
+    start->proc = proc;
+    start->data = data;
+
+    pthread_t * thread = (pthread_t *) malloc(sizeof(pthread_t));
+
+    int error = pthread_create(thread, NULL, thread_trampoline, start);
+
+    if(error) {
+        log_print("create_thread", "Failed to create a thread: %s", strerror(error));
+        free(start);
+        free(thread);
+        return NULL;
+    }
+
+    return (void *) thread;
+}
+
+void linux_join_thread(void * thread) {
+    pthread_join(*(pthread_t *) thread, NULL);
+    free(thread);
+}
+
+int linux_get_processor_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? count : 1;
+}
+
+void * linux_create_semaphore(int initial_count) {
+    sem_t * semaphore = (sem_t *) malloc(sizeof(sem_t));
+
+    if(sem_init(semaphore, 0, initial_count) != 0) {
+        log_print("create_semaphore", "Failed to create a semaphore: %s", strerror(errno));
+        free(semaphore);
+        return NULL;
+    }
+
+    return (void *) semaphore;
+}
+
+void linux_signal_semaphore(void * semaphore, int count) { // @Default count = 1
+    for(int i = 0; i < count; i++) {
+        sem_post((sem_t *) semaphore);
+    }
+}
+
+void linux_wait_semaphore(void * semaphore) {
+    // Keep waiting if a signal woke us up early.
+    while(sem_wait((sem_t *) semaphore) == -1 && errno == EINTR) {}
+}
+
+// DLL
+void * linux_load_dll(char * name) {
+    // dlopen only looks in the current directory if the name contains a slash, LoadLibrary always does.
+    char path[512];
+    if(strchr(name, '/')) {
+        snprintf(path, sizeof(path), "%s", name);
+    } else {
+        snprintf(path, sizeof(path), "./%s", name);
+    }
+
+    void * dll = dlopen(path, RTLD_NOW);
+
+    if(!dll) {
+        log_print("load_dll", "Could not load %s, dlopen says: %s", path, dlerror());
+    }
+
+    return dll;
+}
+
+void * linux_get_address_from_dll(void * dll, char * name) {
+    return dlsym(dll, name);
+}
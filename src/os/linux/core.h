@@ -0,0 +1,25 @@
+typedef void (*ThreadProc)(void * data);
+
+void * linux_create_window(int width, int height, char * name);
+
+struct Keyboard;
+Keyboard linux_update_keyboard();
+bool linux_update_window_events(void * handle);
+
+// Time functions
+void linux_init_clock();
+double linux_get_time();
+void linux_sleep(int ms);
+
+// Threads
+void * linux_create_thread(ThreadProc proc, void * data);
+void linux_join_thread(void * thread);
+int  linux_get_processor_count();
+
+void * linux_create_semaphore(int initial_count);
+void linux_signal_semaphore(void * semaphore, int count = 1);
+void linux_wait_semaphore(void * semaphore);
+
+// DLL
+void * linux_load_dll(char * name);
+void * linux_get_address_from_dll(void * dll, char * name);
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "file_loader.h"
+#include "macros.h"
+
+#include "parsing.h"
+
+String linux_read_file(String path) {
+    char * c_path = to_c_string(path);
+    scope_exit(free(c_path));
+
+    String file_data;
+
+    int file_handle = open(c_path, O_RDONLY);
+
+    if(file_handle < 0) {
+        log_print("read_file", "Could not open the file \"%s\". Error is %s", c_path, strerror(errno));
+        return file_data;
+    }
+
+    scope_exit(close(file_handle));
+
+    struct stat file_info;
+    if(fstat(file_handle, &file_info) < 0) {
+        log_print("read_file", "Could not get the size of the file \"%s\". Error is %s", c_path, strerror(errno));
+        return file_data;
+    }
+
+    int file_size = file_info.st_size;
+
+    file_data.data = (char *) malloc(file_size);
+
+    // read can return less than we asked for, so loop until we have everything.
+    int bytes_read = 0;
+    while(bytes_read < file_size) {
+        ssize_t result = read(file_handle, file_data.data + bytes_read, file_size - bytes_read);
+
+        if(result < 0 && errno == EINTR) continue;
+
+        if(result <= 0) {
+            log_print("read_file", "An error occured while reading the file \"%s\". Error is %s", c_path, (result < 0) ? strerror(errno) : "unexpected end of file");
+            free(file_data.data);
+            file_data.data = NULL;
+            return file_data;
+        }
+
+        bytes_read += result;
+    }
+
+    file_data.count = file_size;
+
+    return file_data;
+}
+
+// Returns -1, without complaining, if the file doesn't exist.
+int linux_get_file_size(String path) {
+    char * c_path = to_c_string(path);
+    scope_exit(free(c_path));
+
+    struct stat file_info;
+    if(stat(c_path, &file_info) < 0) return -1;
+
+    return (int) file_info.st_size;
+}
+
+// Read only. Returns an empty string, without complaining, if the file doesn't exist.
+String linux_map_file(String path) {
+    char * c_path = to_c_string(path);
+    scope_exit(free(c_path));
+
+    String file_data;
+
+    int file_handle = open(c_path, O_RDONLY);
+
+    if(file_handle < 0) {
+        if(errno != ENOENT) log_print("map_file", "Could not open the file \"%s\". Error is %s", c_path, strerror(errno));
+        return file_data;
+    }
+
+    scope_exit(close(file_handle)); // The mapping stays valid after this.
+
+    struct stat file_info;
+    if(fstat(file_handle, &file_info) < 0 || file_info.st_size == 0) {
+        log_print("map_file", "Could not get the size of the file \"%s\", or it's empty. Error is %s", c_path, strerror(errno));
+        return file_data;
+    }
+
+    void * mapping = mmap(NULL, file_info.st_size, PROT_READ, MAP_PRIVATE, file_handle, 0);
+
+    if(mapping == MAP_FAILED) {
+        log_print("map_file", "Could not map the file \"%s\". Error is %s", c_path, strerror(errno));
+        return file_data;
+    }
+
+    file_data.data  = (char *) mapping;
+    file_data.count = file_info.st_size;
+
+    return file_data;
+}
+
+void linux_unmap_file(String file_data) {
+    munmap(file_data.data, file_data.count);
+}
+
+// Read only, for reading a file a piece at a time with read_file_range. NULL, without complaining, if the file doesn't
+// exist.
+void * linux_open_file(String path) {
+    char * c_path = to_c_string(path);
+    scope_exit(free(c_path));
+
+    int file_handle = open(c_path, O_RDONLY);
+
+    if(file_handle < 0) {
+        if(errno != ENOENT) log_print("open_file", "Could not open the file \"%s\". Error is %s", c_path, strerror(errno));
+        return NULL;
+    }
+
+    int * file = (int *) malloc(sizeof(int));
+    *file = file_handle;
+
+    return (void *) file;
+}
+
+// Doesn't move the file position, threads can read the same file. Returns how many bytes it read, less than size past
+// the end of the file, -1 on errors.
+int linux_read_file_range(void * file, long long offset, void * destination, int size) {
+    int file_handle = *(int *) file;
+
+    // pread can return less than we asked for too, so loop until we have everything or hit the end.
+    int bytes_read = 0;
+    while(bytes_read < size) {
+        ssize_t result = pread(file_handle, (char *) destination + bytes_read, size - bytes_read, offset + bytes_read);
+
+        if(result < 0 && errno == EINTR) continue;
+
+        if(result < 0) {
+            log_print("read_file_range", "An error occured while reading %d bytes at %lld. Error is %s", size, offset, strerror(errno));
+            return -1;
+        }
+
+        if(result == 0) break; // End of the file
+
+        bytes_read += result;
+    }
+
+    return bytes_read;
+}
+
+void linux_close_file(void * file) {
+    close(*(int *) file);
+    free(file);
+}
+
+Array<char *> linux_list_all_files_in_directory(char * directory, bool search_recursively) { // @Default search_recursively = true
+    Array<char *> files;
+
+    DIR * handle = opendir(directory);
+
+    if(handle == NULL) {
+        log_print("list_files", "Directory %s doesn't exist, is empty, or might be protected. No files will be returned.", directory);
+        return files;
+    }
+
+    while(struct dirent * entry = readdir(handle)) {
+        char * file_name = entry->d_name;
+
+        if((strcmp(file_name, ".") == 0) || (strcmp(file_name, "..") == 0)) continue;
+
+        char full_path[256];
+        snprintf(full_path, 256, "%s/%s", directory, file_name);
+
+        // d_type is not filled by every file system, fall back to stat when we don't know.
+        bool is_directory = (entry->d_type == DT_DIR);
+        if(entry->d_type == DT_UNKNOWN) {
+            struct stat file_info;
+            is_directory = (stat(full_path, &file_info) == 0) && S_ISDIR(file_info.st_mode);
+        }
+
+        if(is_directory) {
+            if(search_recursively) {
+                Array<char *> subtree = linux_list_all_files_in_directory(full_path);
+
+                // @Speed, could do a single memcpy here.
+                for_array(subtree.data, subtree.count) {
+                    files.add(*it);
+                }
+
+                subtree.reset(true);
+            }
+
+            continue;
+        }
+
+        files.add(strdup(full_path));
+    }
+
+    closedir(handle);
+
+    return files;
+}
@@ -0,0 +1,11 @@
+#include "array.h"
+#include "parsing.h"
+
+String linux_read_file(String path);
+int linux_get_file_size(String path);
+String linux_map_file(String path);
+void linux_unmap_file(String file_data);
+void * linux_open_file(String path);
+int linux_read_file_range(void * file, long long offset, void * destination, int size);
+void linux_close_file(void * file);
+Array<char *> linux_list_all_files_in_directory(char * directory, bool search_recursively = true);
@@ -0,0 +1,321 @@
+#include <assert.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+
+#include "macros.h"
+#include "hotloader.h"
+#include "asset_manager.h"
+#include "parsing.h"
+#include "os/layer.h"
+#include "profiler.h"
+
+struct Watch {
+    int descriptor;
+    char * path; // Relative to the working directory, eg. "data/textures"
+};
+
+// Private functions
+static void watcher_thread_proc(void * data);
+
+static void add_watches_recursively(char * path);
+
+static bool handle_events();
+
+static void rescan_directory(char * path);
+
+static void queue_file(char * directory, char * file_name);
+
+static struct timespec get_wall_time();
+
+// Const
+// Big enough for a few hundred events. We drain the descriptor until it's empty every time we check, so a small
+// buffer only costs us more read calls, it never loses anything.
+const int EVENT_BUFFER_LENGTH = 64 * 1024;
+
+const unsigned int WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF;
+
+// Globals
+static char * root_name = "data";
+
+static int inotify_handle = -1;
+static int wake_handle    = -1; // Written to by stop_hotloader_thread to get the watcher out of poll.
+
+static void * watcher_thread;
+
+static Array<Watch> watches;
+
+static char * event_buffer;
+
+// Files modified after that were not necessarily reported to us. We only move it forward once we know that we've seen
+// everything up to this point, and use it to know what to reload when the kernel queue overflows.
+static struct timespec last_sync_time;
+
+bool start_hotloader_thread() {
+    inotify_handle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if(inotify_handle < 0) {
+        log_print("init_hotloader", "Failed to create an inotify instance: %s", strerror(errno));
+        return false;
+    }
+
+    wake_handle = eventfd(0, EFD_CLOEXEC);
+
+    if(wake_handle < 0) {
+        log_print("init_hotloader", "Failed to create an eventfd: %s", strerror(errno));
+        close(inotify_handle);
+        inotify_handle = -1;
+        return false;
+    }
+
+    event_buffer = (char *) malloc(EVENT_BUFFER_LENGTH);
+
+    last_sync_time = get_wall_time();
+
+    // inotify isn't recursive, every directory needs its own watch. We add them before starting the thread so that
+    // nothing written after init_hotloader returns can be missed.
+    add_watches_recursively(root_name);
+
+    watcher_thread = os_specific_create_thread(watcher_thread_proc, NULL);
+
+    return watcher_thread != NULL;
+}
+
+static void watcher_thread_proc(void * data) {
+    set_profiler_thread_name("hotloader");
+
+    struct pollfd handles[2];
+    handles[0].fd     = inotify_handle;
+    handles[0].events = POLLIN;
+    handles[1].fd     = wake_handle;
+    handles[1].events = POLLIN;
+
+    while(true) {
+        // Sleeps until something happens in data/ or we're asked to stop.
+        int result = poll(handles, 2, -1);
+
+        if(result < 0) {
+            if(errno == EINTR) continue;
+
+            log_print("hotloader_thread", "poll failed (%s), hotloading is disabled.", strerror(errno));
+            return;
+        }
+
+        if(handles[1].revents) return; // stop_hotloader_thread
+
+        profile_zone("handle_events");
+
+        while(handle_events()) {
+            // Keep going.
+        }
+    }
+}
+
+static bool handle_events() {
+    struct timespec read_time = get_wall_time();
+
+    int bytes_read = read(inotify_handle, event_buffer, EVENT_BUFFER_LENGTH);
+
+    if(bytes_read < 0) {
+        if(errno == EAGAIN) {
+            // Nothing left in the queue, everything before read_time has been seen.
+            last_sync_time = read_time;
+        } else if(errno != EINTR) {
+            log_print("hotloader_thread", "Failed to read inotify events: %s", strerror(errno));
+        }
+
+        return (errno == EINTR);
+    }
+
+    bool overflowed = false;
+
+    char * cursor = event_buffer;
+    while(cursor < event_buffer + bytes_read) {
+        struct inotify_event * event = (struct inotify_event *) cursor;
+        cursor += sizeof(struct inotify_event) + event->len;
+
+        if(event->mask & IN_Q_OVERFLOW) {
+            overflowed = true;
+            continue;
+        }
+
+        // Find the directory this event happened in.
+        Watch * watch = NULL;
+        for(int i = 0; i < watches.count; i++) {
+            if(watches.data[i].descriptor == event->wd) {
+                watch = &watches.data[i];
+                break;
+            }
+        }
+
+        if(!watch) continue; // Directory was removed, we don't care about its last events.
+
+        if(event->mask & (IN_IGNORED | IN_DELETE_SELF)) {
+            inotify_rm_watch(inotify_handle, watch->descriptor);
+            free(watch->path);
+            watches.remove_by_index(watch - watches.data);
+            continue;
+        }
+
+        if(!event->len) continue;
+
+        if(event->mask & IN_ISDIR) {
+            if(event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                char path[256];
+                snprintf(path, 256, "%s/%s", watch->path, event->name);
+
+                // Files can land in there before our watch is up, so pick up what's already inside.
+                add_watches_recursively(path);
+                rescan_directory(path);
+            }
+            continue;
+        }
+
+        // IN_CREATE on a file is always followed by IN_CLOSE_WRITE, that's the one we want.
+        if(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+            queue_file(watch->path, event->name);
+        }
+    }
+
+    if(overflowed) {
+        // The kernel dropped events, we don't know which files changed. Rather than losing them, look at every file
+        // and reload the ones that were written since the last time we know we were in sync.
+        log_print("hotloader_thread", "inotify queue overflowed, rescanning %s", root_name);
+
+        struct timespec rescan_time = get_wall_time();
+
+        add_watches_recursively(root_name); // Directory creations might have been dropped too.
+        rescan_directory(root_name);
+
+        last_sync_time = rescan_time;
+    }
+
+    return true;
+}
+
+static void queue_file(char * directory, char * file_name) {
+    char path[256];
+    int path_length = snprintf(path, 256, "%s/%s", directory, file_name);
+
+    if(path_length >= 256) {
+        log_print("hotloader_thread", "Path %s/%s is too long, ignoring it.", directory, file_name);
+        return;
+    }
+
+    String full_path;
+    full_path.data  = (char *) malloc(path_length);
+    full_path.count = path_length;
+    memcpy(full_path.data, path, path_length);
+
+    Asset asset;
+    if(!make_asset_from_path(full_path, &asset)) {
+        free(full_path.data);
+        return;
+    }
+
+    push_asset_change(asset); // Duplicates are coalesced on the main thread.
+}
+
+static void rescan_directory(char * path) {
+    Array<char *> files = os_specific_list_all_files_in_directory(path);
+
+    for_array(files.data, files.count) {
+        struct stat file_info;
+
+        if(stat(*it, &file_info) == 0) {
+            bool modified = (file_info.st_mtim.tv_sec > last_sync_time.tv_sec) ||
+                            (file_info.st_mtim.tv_sec == last_sync_time.tv_sec && file_info.st_mtim.tv_nsec >= last_sync_time.tv_nsec);
+
+            if(modified) {
+                char * file_name = strrchr(*it, '/');
+                *file_name = '\0';
+                queue_file(*it, file_name + 1);
+            }
+        }
+
+        free(*it);
+    }
+
+    files.reset(true);
+}
+
+static void add_watches_recursively(char * path) {
+    int descriptor = inotify_add_watch(inotify_handle, path, WATCH_MASK | IN_ONLYDIR);
+
+    if(descriptor < 0) {
+        log_print("init_hotloader", "Failed to watch directory %s: %s", path, strerror(errno));
+        return;
+    }
+
+    // inotify gives back the same descriptor if we were already watching it.
+    bool already_watched = false;
+    for(int i = 0; i < watches.count; i++) {
+        if(watches.data[i].descriptor == descriptor) {
+            already_watched = true;
+            break;
+        }
+    }
+
+    if(!already_watched) {
+        Watch watch;
+        watch.descriptor = descriptor;
+        watch.path       = strdup(path);
+        watches.add(watch);
+    }
+
+    DIR * handle = opendir(path);
+    if(!handle) return;
+
+    while(struct dirent * entry = readdir(handle)) {
+        if((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0)) continue;
+
+        char full_path[256];
+        snprintf(full_path, 256, "%s/%s", path, entry->d_name);
+
+        struct stat file_info;
+        if(stat(full_path, &file_info) == 0 && S_ISDIR(file_info.st_mode)) {
+            add_watches_recursively(full_path);
+        }
+    }
+
+    closedir(handle);
+}
+
+static struct timespec get_wall_time() {
+    // File times are in wall clock time, so we can't use our monotonic clock to compare against them.
+    struct timespec time;
+    clock_gettime(CLOCK_REALTIME, &time);
+    return time;
+}
+
+void stop_hotloader_thread() {
+    if(inotify_handle < 0) return;
+
+    if(watcher_thread) {
+        unsigned long long value = 1;
+        write(wake_handle, &value, sizeof(value));
+
+        os_specific_join_thread(watcher_thread);
+        watcher_thread = NULL;
+    }
+
+    close(wake_handle);
+    wake_handle = -1;
+
+    for_array(watches.data, watches.count) {
+        free(it->path);
+    }
+    watches.reset(true);
+
+    close(inotify_handle);
+    inotify_handle = -1;
+
+    free(event_buffer);
+    event_buffer = NULL;
+}
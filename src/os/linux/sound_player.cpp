@@ -0,0 +1,16 @@
+// Headless builds have no audio device. The mixer plays into the null one, see null_audio.h, so voices start, end and
+// get freed like they would with a device, and nothing is kept.
+
+#include "sound_player.h"
+#include "null_audio.h"
+
+void linux_init_sound_player(void * handle) {
+    init_null_audio(NULL_AUDIO_DISCARD);
+    start_null_audio_thread();
+}
+
+void linux_shutdown_sound_player() {
+    shutdown_null_audio();
+}
+
+void linux_play_sound_wave(double wave_frequency, float length) {} // @Default length = -1.0f
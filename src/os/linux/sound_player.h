@@ -0,0 +1,3 @@
+void linux_init_sound_player(void * handle);
+void linux_shutdown_sound_player();
+void linux_play_sound_wave(double wave_frequency, float length = -1.0f);
@@ -1,6 +1,9 @@
 //@Incomplete, rework event system, reduce involvment on this end, make processing happen on the game side
 
 #include "windows.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
 
 #include "os/win32/core.h"
 
@@ -86,6 +89,10 @@ LRESULT CALLBACK WndProc(HWND window_handle, UINT message, WPARAM w_param, LPARA
                     local_keyboard.key_F3 = true;
                     break;
                 }
+                case VK_F4 : {
+                    local_keyboard.key_F4 = true;
+                    break;
+                }
                 case VK_ESCAPE : {
                     local_keyboard.key_ESC = true;
                     break;
@@ -137,6 +144,10 @@ LRESULT CALLBACK WndProc(HWND window_handle, UINT message, WPARAM w_param, LPARA
                     local_keyboard.key_F3 = false;
                     break;
                 }
+                case VK_F4 : {
+                    local_keyboard.key_F4 = false;
+                    break;
+                }
                 case VK_ESCAPE : {
                     local_keyboard.key_ESC = false;
                     break;
@@ -283,6 +294,59 @@ void win32_sleep(int ms) {
     Sleep(ms);
 }
 
+// Threads
+struct ThreadStart {
+    ThreadProc proc;
+    void * data;
+};
+
+static DWORD WINAPI thread_trampoline(LPVOID parameter) {
+    ThreadStart start = *(ThreadStart *) parameter;
+    free(parameter);
+
+    start.proc(start.data);
+
+    return 0;
+}
+
+void * win32_create_thread(ThreadProc proc, void * data) {
+    ThreadStart * start = (ThreadStart *) malloc(sizeof(ThreadStart));
+    start->proc = proc;
+    start->data = data;
+
+    HANDLE thread = CreateThread(NULL, 0, thread_trampoline, start, 0, NULL);
+
+    if(thread == NULL) {
+        log_print("create_thread", "Failed to create a thread. Error code is 0x%x", GetLastError());
+        free(start);
+    }
+
+    return (void *) thread;
+}
+
+void win32_join_thread(void * thread) {
+    WaitForSingleObject((HANDLE) thread, INFINITE);
+    CloseHandle((HANDLE) thread);
+}
+
+int win32_get_processor_count() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+}
+
+void * win32_create_semaphore(int initial_count) {
+    return (void *) CreateSemaphore(NULL, initial_count, LONG_MAX, NULL);
+}
+
+void win32_signal_semaphore(void * semaphore, int count) { // @Default count = 1
+    ReleaseSemaphore((HANDLE) semaphore, count, NULL);
+}
+
+void win32_wait_semaphore(void * semaphore) {
+    WaitForSingleObject((HANDLE) semaphore, INFINITE);
+}
+
 // DLL
 void * win32_load_dll(char * name) {
     return (void *) LoadLibrary(name);
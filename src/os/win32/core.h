@@ -1,3 +1,5 @@
+typedef void (*ThreadProc)(void * data);
+
 void * win32_create_window(int width, int height, char * name);
 
 struct Keyboard;
@@ -9,6 +11,15 @@ void win32_init_clock();
 double win32_get_time();
 void win32_sleep(int ms);
 
+// Threads
+void * win32_create_thread(ThreadProc proc, void * data);
+void win32_join_thread(void * thread);
+int  win32_get_processor_count();
+
+void * win32_create_semaphore(int initial_count);
+void win32_signal_semaphore(void * semaphore, int count = 1);
+void win32_wait_semaphore(void * semaphore);
+
 // DLL
 void * win32_load_dll(char * name);
 void * win32_get_address_from_dll(void * dll, char * name);
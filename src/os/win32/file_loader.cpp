@@ -31,6 +31,112 @@ String win32_read_file(String path) {
     return file_data;
 }
 
+// Returns -1, without complaining, if the file doesn't exist.
+int win32_get_file_size(String path) {
+    char * c_path = to_c_string(path);
+    scope_exit(free(c_path));
+
+    WIN32_FILE_ATTRIBUTE_DATA file_info;
+    if(!GetFileAttributesEx(c_path, GetFileExInfoStandard, &file_info)) return -1;
+
+    return (int) file_info.nFileSizeLow;
+}
+
+// Read only. Returns an empty string, without complaining, if the file doesn't exist.
+String win32_map_file(String path) {
+    char * c_path = to_c_string(path);
+    scope_exit(free(c_path));
+
+    String file_data;
+
+    HANDLE file_handle = CreateFile(c_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if(file_handle == INVALID_HANDLE_VALUE) {
+        DWORD error = GetLastError();
+        if(error != ERROR_FILE_NOT_FOUND) log_print("map_file", "Could not open the file \"%s\". Error code is 0x%x", c_path, error);
+        return file_data;
+    }
+
+    scope_exit(CloseHandle(file_handle)); // The view keeps the file and the mapping alive.
+
+    int file_size = GetFileSize(file_handle, NULL);
+
+    HANDLE mapping = CreateFileMapping(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    if(!mapping) {
+        log_print("map_file", "Could not create a mapping for the file \"%s\". Error code is 0x%x", c_path, GetLastError());
+        return file_data;
+    }
+
+    scope_exit(CloseHandle(mapping));
+
+    void * view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if(!view) {
+        log_print("map_file", "Could not map the file \"%s\". Error code is 0x%x", c_path, GetLastError());
+        return file_data;
+    }
+
+    file_data.data  = (char *) view;
+    file_data.count = file_size;
+
+    return file_data;
+}
+
+void win32_unmap_file(String file_data) {
+    UnmapViewOfFile(file_data.data);
+}
+
+// Read only, for reading a file a piece at a time with read_file_range. Others can still write to it or delete it
+// meanwhile. NULL, without complaining, if the file doesn't exist.
+void * win32_open_file(String path) {
+    char * c_path = to_c_string(path);
+    scope_exit(free(c_path));
+
+    HANDLE file_handle = CreateFile(c_path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if(file_handle == INVALID_HANDLE_VALUE) {
+        DWORD error = GetLastError();
+        if(error != ERROR_FILE_NOT_FOUND) log_print("open_file", "Could not open the file \"%s\". Error code is 0x%x", c_path, error);
+        return NULL;
+    }
+
+    return (void *) file_handle;
+}
+
+// The offset goes in the OVERLAPPED, so threads can read the same file. Returns how many bytes it read, less than size
+// past the end of the file, -1 on errors.
+int win32_read_file_range(void * file, long long offset, void * destination, int size) {
+    int bytes_read = 0;
+    while(bytes_read < size) {
+        long long position = offset + bytes_read;
+
+        OVERLAPPED overlapped = {};
+        overlapped.Offset     = (DWORD) position;
+        overlapped.OffsetHigh = (DWORD) (position >> 32);
+
+        DWORD result = 0;
+
+        if(!ReadFile((HANDLE) file, (char *) destination + bytes_read, size - bytes_read, &result, &overlapped)) {
+            DWORD error = GetLastError();
+            if(error == ERROR_HANDLE_EOF) break;
+
+            log_print("read_file_range", "An error occured while reading %d bytes at %lld. Error code is 0x%x", size, offset, error);
+            return -1;
+        }
+
+        if(result == 0) break; // End of the file
+
+        bytes_read += result;
+    }
+
+    return bytes_read;
+}
+
+void win32_close_file(void * file) {
+    CloseHandle((HANDLE) file);
+}
+
 Array<char *> win32_list_all_files_in_directory(char * directory, bool search_recursively) { // @Default search_recursively = true
     Array<char *> files;
 
@@ -3,4 +3,10 @@
 #include "parsing.h"
 
 String win32_read_file(String path);
+int win32_get_file_size(String path);
+String win32_map_file(String path);
+void win32_unmap_file(String file_data);
+void * win32_open_file(String path);
+int win32_read_file_range(void * file, long long offset, void * destination, int size);
+void win32_close_file(void * file);
 Array<char *> win32_list_all_files_in_directory(char * directory, bool search_recursively = true);
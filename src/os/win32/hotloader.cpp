@@ -3,9 +3,11 @@
 #include <stdio.h>
 
 #include "macros.h"
+#include "hotloader.h"
 #include "asset_manager.h"
 #include "parsing.h"
 #include "os/layer.h"
+#include "profiler.h"
 
 struct Directory {
     char * name;
@@ -15,33 +17,28 @@ struct Directory {
     OVERLAPPED overlapped;
 };
 
-struct AssetChange {
-    Asset asset; // @Cleanup see if we can remove this, are we gonna want other fields in the future ?
-};
-
 // Private functions
+static void watcher_thread_proc(void * data);
+
 static void issue_read_directory(Directory * directory);
 
 static bool handle_notifications();
 
 static FILE_NOTIFY_INFORMATION * bump_ptr_to_next_notification(FILE_NOTIFY_INFORMATION * notification);
 
-static void dispatch_file_to_managers(Asset asset);
+static void release_watcher_resources();
+
 // Const
 const int NOTIFICATION_BUFFER_LENGTH = 10000; // @Temporary figure out how much space is actually reasonably required
 
 // Globals
 static Directory dir;
 
-static Array<AssetChange> asset_changes;
+static HANDLE stop_event; // Signaled by stop_hotloader_thread to get the watcher out of its wait.
 
-static Array<AssetManager *> managers;
+static void * watcher_thread;
 
-void release(AssetChange * ac) {
-    free(ac->asset.full_path.data);
-}
-
-void init_hotloader() {
+bool start_hotloader_thread() {
     dir.name = "data";
 
     // Allocate space for windows' notifications
@@ -50,8 +47,9 @@ void init_hotloader() {
     // Create event needed for overlapped operation
     HANDLE event = CreateEvent(NULL, false, false, NULL);
     if(event == NULL) {
-        log_print("init_hotloader", "Failed to create event with CreateEvent. PANIC");
-        assert(false); // @Temporary, simply disable hotloading in that case.
+        log_print("init_hotloader", "Failed to create event with CreateEvent.");
+        release_watcher_resources();
+        return false;
     }
 
     // Fill overlapped struct
@@ -64,40 +62,49 @@ void init_hotloader() {
                                 OPEN_EXISTING,FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
 
     if(handle == INVALID_HANDLE_VALUE) {
-        log_print("init_hotloader", "Failed to get a handle to the %s directory with CreateFile. PANIC", dir.name);
-        assert(false);
+        log_print("init_hotloader", "Failed to get a handle to the %s directory with CreateFile.", dir.name);
+        release_watcher_resources();
+        return false;
     }
 
     dir.handle = handle;
 
-    // Successfully prepped the directory, now let's read it.
-    issue_read_directory(&dir);
-}
+    stop_event = CreateEvent(NULL, true, false, NULL);
+    if(stop_event == NULL) {
+        log_print("init_hotloader", "Failed to create the stop event with CreateEvent.");
+        release_watcher_resources();
+        return false;
+    }
 
-void register_manager(AssetManager * am) {
-    managers.add(am);
-}
+    // Successfully prepped the directory, now let's read it. The read is issued before the thread starts so that
+    // nothing written after init_hotloader returns can be missed.
+    issue_read_directory(&dir);
 
-void check_hotloader_modifications() {
-    while(handle_notifications()) {
-        // Keep going.
-    }
+    watcher_thread = os_specific_create_thread(watcher_thread_proc, NULL);
 
-    for_array(asset_changes.data, asset_changes.count) {
-        dispatch_file_to_managers(it->asset);
+    if(!watcher_thread) {
+        release_watcher_resources();
+        return false;
     }
 
-    asset_changes.reset(true);
+    return true;
 }
 
-static void dispatch_file_to_managers(Asset asset) {
-    // Look for a manager who's interested in changes of files with this extension
-    for_array(managers.data, managers.count) {
-        AssetManager * am = *it;
-        for(int j = 0; j < am->extensions.count; j++) { // @Cleanup This should be another for_array, but I can't nest them without redeclaring it and it_index, which is no good. We should be able to name it manually
-            if(string_compare(asset.extension, to_string(am->extensions.data[j]))) {
-                am->assets_to_reload.add(asset);
-            }
+static void watcher_thread_proc(void * data) {
+    set_profiler_thread_name("hotloader");
+
+    HANDLE events[2] = { dir.overlapped.hEvent, stop_event };
+
+    while(true) {
+        // Sleeps until the read request completes or we're asked to stop.
+        DWORD result = WaitForMultipleObjects(2, events, false, INFINITE);
+
+        if(result != WAIT_OBJECT_0) return; // stop_hotloader_thread, or the wait failed.
+
+        profile_zone("handle_notifications");
+
+        while(handle_notifications()) {
+            // Keep going.
         }
     }
 }
@@ -114,7 +121,7 @@ static bool handle_notifications() {
     // not complete, it will fail, it should be complete though since the call to the macro returned true.
 
     if(success == false) {
-        log_print("check_hotloader_modifications", "Failed to get notification. PANIC");
+        log_print("hotloader_thread", "Failed to get notification. PANIC");
         assert(false);
     }
 
@@ -128,9 +135,6 @@ static bool handle_notifications() {
 
     // log_print("check_hotloader_modifications", "Hotloader notification, bytes_transferred = %d", bytes_transferred);
 
-    // Fill our own notification struct, AssetChange
-    AssetChange change;
-
     FILE_NOTIFY_INFORMATION * notification = dir.notifications;
     while(notification != NULL) {
         if      (notification->Action == FILE_ACTION_MODIFIED)         {} // @Incomplete, maybe send the action to the relevant catalogs
@@ -150,100 +154,30 @@ static bool handle_notifications() {
                                          name_buffer, NAME_BUFFER_LENGTH, NULL, NULL);
 
         if(path_length == 0) {
-            log_print("check_hotloader_modifications", "Failed to convert filename. PANIC");
+            log_print("hotloader_thread", "Failed to convert filename. PANIC");
             assert(false);
         }
 
         notification = bump_ptr_to_next_notification(notification); // We'll bump it now to allow easy early-outs later
 
-        change.asset.full_path.data = (char *) malloc(path_length);
-        memcpy(change.asset.full_path.data, name_buffer, path_length);
-
-        change.asset.full_path.count = path_length;
-
-        // Replace Windows' \ by /
-        for (int i = 0; i < path_length; i++) {
-            if (change.asset.full_path[i] == '\\') change.asset.full_path[i] = '/';
-        }
-
-        // Isolate file name from the path
-        String file_name = find_char_from_right('/', change.asset.full_path);
-        if (file_name.count) {
-            change.asset.name = file_name;
-        } else {
-			change.asset.name = change.asset.full_path;
-		}
-
-		String extension = find_char_from_left('.', change.asset.name);
-
-		if (extension.count) { // Check that we have an extension
-			if (extension == "tmp") continue; // PS tmp file. We skip those.
-		} else {
-			continue; // Directory change, we ignore that.
-		}
-
-        change.asset.extension = extension;
+        String full_path;
+        full_path.data = (char *) malloc(path_length);
+        memcpy(full_path.data, name_buffer, path_length);
 
-        // Check uniqueness @Meh
-        bool success = true;
-        for_array(asset_changes.data, asset_changes.count) {
-			if (it->asset.full_path == change.asset.full_path) {
-                success = false;
+        full_path.count = path_length;
 
-                it_index = asset_changes.count; // Break
-            }
-        }
-
-        if(success) {
-            // printf("Added %s\n", to_c_string(change.full_path));
-            asset_changes.add(change);
-        } else {
+        Asset asset;
+        if(!make_asset_from_path(full_path, &asset)) {
+            free(full_path.data);
             continue;
         }
+
+        push_asset_change(asset); // Duplicates are coalesced on the main thread.
     }
 
     return true;
 }
 
-void hotloader_register_loose_files() {
-    Array<char *> files = os_specific_list_all_files_in_directory("data");
-
-    for_array(files.data, files.count) {
-        Asset asset;
-        asset.full_path.data  = *it;
-        asset.full_path.count = strlen(*it);
-
-		// @Cutnpaste @Refactor
-		// Replace Windows' \ by /
-		for (int i = 0; i < asset.full_path.count; i++) {
-			if (asset.full_path[i] == '\\') asset.full_path[i] = '/';
-		}
-
-		// Isolate file name from the path
-		String file_name = find_char_from_right('/', asset.full_path);
-		if (file_name.count) {
-			asset.name = file_name;
-		}
-		else {
-			asset.name = asset.full_path;
-		}
-
-		String extension = find_char_from_left('.', asset.name);
-
-		if (extension.count) { // Check that we have an extension
-			if (extension == "tmp") continue; // PS tmp file. We skip those.
-		}
-		else {
-			continue; // Directory change, we ignore that.
-		}
-
-		asset.extension = extension;
-
-        dispatch_file_to_managers(asset);
-    }
-}
-
-
 static FILE_NOTIFY_INFORMATION * bump_ptr_to_next_notification(FILE_NOTIFY_INFORMATION * notification) {
     int offset = notification->NextEntryOffset;
 
@@ -264,7 +198,41 @@ static void issue_read_directory(Directory * directory) {
     }
 }
 
-void shutdown_hotloader() {
-    CloseHandle(dir.handle);
+void stop_hotloader_thread() {
+    if(watcher_thread) {
+        SetEvent(stop_event);
+
+        os_specific_join_thread(watcher_thread);
+        watcher_thread = NULL;
+    }
+
+    release_watcher_resources();
+}
+
+// Whatever start_hotloader_thread got to create before it returned or failed, and only that.
+static void release_watcher_resources() {
+    if(dir.handle) {
+        // Cancel the pending read, and wait for it to be done with: the kernel can write to the buffer and signal the
+        // event until it completes. FALSE means there was nothing pending, and nothing to wait for.
+        if(CancelIoEx(dir.handle, &dir.overlapped)) {
+            DWORD bytes;
+            GetOverlappedResult(dir.handle, &dir.overlapped, &bytes, TRUE); // Fails with ERROR_OPERATION_ABORTED, that's expected.
+        }
+
+        CloseHandle(dir.handle);
+        dir.handle = NULL;
+    }
+
+    if(dir.overlapped.hEvent) {
+        CloseHandle(dir.overlapped.hEvent);
+        dir.overlapped.hEvent = NULL;
+    }
+
+    if(stop_event) {
+        CloseHandle(stop_event);
+        stop_event = NULL;
+    }
+
     free(dir.notifications);
+    dir.notifications = NULL;
 }
@@ -3,42 +3,45 @@
 #include <dsound.h>
 #include <math.h>
 #include <malloc.h>
+#include <atomic>
 
 #include "sound_player.h"
+#include "core.h"
+#include "audio_mixer.h"
+#include "null_audio.h"
 #include "macros.h"
 #include "array.h"
 #include "math_m.h"
+#include "profiler.h"
 
 
-struct Sound {
-    int num_channels;
-    double * data;
-    int num_samples;
+// Private functions
+static void mix_into_buffer(void * data);
+static void fall_back_to_null_audio(char * reason, HRESULT result);
 
-    double length;
-    double samples_per_sec;
-    double time_offset;
+// Const
+const int buffer_length_in_sec = 1;
 
-    bool is_playing;
-    float num_loops;
-};
+const int bytes_per_output_frame = MIXER_OUTPUT_CHANNELS * sizeof(short);
 
-static IDirectSound8 * ds_interface;
-static IDirectSoundBuffer8 * ds_buffer;
+const int MIXING_PERIOD_MS  = 10; // How often the mixing thread wakes up.
+const int MIXING_LATENCY_MS = 40; // How far past the write cursor it keeps the buffer filled, has to cover a period and Sleep's slack.
 
-static int buffer_length_in_sec = 1;
+const int NUM_SAMPLES_PER_WAVE = 1024;
 
-static Array<Sound*> sounds;
+// Globals
+static IDirectSound8 * ds_interface;
+static IDirectSoundBuffer8 * ds_buffer;
 
-const int playing_frequency = 22050;
-const int bytes_per_output_sample = 2;
+static void * mixing_thread;
+static std::atomic<bool> keep_mixing;
 
 void win32_init_sound_player(void * handle) {
     // Create the interface
     HRESULT result = DirectSoundCreate8(NULL, &ds_interface, NULL);
     if(!SUCCEEDED(result)) {
-        // @Incomplete, Failed to get an interface, should either disable sound playing or try again.
-        assert(false);
+        fall_back_to_null_audio("Could not get a DirectSound interface", result);
+        return;
     }
 
     ds_interface->SetCooperativeLevel((HWND) handle, DSSCL_PRIORITY);
@@ -46,9 +49,9 @@ void win32_init_sound_player(void * handle) {
     // Create wave format
     WAVEFORMATEX wave_format = {};
     wave_format.wFormatTag      = WAVE_FORMAT_PCM;
-    wave_format.nChannels       = 1; // @Temporary only one channel for now.
-    wave_format.nSamplesPerSec  = playing_frequency; // 22.05kHz seems reasonable
-    wave_format.wBitsPerSample  = bytes_per_output_sample * 8;
+    wave_format.nChannels       = MIXER_OUTPUT_CHANNELS;
+    wave_format.nSamplesPerSec  = MIXER_OUTPUT_RATE;
+    wave_format.wBitsPerSample  = sizeof(short) * 8;
     wave_format.nBlockAlign     = wave_format.nChannels * wave_format.wBitsPerSample / 8;
     wave_format.nAvgBytesPerSec = wave_format.nBlockAlign * wave_format.nSamplesPerSec;
     wave_format.cbSize          = 0;
@@ -66,135 +69,119 @@ void win32_init_sound_player(void * handle) {
 
     result = ds_interface->CreateSoundBuffer(&buffer_desc, &buffer, NULL);
     if(!SUCCEEDED(result)) {
-        // @Incomplete, failed to get a buffer, should either disable sound playing or try again.
-        assert(false);
+        fall_back_to_null_audio("Could not create a sound buffer", result);
+        return;
     }
 
     result = buffer->QueryInterface(IID_IDirectSoundBuffer8, (void **) &ds_buffer);
     if(!SUCCEEDED(result)) {
-        // @Incomplete, failed to get a buffer, should either disable sound playing or try again.
-        assert(false);
+        fall_back_to_null_audio("Could not get a DirectSound 8 buffer", result);
+        return;
     }
 
+    init_audio_mixer();
+
     ds_buffer->Play(0, 0, DSBPLAY_LOOPING);
 
+    keep_mixing.store(true);
+    mixing_thread = win32_create_thread(mix_into_buffer, NULL);
 }
 
-static const int NUM_SAMPLES_PER_WAVE = 1024;
-static unsigned long previous_write_position = 0;
-unsigned long previous_write_cursor_position = 0;
-void win32_play_sounds(double delta_t) {
-    float write_ahead_factor = 3.0f;
-
-    unsigned long write_cursor_position = 0;
-    unsigned long play_cursor_position = 0;
-    ds_buffer->GetCurrentPosition(&play_cursor_position, &write_cursor_position);
+void win32_shutdown_sound_player() {
+    if(!mixing_thread) {
+        shutdown_null_audio(); // Nothing to do if we didn't fall back.
+        return;
+    }
 
-    // Here we compute the position of the write cursor
-	int predicted_write_position = previous_write_position + (int) (delta_t * playing_frequency * bytes_per_output_sample + 0.5);
+    keep_mixing.store(false);
+    win32_join_thread(mixing_thread);
+    mixing_thread = NULL;
 
-	int write_position = write_cursor_position;
+    ds_buffer->Stop();
+}
 
-	int buffer_length = playing_frequency * buffer_length_in_sec * bytes_per_output_sample;
+// No device, or not one we can use. Everything plays the same, nobody hears it.
+static void fall_back_to_null_audio(char * reason, HRESULT result) {
+    log_print("sound_player", "%s (0x%x), the game will be silent", reason, result);
 
-	if (predicted_write_position > buffer_length) {
-		predicted_write_position = predicted_write_position % (buffer_length);
+    init_null_audio(NULL_AUDIO_DISCARD);
+    start_null_audio_thread();
+}
 
-		if (write_cursor_position > buffer_length * 0.5) { // Wrapped but write cursor is still at the end (second half of buffer)
-			write_position = predicted_write_position;
-		}
-		else {
-			write_position = max(predicted_write_position, write_cursor_position);
-		}
-	} else {
-		if (write_cursor_position < previous_write_cursor_position) { // Cursor wrapped, but not predicted
-			write_position = write_cursor_position;
-		}
-		else {
-			write_position = max(predicted_write_position, write_cursor_position);
-		}
-	}
+// The mixing thread. Every period, tops the buffer up to MIXING_LATENCY_MS past the write cursor, from where we
+// stopped writing last time, so nothing depends on how long the game's frames take.
+static void mix_into_buffer(void * data) {
+    set_profiler_thread_name("audio");
 
-    int samples_to_write = min(buffer_length_in_sec, delta_t * write_ahead_factor) * playing_frequency * bytes_per_output_sample;
+    int buffer_length  = MIXER_OUTPUT_RATE * buffer_length_in_sec * bytes_per_output_frame;
+    int latency_length = MIXER_OUTPUT_RATE * MIXING_LATENCY_MS / 1000 * bytes_per_output_frame;
 
-    log_print("sound_player", "Play cursor at %d, Write cursor at %d, writing %d samples at %d", play_cursor_position, write_cursor_position, samples_to_write, write_position);
+    short * mixed = (short *) malloc(latency_length);
+    scope_exit(free(mixed));
 
-    double * temp_buffer = (double *) calloc(samples_to_write, sizeof(double));
-    scope_exit(free(temp_buffer));
+    int write_position = -1; // Where we're done writing, in bytes. Nowhere yet.
 
-    for_array(sounds.data, sounds.count) {
-		Sound * sound = *it;
-        //log_print("sound_player", "CLEAR");
-		for (int offset = 0; offset < samples_to_write; offset++) {
-            if(sound->is_playing) {
+    while(keep_mixing.load()) {
+        unsigned long play_cursor_position  = 0;
+        unsigned long write_cursor_position = 0;
+        ds_buffer->GetCurrentPosition(&play_cursor_position, &write_cursor_position);
 
-                int sample_index = (int)(sound->time_offset*sound->samples_per_sec + offset * ((double)sound->samples_per_sec/(playing_frequency) ));
+        int ahead = (write_position - (int) write_cursor_position + buffer_length) % buffer_length;
 
-                double sample_index_dec = (sound->time_offset*sound->samples_per_sec + offset * ((double)sound->samples_per_sec/playing_frequency)) - sample_index;
+        // We fell behind the write cursor, the device played what we had and then some. Start again from it.
+        if(write_position < 0 || ahead > latency_length) {
+            if(write_position >= 0) log_print("sound_player", "The mixing thread fell behind, the sound skipped");
 
-                sample_index = sample_index % sound->num_samples;
+            write_position = write_cursor_position;
+            ahead          = 0;
+        }
 
-                double sample = lerp(sound->data[sample_index], sound->data[(sample_index+1)% sound->num_samples], sample_index_dec);
+        int bytes_to_write = latency_length - ahead;
 
-                //log_print("KK", "%d, %f, %d", sample_index, sample_index_dec, (char)(int)(100*sample));
+        if(bytes_to_write >= MIX_BLOCK_FRAMES * bytes_per_output_frame) {
+            bytes_to_write -= bytes_to_write % bytes_per_output_frame;
 
-                temp_buffer[offset] += sample; // @Temporary, Handle channels
-            }
-        }
+            profile_zone("mix_audio");
 
-        sound->time_offset += delta_t;
-        if(sound->num_loops >= 0.0) {
-            if(sound->time_offset > sound->length * sound->num_loops) {
-                // Sound is done playing, should remove it from the list, but can't right now, so just turning it off @Leak.
-                sound->is_playing = false;
-            }
-        } else {
-            if(sound->time_offset > sound->length) {
-                sound->time_offset = fmod(sound->time_offset, sound->length);
-            }
-        }
-    }
+            mix_audio(mixed, bytes_to_write / bytes_per_output_frame);
 
-	short * byte_buffer = (short *) calloc(samples_to_write * bytes_per_output_sample, 1);
-    scope_exit(free(byte_buffer));
-	for (int i = 0; i < samples_to_write; i++) {
-		byte_buffer[i] = (short)(100000*temp_buffer[i]);
-        //log_print("sound_player", "Sound output at offset %d is %d", write_position + i, byte_buffer[i]);
-	}
+            char * write_1_pointer, * write_2_pointer;
+            unsigned long write_1_length, write_2_length;
 
-    char * write_1_pointer, * write_2_pointer;
-    unsigned long write_1_length, write_2_length;
+            HRESULT result = ds_buffer->Lock(write_position, bytes_to_write, (void**) &write_1_pointer, &write_1_length, (void**) &write_2_pointer, &write_2_length, 0);
 
-    ds_buffer->Lock(write_position, samples_to_write * bytes_per_output_sample, (void**) &write_1_pointer, &write_1_length, (void**) &write_2_pointer, &write_2_length, 0);
+            if(SUCCEEDED(result)) {
+                memcpy((void *) write_1_pointer, (void *) mixed, write_1_length);
 
-    memcpy((void *) write_1_pointer, (void *) byte_buffer, write_1_length);
+                if (write_2_pointer != NULL) {
+                    memcpy((void *) write_2_pointer, (void *) ((char *) mixed + write_1_length), write_2_length);
+                }
 
-	if (write_2_pointer != NULL) {
-		memcpy((void *)write_2_pointer, (void *)(byte_buffer + write_1_length), write_2_length);
-		int x = 4;
-	}
+                ds_buffer->Unlock((void*) write_1_pointer, write_1_length, (void*) write_2_pointer, write_2_length);
+            }
 
-    ds_buffer->Unlock((void*) write_1_pointer, write_1_length, (void*) write_2_pointer, write_2_length);
+            write_position = (write_position + bytes_to_write) % buffer_length;
+        }
 
-    previous_write_cursor_position = write_cursor_position;
-    previous_write_position = write_position;
+        win32_sleep(MIXING_PERIOD_MS);
+    }
 }
 
+// One period of a sine, looped for as long as it plays.
 void win32_play_sound_wave(double wave_frequency, float length) { // @Default length = -1.0f
-    Sound * wave = (Sound *) malloc(sizeof(Sound));
-    wave->num_channels  = 1;
-    wave->num_samples   = NUM_SAMPLES_PER_WAVE;
-    wave->is_playing    = true;
-    wave->length        = 1.0 / wave_frequency;
-    wave->num_loops     = length / wave->length;
-    wave->samples_per_sec = wave->num_samples * wave_frequency;
-    wave->time_offset   = 0.0;
-
-    wave->data = (double *) malloc(wave->num_samples * sizeof(double));
-
-    for(int i = 0; i < wave->num_samples; i++) {
-        wave->data[i] = sin((double) i / wave->num_samples * TAU);
+    AudioClip * wave = (AudioClip *) malloc(sizeof(AudioClip)); // @Leak, voices don't tell us when they're done with it.
+    wave->num_frames   = NUM_SAMPLES_PER_WAVE;
+    wave->num_channels = 1;
+    wave->sample_rate  = (int) (NUM_SAMPLES_PER_WAVE * wave_frequency + 0.5);
+
+    wave->samples = (float *) malloc(wave->num_frames * sizeof(float));
+
+    for(int i = 0; i < wave->num_frames; i++) {
+        wave->samples[i] = (float) sin((double) i / wave->num_frames * TAU);
     }
 
-    sounds.add(wave);
+    int loops = LOOP_FOREVER;
+    if(length >= 0.0f) loops = max((int) (length * wave_frequency + 0.5) - 1, 0);
+
+    play_clip(wave, 0.25f, 0.0f, loops);
 }
@@ -1,5 +1,5 @@
 #include "windows.h"
 
 void win32_init_sound_player(void * handle);
-void win32_play_sounds(double delta_t);
+void win32_shutdown_sound_player();
 void win32_play_sound_wave(double wave_frequency, float length = -1.0f);
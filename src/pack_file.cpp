@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "pack_file.h"
+#include "macros.h"
+#include "os/layer.h"
+
+// Private functions
+static PackEntry * find_packed_file(String full_path);
+static String get_entry_name(PackEntry * entry);
+
+// Globals
+// The pack is read only once it's open, so workers can read from it without locking.
+static String pack_data; // The whole file, mapped.
+
+static PackHeader * header;
+static PackEntry  * entries;
+static char       * names;
+
+bool open_pack_file(char * path) {
+    pack_data = os_specific_map_file(to_string(path));
+
+    if(!pack_data.data) return false; // No pack, we'll use the loose files.
+
+    if(pack_data.count < sizeof(PackHeader)) {
+        log_print("open_pack_file", "%s is too small to be a pack", path);
+        close_pack_file();
+        return false;
+    }
+
+    header = (PackHeader *) pack_data.data;
+
+    if(header->magic != PACK_MAGIC || header->version != PACK_VERSION) {
+        log_print("open_pack_file", "%s is not a pack, or was made by another version of the builder (version %u, we want %u)", path, header->version, PACK_VERSION);
+        close_pack_file();
+        return false;
+    }
+
+    unsigned long long toc_size = sizeof(PackHeader) + (unsigned long long) header->num_entries * sizeof(PackEntry) + header->names_size;
+
+    if(toc_size > (unsigned long long) pack_data.count) {
+        log_print("open_pack_file", "The table of contents of %s goes past the end of the file", path);
+        close_pack_file();
+        return false;
+    }
+
+    entries = (PackEntry *) (header + 1);
+    names   = (char *) (entries + header->num_entries);
+
+    for(unsigned int i = 0; i < header->num_entries; i++) {
+        PackEntry * entry = &entries[i];
+
+        if(entry->offset + entry->size > (unsigned long long) pack_data.count || entry->name_offset + entry->name_length > header->names_size) {
+            log_print("open_pack_file", "Entry %u of %s goes past the end of the file", i, path);
+            close_pack_file();
+            return false;
+        }
+    }
+
+    log_print("open_pack_file", "Opened %s, %u files", path, header->num_entries);
+
+    return true;
+}
+
+void close_pack_file() {
+    if(pack_data.data) os_specific_unmap_file(pack_data);
+
+    pack_data.data  = NULL;
+    pack_data.count = 0;
+
+    header  = NULL;
+    entries = NULL;
+    names   = NULL;
+}
+
+bool is_pack_file_open() {
+    return header != NULL;
+}
+
+Array<char *> list_packed_files() {
+    Array<char *> files;
+
+    if(!is_pack_file_open()) return files;
+
+    for(unsigned int i = 0; i < header->num_entries; i++) {
+        files.add(to_c_string(get_entry_name(&entries[i])));
+    }
+
+    return files;
+}
+
+String read_asset_file(String full_path, unsigned long long * content_hash) { // @Default content_hash = NULL
+    PackEntry * entry = find_packed_file(full_path);
+
+    if(!entry) {
+        String file_data = os_specific_read_file(full_path);
+
+        if(file_data.data && content_hash) *content_hash = murmur_hash_64a(file_data.data, file_data.count, 0);
+
+        return file_data;
+    }
+
+    String file_data;
+    file_data.data  = pack_data.data + entry->offset;
+    file_data.count = (int) entry->size;
+
+    if(content_hash) *content_hash = entry->content_hash;
+
+    return file_data;
+}
+
+void free_asset_file(String file_data) {
+    bool is_in_pack = (file_data.data >= pack_data.data) && (file_data.data < pack_data.data + pack_data.count);
+
+    if(!is_in_pack) free(file_data.data); // It's mapped, nothing to free.
+}
+
+String map_asset_file(String full_path) {
+    PackEntry * entry = find_packed_file(full_path);
+
+    if(!entry) return os_specific_map_file(full_path);
+
+    String file_data;
+    file_data.data  = pack_data.data + entry->offset;
+    file_data.count = (int) entry->size;
+
+    return file_data;
+}
+
+void unmap_asset_file(String file_data) {
+    bool is_in_pack = (file_data.data >= pack_data.data) && (file_data.data < pack_data.data + pack_data.count);
+
+    if(!is_in_pack) os_specific_unmap_file(file_data);
+}
+
+bool open_asset_file(String full_path, AssetFile * file) {
+    PackEntry * entry = find_packed_file(full_path);
+
+    file->packed.data  = NULL;
+    file->packed.count = 0;
+    file->handle       = NULL;
+
+    if(entry) {
+        file->packed.data  = pack_data.data + entry->offset;
+        file->packed.count = (int) entry->size;
+        return true;
+    }
+
+    file->handle = os_specific_open_file(full_path);
+
+    return file->handle != NULL;
+}
+
+int read_asset_file_range(AssetFile * file, long long offset, void * destination, int size) {
+    if(!file->packed.data) return os_specific_read_file_range(file->handle, offset, destination, size);
+
+    if(offset >= file->packed.count) return 0;
+    if(offset + size > file->packed.count) size = (int) (file->packed.count - offset);
+
+    memcpy(destination, file->packed.data + offset, size);
+
+    return size;
+}
+
+void close_asset_file(AssetFile * file) {
+    if(file->handle) os_specific_close_file(file->handle);
+
+    file->handle = NULL;
+}
+
+int get_asset_file_size(String full_path) {
+    PackEntry * entry = find_packed_file(full_path);
+
+    if(!entry) return os_specific_get_file_size(full_path);
+
+    return (int) entry->size;
+}
+
+// Binary search on the name hash, then we check the actual name in case two paths share a hash.
+static PackEntry * find_packed_file(String full_path) {
+    if(!is_pack_file_open()) return NULL;
+
+    unsigned long long name_hash = get_pack_name_hash(full_path);
+
+    int first = 0;
+    int last  = (int) header->num_entries; // Exclusive
+
+    while(first < last) {
+        int middle = first + (last - first) / 2;
+
+        if(entries[middle].name_hash < name_hash) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+
+    for(int i = first; i < (int) header->num_entries && entries[i].name_hash == name_hash; i++) {
+        if(get_entry_name(&entries[i]) == full_path) return &entries[i];
+    }
+
+    return NULL;
+}
+
+static String get_entry_name(PackEntry * entry) {
+    String name;
+    name.data  = names + entry->name_offset;
+    name.count = entry->name_length;
+
+    return name;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "parsing.h"
+#include "hash.h"
+
+// A pack bundles the whole data directory in a single file, so shipping builds open one file instead of hundreds.
+// The builder writes it (see /pack in builder.cpp) and the game maps it at startup if it finds one.
+//
+// Layout:
+//     PackHeader
+//     PackEntry, num_entries times, sorted by name_hash
+//     Names, names_size bytes, not null terminated
+//     File data, each file starts on a PACK_DATA_ALIGNMENT boundary
+
+const unsigned int PACK_MAGIC   = 0x4b503347; // "G3PK"
+const unsigned int PACK_VERSION = 1;
+
+const int PACK_DATA_ALIGNMENT = 16;
+
+struct PackHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int num_entries;
+    unsigned int names_size;
+};
+
+struct PackEntry {
+    unsigned long long name_hash;    // get_pack_name_hash of the path, eg. "data/textures/tree.png"
+    unsigned long long offset;       // From the beginning of the pack.
+    unsigned long long size;
+    unsigned long long content_hash; // murmur_hash_64a of the data, same as Asset::content_hash.
+
+    unsigned int name_offset;        // From the beginning of the names.
+    unsigned int name_length;
+};
+
+inline unsigned long long get_pack_name_hash(String name) { return murmur_hash_64a(name.data, name.count, 0); }
+
+bool open_pack_file(char * path);
+void close_pack_file();
+
+bool is_pack_file_open();
+
+Array<char *> list_packed_files(); // Same thing as os_specific_list_all_files_in_directory, but for the pack.
+
+// What the managers use to get at their files. Reads from the pack when one is open, from the disk otherwise. Thread
+// safe. content_hash is optional, packed files get it from the table of contents instead of hashing the data again.
+String read_asset_file(String full_path, unsigned long long * content_hash = NULL);
+void free_asset_file(String file_data);
+
+// Same, but loose files get mapped instead of read, only the pages we touch come from the disk. For files we only look
+// at a piece of, like the header of a sound. Don't keep a mapping around while the file can change: on Linux, touching
+// a page past the end of a file that got shorter is a SIGBUS.
+String map_asset_file(String full_path);
+void unmap_asset_file(String file_data);
+
+// For reading a file a piece at a time for as long as we like, like streamed sounds. Pieces are copied out, from the
+// pack or with os_specific_read_file_range for loose files, so a file that changes under us only gives short reads.
+struct AssetFile {
+    String packed; // The file in the pack, data is NULL if it's loose.
+    void * handle; // From os_specific_open_file, for loose files.
+};
+
+bool open_asset_file(String full_path, AssetFile * file);
+int  read_asset_file_range(AssetFile * file, long long offset, void * destination, int size); // Bytes read, fewer past the end, -1 on errors.
+void close_asset_file(AssetFile * file);
+
+int get_asset_file_size(String full_path); // -1 if there is no such file.
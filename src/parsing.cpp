@@ -236,14 +236,14 @@ void push(String * string, int amount) { // @Default amount = 1
 
 int cut_spaces(String * string) {
     int orig_count = string->count;
-    while((*string)[0] == ' ') push(string);
+    while(string->count > 0 && (*string)[0] == ' ') push(string);
     return orig_count - string->count;
 }
 
 
 int cut_trailing_spaces(String * string) {
     int orig_count = string->count;
-    while((*string)[string->count - 1] == ' ') string->count -= 1;
+    while(string->count > 0 && (*string)[string->count - 1] == ' ') string->count -= 1;
     return orig_count - string->count;
 }
 
@@ -326,3 +326,33 @@ String find_char_from_left(char c, String string) {
 
     return rhs;
 }
+
+// UTF-8. Bytes that don't start a valid sequence come out as U+FFFD, one at a time, so we always make progress.
+int next_codepoint(char ** cursor) {
+    unsigned char * c = (unsigned char *) *cursor;
+
+    int codepoint;
+    int length;
+
+    if     (c[0] < 0x80)           { codepoint = c[0];        length = 1; }
+    else if((c[0] & 0xe0) == 0xc0) { codepoint = c[0] & 0x1f; length = 2; }
+    else if((c[0] & 0xf0) == 0xe0) { codepoint = c[0] & 0x0f; length = 3; }
+    else if((c[0] & 0xf8) == 0xf0) { codepoint = c[0] & 0x07; length = 4; }
+    else {
+        *cursor += 1;
+        return 0xfffd;
+    }
+
+    for(int i = 1; i < length; i++) {
+        if((c[i] & 0xc0) != 0x80) { // Also stops at the terminator.
+            *cursor += i;
+            return 0xfffd;
+        }
+
+        codepoint = (codepoint << 6) | (c[i] & 0x3f);
+    }
+
+    *cursor += length;
+
+    return codepoint;
+}
@@ -14,7 +14,7 @@ struct String { // @Cleanup, move out of here.
         return this->data[i];
     }
 
-    String& operator=(String & string) {
+    String& operator=(const String & string) {
         this->count = string.count;
         this->data  = string.data;
 
@@ -72,3 +72,5 @@ String to_string_copy(char * c_string);
 
 String find_char_from_right(char c, String string);
 String find_char_from_left (char c, String string);
+
+int next_codepoint(char ** cursor); // Decodes the codepoint at *cursor and moves past it.
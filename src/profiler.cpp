@@ -0,0 +1,438 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profiler.h"
+#include "array.h"
+#include "os/layer.h"
+
+// A zone that began, as far as next_profiler_frame has read. It can end frames later.
+struct OpenZone {
+    char * name;
+    double begin_time;
+
+    int node; // In this frame's tree, -1 until something in it ends.
+};
+
+// One for every thread that ever began a zone, never freed, next_profiler_frame could be reading it.
+struct ProfilerThread {
+    std::atomic<char *> name;
+
+    // The thread writes events then moves write_index, next_profiler_frame reads them then moves read_index.
+    ProfileEvent events[PROFILER_RING_SIZE];
+    std::atomic<unsigned int> write_index;
+    std::atomic<unsigned int> read_index;
+
+    int open_zones; // The thread's, recorded zones that haven't ended.
+    std::atomic<int> dropped_zones;
+
+    // next_profiler_frame's
+    OpenZone stack[MAX_PROFILE_DEPTH];
+    int depth;
+
+    int root; // This frame's, -1 if none yet.
+};
+
+struct CapturedZone {
+    char * name;
+    int thread;
+
+    double begin_time;
+    double end_time;
+};
+
+// Private functions
+static ProfilerThread * get_this_thread();
+
+static void read_thread_events(ProfilerThread * thread, int thread_index);
+static int  get_zone_node(ProfilerThread * thread, int thread_index, int level);
+static int  get_thread_root(ProfilerThread * thread, int thread_index);
+static int  find_or_add_child(int parent, char * name);
+static int  add_node(char * name, int thread_index, int parent);
+
+static void print_profile_node(ProfileFrame * frame, int index);
+
+static void capture_zone(char * name, int thread_index, double begin_time, double end_time);
+static void write_profile_capture();
+static void write_json_string(FILE * file, char * string);
+
+// Globals
+static std::atomic<ProfilerThread *> threads[MAX_PROFILER_THREADS];
+static std::atomic<int> num_threads;
+
+static thread_local ProfilerThread * this_thread;
+static thread_local bool out_of_threads;
+
+static char default_thread_names[MAX_PROFILER_THREADS][16]; // "thread <n>"
+
+// next_profiler_frame's
+static ProfileNode nodes[MAX_PROFILE_NODES];
+static ProfileFrame frame = { nodes, 0, -1, -1 }; // No roots until the first next_profiler_frame.
+
+static int last_root;
+static double last_frame_time;
+
+// The capture, main thread only.
+static char * capture_path;
+static int capture_frames_left; // 0 when not capturing.
+static double capture_start_time;
+
+static Array<CapturedZone> captured_zones;
+static Array<double> captured_frames; // When each one ended.
+
+void set_profiler_thread_name(char * name) {
+    ProfilerThread * thread = get_this_thread();
+    if(thread) thread->name.store(name, std::memory_order_release);
+}
+
+bool begin_profile_zone(char * name) {
+    ProfilerThread * thread = get_this_thread();
+    if(!thread) return false;
+
+    unsigned int write = thread->write_index.load(std::memory_order_relaxed);
+    unsigned int read  = thread->read_index.load(std::memory_order_acquire);
+
+    int space = PROFILER_RING_SIZE - (int) (write - read);
+
+    // Room for it and for its end, and for the ends of the zones already open, those can't be dropped.
+    if(space < thread->open_zones + 2 || thread->open_zones == MAX_PROFILE_DEPTH) {
+        thread->dropped_zones.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    ProfileEvent * event = &thread->events[write & (PROFILER_RING_SIZE - 1)];
+    event->name = name;
+    event->time = os_specific_get_time();
+
+    thread->write_index.store(write + 1, std::memory_order_release);
+    thread->open_zones += 1;
+
+    return true;
+}
+
+// begin_profile_zone made room for it.
+void end_profile_zone() {
+    double time = os_specific_get_time();
+
+    ProfilerThread * thread = this_thread;
+
+    unsigned int write = thread->write_index.load(std::memory_order_relaxed);
+
+    ProfileEvent * event = &thread->events[write & (PROFILER_RING_SIZE - 1)];
+    event->name = NULL;
+    event->time = time;
+
+    thread->write_index.store(write + 1, std::memory_order_release);
+    thread->open_zones -= 1;
+}
+
+// Zones are counted in the frame they end in, even if they began in an earlier one, that's only ever the case for
+// other threads than ours.
+void next_profiler_frame() {
+    double now = os_specific_get_time();
+
+    frame.frame_time    = last_frame_time ? now - last_frame_time : 0.0;
+    frame.num_nodes     = 0;
+    frame.dropped_zones = 0;
+    frame.first_root    = -1;
+    frame.main_root     = -1;
+
+    last_frame_time = now;
+    last_root       = -1;
+
+    int count = num_threads.load(std::memory_order_acquire);
+    if(count > MAX_PROFILER_THREADS) count = MAX_PROFILER_THREADS;
+
+    for(int i = 0; i < count; i++) {
+        ProfilerThread * thread = threads[i].load(std::memory_order_acquire);
+        if(!thread) continue; // Still registering.
+
+        thread->root = -1;
+        for(int level = 0; level < thread->depth; level++) thread->stack[level].node = -1;
+
+        read_thread_events(thread, i);
+
+        if(thread == this_thread) frame.main_root = thread->root;
+    }
+
+    // Roots are only their children's sum. Children come after their parents.
+    for(int i = 0; i < frame.num_nodes; i++) {
+        ProfileNode * node = &nodes[i];
+        if(node->parent < 0) continue;
+
+        ProfileNode * parent = &nodes[node->parent];
+
+        if(parent->parent < 0) parent->total_time += node->total_time;
+        else                   parent->self_time  -= node->total_time;
+    }
+
+    // Zones still open on another thread have children that ended, but no time of their own yet.
+    for(int i = 0; i < frame.num_nodes; i++) {
+        if(nodes[i].self_time < 0.0) nodes[i].self_time = 0.0;
+    }
+
+    if(capture_frames_left) {
+        captured_frames.add(now);
+        capture_frames_left -= 1;
+
+        if(!capture_frames_left) write_profile_capture();
+    }
+}
+
+bool start_profile_capture(char * path, int num_frames) { // @Default num_frames = PROFILE_CAPTURE_FRAMES
+    if(capture_frames_left) return false;
+
+    capture_path        = path;
+    capture_frames_left = num_frames > 0 ? num_frames : 1;
+    capture_start_time  = last_frame_time ? last_frame_time : os_specific_get_time();
+
+    captured_zones.reset();
+    captured_frames.reset();
+
+    return true;
+}
+
+bool is_profile_capturing() {
+    return capture_frames_left != 0;
+}
+
+ProfileFrame * get_profile_frame() {
+    return &frame;
+}
+
+char * get_profiler_thread_name(int thread_index) {
+    ProfilerThread * thread = threads[thread_index].load(std::memory_order_acquire);
+
+    char * name = thread->name.load(std::memory_order_acquire);
+    return name ? name : default_thread_names[thread_index];
+}
+
+void print_profile_frame(ProfileFrame * frame) {
+    log_print("profiler", "Frame took %.3f ms, %d zones dropped", frame->frame_time * 1000, frame->dropped_zones);
+
+    for(int root = frame->first_root; root >= 0; root = frame->nodes[root].next_sibling) {
+        print_profile_node(frame, root);
+    }
+}
+
+static void print_profile_node(ProfileFrame * frame, int index) {
+    ProfileNode * node = &frame->nodes[index];
+
+    if(node->parent < 0) {
+        log_print("profiler", "%s: %.3f ms", node->name, node->total_time * 1000);
+    } else {
+        log_print("profiler", "%*s%s: %.3f ms, %.3f ms self, %d times", node->depth * 4, "", node->name, node->total_time * 1000, node->self_time * 1000, node->count);
+    }
+
+    for(int child = node->first_child; child >= 0; child = frame->nodes[child].next_sibling) {
+        print_profile_node(frame, child);
+    }
+}
+
+// Registers the thread the first time it's asked for.
+static ProfilerThread * get_this_thread() {
+    if(this_thread) return this_thread;
+    if(out_of_threads) return NULL;
+
+    int index = num_threads.fetch_add(1);
+
+    if(index >= MAX_PROFILER_THREADS) {
+        log_print("profiler", "More than %d threads, the others won't be profiled", MAX_PROFILER_THREADS);
+        out_of_threads = true;
+        return NULL;
+    }
+
+    ProfilerThread * thread = (ProfilerThread *) malloc(sizeof(ProfilerThread));
+
+    thread->name.store(NULL, std::memory_order_relaxed);
+    thread->write_index.store(0, std::memory_order_relaxed);
+    thread->read_index.store(0, std::memory_order_relaxed);
+    thread->dropped_zones.store(0, std::memory_order_relaxed);
+
+    thread->open_zones = 0;
+    thread->depth      = 0;
+    thread->root       = -1;
+
+    sprintf(default_thread_names[index], "thread %d", index);
+
+    threads[index].store(thread, std::memory_order_release);
+
+    this_thread = thread;
+
+    return thread;
+}
+
+static void read_thread_events(ProfilerThread * thread, int thread_index) {
+    unsigned int read  = thread->read_index.load(std::memory_order_relaxed);
+    unsigned int write = thread->write_index.load(std::memory_order_acquire);
+
+    for(unsigned int index = read; index != write; index++) {
+        ProfileEvent * event = &thread->events[index & (PROFILER_RING_SIZE - 1)];
+
+        if(event->name) {
+            OpenZone * zone = &thread->stack[thread->depth]; // begin_profile_zone keeps it under MAX_PROFILE_DEPTH.
+            zone->name       = event->name;
+            zone->begin_time = event->time;
+            zone->node       = -1;
+
+            thread->depth += 1;
+            continue;
+        }
+
+        int level = thread->depth - 1;
+        int node  = get_zone_node(thread, thread_index, level);
+
+        if(capture_frames_left) capture_zone(thread->stack[level].name, thread_index, thread->stack[level].begin_time, event->time);
+
+        if(node >= 0) {
+            nodes[node].count      += 1;
+            nodes[node].total_time += event->time - thread->stack[level].begin_time;
+            nodes[node].self_time  += event->time - thread->stack[level].begin_time;
+        } else {
+            frame.dropped_zones += 1;
+        }
+
+        thread->depth -= 1;
+    }
+
+    thread->read_index.store(write, std::memory_order_release);
+
+    frame.dropped_zones += thread->dropped_zones.exchange(0, std::memory_order_relaxed);
+}
+
+// This frame's node for the zone at level in the thread's stack, along with its parents if they aren't there yet. -1
+// if the tree is full.
+static int get_zone_node(ProfilerThread * thread, int thread_index, int level) {
+    OpenZone * zone = &thread->stack[level];
+    if(zone->node >= 0) return zone->node;
+
+    int parent = level > 0 ? get_zone_node(thread, thread_index, level - 1) : get_thread_root(thread, thread_index);
+    if(parent < 0) return -1;
+
+    zone->node = find_or_add_child(parent, zone->name);
+    return zone->node;
+}
+
+static int get_thread_root(ProfilerThread * thread, int thread_index) {
+    if(thread->root >= 0) return thread->root;
+
+    thread->root = add_node(get_profiler_thread_name(thread_index), thread_index, -1);
+    if(thread->root < 0) return -1;
+
+    if(last_root >= 0) nodes[last_root].next_sibling = thread->root;
+    else               frame.first_root              = thread->root;
+
+    last_root = thread->root;
+
+    return thread->root;
+}
+
+// Names are compared by pointer first, the same literal in two files can have two addresses though.
+static int find_or_add_child(int parent, char * name) {
+    int last_child = -1;
+
+    for(int child = nodes[parent].first_child; child >= 0; child = nodes[child].next_sibling) {
+        if(nodes[child].name == name || strcmp(nodes[child].name, name) == 0) return child;
+
+        last_child = child;
+    }
+
+    int child = add_node(name, nodes[parent].thread, parent);
+    if(child < 0) return -1;
+
+    if(last_child >= 0) nodes[last_child].next_sibling = child;
+    else                nodes[parent].first_child      = child;
+
+    return child;
+}
+
+static int add_node(char * name, int thread_index, int parent) {
+    if(frame.num_nodes == MAX_PROFILE_NODES) return -1;
+
+    int index = frame.num_nodes;
+    frame.num_nodes += 1;
+
+    ProfileNode * node = &nodes[index];
+    node->name         = name;
+    node->thread       = thread_index;
+    node->depth        = parent >= 0 ? nodes[parent].depth + 1 : 0;
+    node->parent       = parent;
+    node->first_child  = -1;
+    node->next_sibling = -1;
+    node->count        = 0;
+    node->total_time   = 0.0;
+    node->self_time    = 0.0;
+
+    return index;
+}
+
+// Zones that began before the capture did are cut to its start, so the trace doesn't begin with a gap.
+static void capture_zone(char * name, int thread_index, double begin_time, double end_time) {
+    CapturedZone zone;
+    zone.name       = name;
+    zone.thread     = thread_index;
+    zone.begin_time = begin_time > capture_start_time ? begin_time : capture_start_time;
+    zone.end_time   = end_time;
+
+    captured_zones.add(zone);
+}
+
+// Complete events ("X") for the zones, in microseconds from the start of the capture, a global instant event for
+// every frame's end, and the threads' names as metadata. Trace viewers nest the zones themselves.
+//
+// @Speed This is on the main thread and the frame it's written in takes that much longer. It's a debugging tool, and
+// the frames it captured aren't affected.
+static void write_profile_capture() {
+    scope_exit(captured_zones.reset(true); captured_frames.reset(true));
+
+    FILE * file = fopen(capture_path, "wb");
+
+    if(!file) {
+        log_print("profiler", "Could not create the file \"%s\", the capture is lost", capture_path);
+        return;
+    }
+
+    scope_exit(fclose(file));
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Game3\"}}");
+
+    int count = num_threads.load(std::memory_order_acquire);
+    if(count > MAX_PROFILER_THREADS) count = MAX_PROFILER_THREADS;
+
+    for(int i = 0; i < count; i++) {
+        if(!threads[i].load(std::memory_order_acquire)) continue;
+
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", i);
+        write_json_string(file, get_profiler_thread_name(i));
+        fprintf(file, "}}");
+    }
+
+    for_array(captured_frames.data, captured_frames.count) {
+        fprintf(file, ",\n{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%.3f}", (*it - capture_start_time) * 1000000);
+    }
+
+    for_array(captured_zones.data, captured_zones.count) {
+        fprintf(file, ",\n{\"name\":");
+        write_json_string(file, it->name);
+        fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", it->thread, (it->begin_time - capture_start_time) * 1000000, (it->end_time - it->begin_time) * 1000000);
+    }
+
+    fprintf(file, "\n]}\n");
+
+    log_print("profiler", "Wrote %d zones over %d frames to \"%s\"", captured_zones.count, captured_frames.count, capture_path);
+}
+
+// Names are literals and function names, this is only in case one has a quote or a backslash.
+static void write_json_string(FILE * file, char * string) {
+    fputc('"', file);
+
+    for(char * cursor = string; *cursor; cursor++) {
+        if(*cursor == '"' || *cursor == '\\')   fprintf(file, "\\%c", *cursor);
+        else if((unsigned char) *cursor < 0x20) fprintf(file, "\\u%04x", *cursor);
+        else                                    fputc(*cursor, file);
+    }
+
+    fputc('"', file);
+}
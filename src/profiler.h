@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+
+#include "macros.h"
+
+// Zones time a scope. Beginning and ending one only writes the name and the time to the thread's own ring of events,
+// no locks and no allocation, and names are never copied, they have to be string literals or live as long as the
+// program. Once a frame, next_profiler_frame reads every thread's events and adds them up by where they were, in a
+// tree per thread: a zone called twice from the same parent zone is one node with a count of 2.
+//
+// Without PERF_MON (release builds, see builder.cpp), zones compile to nothing.
+//
+// A capture keeps every zone of a few frames, on every thread, with when it began and ended, and writes them as
+// Chrome Trace Event JSON for chrome://tracing or ui.perfetto.dev.
+//
+//     void flush_buffers() {
+//         profile_function();
+//         ...
+//         {
+//             profile_zone("sort_batches");
+//             ...
+//         }
+//     }
+
+struct ProfileEvent {
+    char * name; // NULL for the end of the last zone that began.
+    double time; // os_specific_get_time
+};
+
+struct ProfileNode {
+    char * name; // The thread's name for roots.
+
+    int thread; // Index in the profiler's threads, see get_profiler_thread_name.
+    int depth;  // 0 for roots
+
+    int parent;       // -1 for roots
+    int first_child;  // -1 if none
+    int next_sibling; // -1 if none
+
+    int count;         // Times it ended this frame.
+    double total_time; // In seconds, children included.
+    double self_time;  // Children excluded.
+};
+
+struct ProfileFrame {
+    ProfileNode * nodes; // Parents before their children, children in the order they first ended.
+    int num_nodes;
+
+    // One root per thread that had zones end this frame, linked by next_sibling. main_root is the thread that calls
+    // next_profiler_frame, -1 if it had none.
+    int first_root;
+    int main_root;
+
+    double frame_time; // Between the last two next_profiler_frame.
+
+    int dropped_zones; // Zones that didn't fit in their thread's ring, or in the tree, this frame.
+};
+
+const int PROFILER_RING_SIZE   = 1 << 16; // Events, has to be a power of two. A frame can't have more per thread.
+const int MAX_PROFILER_THREADS = 64;
+const int MAX_PROFILE_DEPTH    = 64;
+const int MAX_PROFILE_NODES    = 2048; // Per frame, over every thread.
+
+const int PROFILE_CAPTURE_FRAMES = 120;
+
+#ifdef PERF_MON
+    #define profile_zone(name)  ProfileZone STRING_JOIN(__profile_zone_, __LINE__)(name)
+    #define profile_function()  profile_zone((char *) __FUNCTION__)
+#else
+    #define profile_zone(name)
+    #define profile_function()
+#endif
+
+// Call it on a thread before it begins any zone, or it shows up as "thread <n>". Doesn't copy the name either.
+void set_profiler_thread_name(char * name);
+
+bool begin_profile_zone(char * name); // False if it didn't fit, its end mustn't be recorded then.
+void end_profile_zone();
+
+// Once per frame on the main thread, outside of any zone.
+void next_profiler_frame();
+
+ProfileFrame * get_profile_frame(); // The frame before the last next_profiler_frame, valid until the next one.
+char * get_profiler_thread_name(int thread);
+
+void print_profile_frame(ProfileFrame * frame); // log_prints the tree.
+
+// From the frame in progress, the next num_frames next_profiler_frame keep the zones that ended, and the last one
+// writes them to path, which isn't copied. False if a capture is already going.
+bool start_profile_capture(char * path, int num_frames = PROFILE_CAPTURE_FRAMES);
+bool is_profile_capturing();
+
+struct ProfileZone {
+    bool recorded;
+
+    ProfileZone(char * name) { recorded = begin_profile_zone(name); }
+    ~ProfileZone()           { if(recorded) end_profile_zone(); }
+};
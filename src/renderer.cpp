@@ -9,21 +9,25 @@
 #include "macros.h"
 
 #include "os/layer.h"
+#include "pack_file.h"
+#include "profiler.h"
 
 struct Font;
 
 // DLL functions
 typedef void (*INIT_PLATFORM_RENDERER_FUNC) (Vector2f, void*);
-typedef bool (*COMPILE_SHADER_FUNC)         (Shader*);
+typedef bool (*COMPILE_SHADER_FUNC)         (Shader*, String);
 typedef bool (*INIT_FRAME)                  ();
 typedef bool (*DRAW_BATCH)                  (DrawBatch*);
 typedef bool (*PRESENT_FRAME)               (int);
+typedef void (*RELEASE_TEXTURE)             (Texture*);
 
 INIT_PLATFORM_RENDERER_FUNC init_platform_renderer;
 COMPILE_SHADER_FUNC compile_shader;
 INIT_FRAME init_frame;
 DRAW_BATCH draw_batch;
 PRESENT_FRAME present_frame;
+RELEASE_TEXTURE release_texture;
 
 // Prototypes
 static void clear_buffers();
@@ -47,8 +51,14 @@ static Vector2f rendering_resolution;
 
 static bool frame_initted = false;
 
+static TextureManager * texture_manager;
+
+static RenderStats frame_stats; // The frame being drawn.
+static RenderStats last_frame_stats;
+static Texture * last_drawn_texture;
+
 static void load_graphics_dll() {
-    void * graphics_library_dll = os_specific_load_dll("d3d_renderer.dll"); //@Robustness Handle failed loading (maybe try another dll or at least die gracefully)
+    void * graphics_library_dll = os_specific_load_dll(PLATFORM_RENDERER_DLL); //@Robustness Handle failed loading (maybe try another dll or at least die gracefully)
 
 	if (!graphics_library_dll) {
 		log_print("Startup", "Could not load graphics dll, PANIC.");
@@ -59,6 +69,7 @@ static void load_graphics_dll() {
     init_frame             = (INIT_FRAME)                  os_specific_get_address_from_dll(graphics_library_dll, "init_frame");
     draw_batch             = (DRAW_BATCH)                  os_specific_get_address_from_dll(graphics_library_dll, "draw_batch");
     present_frame          = (PRESENT_FRAME)               os_specific_get_address_from_dll(graphics_library_dll, "present_frame");
+    release_texture        = (RELEASE_TEXTURE)             os_specific_get_address_from_dll(graphics_library_dll, "release_texture");
 }
 
 void init_renderer(int width, int height, void * handle) {
@@ -71,15 +82,24 @@ void init_renderer(int width, int height, void * handle) {
     init_platform_renderer(rendering_resolution, handle);
 }
 
+void set_texture_manager(TextureManager * manager) {
+    texture_manager = manager;
+}
+
 void draw_frame(int sync_interval) {
     flush_buffers();
 
+    profile_zone("present_frame");
     present_frame(sync_interval);
     frame_initted = false;
+
+    last_frame_stats   = frame_stats;
+    frame_stats        = {};
+    last_drawn_texture = NULL;
 }
 
 void flush_buffers() {
-    perf_monitor();
+    profile_function();
 
     assert(!buffering);
 
@@ -90,6 +110,21 @@ void flush_buffers() {
 
     for(int i = 0; i < num_buffers; i++) {
         DrawBatch * batch = &graphics_buffer.batches.data[i];
+
+        // Marks the texture as used this frame, and swaps in a placeholder if it was evicted.
+        if(batch->info.texture && texture_manager) {
+            batch->info.texture = texture_manager->use_texture(batch->info.texture);
+        }
+
+        frame_stats.num_batches  += 1;
+        frame_stats.num_vertices += batch->positions.count;
+        frame_stats.num_indices  += batch->indices.count;
+
+        if(batch->info.texture && batch->info.texture != last_drawn_texture) {
+            frame_stats.texture_switches += 1;
+            last_drawn_texture = batch->info.texture;
+        }
+
         draw_batch(batch);
     }
 
@@ -251,7 +286,20 @@ static void clear_buffers() {
     num_buffers = 0;
 }
 
+RenderStats get_render_stats() {
+    return last_frame_stats;
+}
+
+void unload_texture(Texture * texture) {
+    release_texture(texture);
+}
+
 // Meh
 void do_load_shader(Shader * shader) {
-    compile_shader(shader);
+    String file_data = read_asset_file(shader->full_path);
+    scope_exit(free_asset_file(file_data));
+
+    if(!file_data.data) return; // Should have already errored.
+
+    compile_shader(shader, file_data);
 }
@@ -1,7 +1,10 @@
 #include "graphics_buffer.h"
 
+struct TextureManager;
+
 // Init
 void init_renderer(int width, int height, void * handle); // handle is an HWND used for d3d
+void set_texture_manager(TextureManager * manager);        // Every texture we draw goes through its use_texture
 
 // Draw process
 void flush_buffers();
@@ -22,5 +25,11 @@ void add_vertex(float x, float y, float z, float u, float v, Color4f color);
 
 void end_buffer();
 
+// Textures
+void unload_texture(Texture * texture); // Frees what the backend made for it, it gets made again if it's drawn.
+
 // Shaders
 void do_load_shader(Shader * shader);
+
+// Stats
+RenderStats get_render_stats(); // Of the last frame that was presented.
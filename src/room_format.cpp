@@ -0,0 +1,658 @@
+// Room file formats, the text one we write by hand and the binary one the builder cooks out of it. This is shared with
+// the builder, so nothing in here goes through the managers or the platform layer.
+
+#include "room_manager.h"
+#include "cooked_assets.h"
+#include "macros.h"
+#include "parsing.h"
+
+// Private functions
+static String get_cooked_string(String strings, CookedString cooked_string);
+static CookedString add_cooked_string(Array<char> * strings, String string);
+
+// Thread safe, only touches new_room.
+bool parse_room_text(char * c_name, String file_data, Room * new_room) {
+    Array<String> lines = strip_comments_from_file(file_data);
+    scope_exit(free(lines.data));
+
+    int version = get_file_version_number(lines, c_name);
+
+    Array<Tile> new_tile_array;
+    Array<CollisionBlock> new_collision_block_array;
+
+
+    int line_number = 1;
+    bool successfully_parsed_file = true;
+
+    int current_tile_index = -1;
+    int current_collision_block_index = -1;
+
+    while(true) { // @Cleanup, for_array with offset ?
+
+        String line = lines.data[line_number];
+        line_number += 1;
+
+        if(line.count == -1) break; // EOF
+
+		cut_spaces(&line);
+        if(line.count == 0) continue; // Empty line
+
+		String field_name = cut_until_space(&line);
+
+        if(field_name == "name") {
+            String arg = cut_until_space(&line);
+
+            if(!arg.count) {
+                log_print("do_load_room", "Expected a name after \"name\" on line %d of file %s.", line_number, c_name);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            if(line.count) {
+                char * c_line = to_c_string(line);
+                scope_exit(free(c_line));
+
+                log_print("do_load_room", "Garbage left on line %d of file %s after the name: \"%s\".", line_number, c_name, c_line);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            // @Incomplete, do something with the name
+
+        } else if(field_name == "dimensions") {
+            Vector2 dimensions;
+            bool success = string_to_v2(line, &dimensions);
+
+            if(!success) {
+                char * c_line = to_c_string(line);
+                scope_exit(free(c_line));
+
+                log_print("do_load_room", "Failed to parse dimensions on line %d of file %s, string was \"%s\".", line_number, c_name, c_line);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            new_room->dimensions = dimensions;
+        } else if(field_name == "begin_tile") {
+            if(current_tile_index != -1) {
+                log_print("do_load_room", "Got a \"begin_tile\" before getting an \"end_tile\" on line %d of file %s", line_number, c_name);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            Vector2f coords;
+
+            bool success = string_to_v2f(line, &coords);
+
+            if(!success) {
+                char * c_line = to_c_string(line);
+                scope_exit(free(c_line));
+
+                log_print("do_load_room", "Failed to parse coordinates of the tile on line %d of file %s, string was \"%s\".", line_number, c_name, c_line);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            // @Incomplete, we allow to have multiple tile on the same spot for now. Probably shouldn't.
+
+            Tile tile;
+            tile.position = coords;
+            new_tile_array.add(tile);
+
+            current_tile_index = new_tile_array.count - 1;
+
+        } else if(field_name == "end_tile") {
+            if(current_tile_index == -1) {
+                log_print("do_load_room", "Got an \"end_tile\" before getting an \"begin_tile\" on line %d of file %s", line_number, c_name);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            // Reset tile index
+            current_tile_index = -1;
+
+
+        } else if(field_name == "texture") {
+            if(current_tile_index == -1) {
+                log_print("do_load_room", "Got a \"texture\" before outside if a tile block on line %d of file %s", line_number, c_name);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            if(new_tile_array.data[current_tile_index].texture.count) {
+
+                char * c_texture = to_c_string(new_tile_array.data[current_tile_index].texture);
+                scope_exit(free(c_texture));
+
+                log_print("do_load_room", "Trying to set \"texture\" on line %d of file %s, but it has aleady been set. (Current: %s)", line_number, c_name, c_texture);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            String arg = cut_until_space(&line);
+
+            if(!arg.count) {
+                log_print("do_load_room", "Expected a texture name after \"texture\" on line %d of file %s.", line_number, c_name);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            if(line.count) {
+                char * c_line = to_c_string(line);
+                scope_exit(free(c_line));
+
+                log_print("do_load_room", "Garbage left on line %d of file %s after the texture name: \"%s\".", line_number, c_name, c_line);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            new_tile_array.data[current_tile_index].texture = to_string(to_c_string(arg)); // @Cleanup UUHHHH, make a copy function.
+
+        } else if(field_name == "begin_collision") {
+            if(current_collision_block_index != -1) {
+                log_print("do_load_room", "Got a \"begin_collision\" before getting an \"end_collision\" on line %d of file %s", line_number, c_name);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            bool success = true;
+
+            bool set_x = false;
+            bool set_y = false;
+
+            float x0;
+            float x1;
+            float y0;
+            float y1;
+
+            String orig_line = line;
+            while(line.count) {
+
+                String param_name = cut_until_space(&line);
+
+                if(param_name == "x") {
+
+                    if(set_x) {
+                        char * c_line = to_c_string(orig_line);
+                        scope_exit(free(c_line));
+
+                        log_print("do_load_room", "Tried to set x coordinates of collision block twice at line %d of file %s, string was \"%s\".", line_number, c_name, c_line);
+
+
+                        success = false;
+                        break;
+                    }
+
+                    String x_str = cut_until_space(&line);
+
+                    float x;
+                    bool param_success = string_to_float(x_str, &x);
+
+                    if(param_success) {
+                        set_x = true;
+                        x0 = x;
+                        x1 = x;
+                    } else {
+                        char * c_line = to_c_string(x_str);
+                        scope_exit(free(c_line));
+
+                        log_print("do_load_room", "Failed to parse x coordinate of the collision block on line %d of file %s, string was \"%s\".", line_number, c_name, c_line);
+
+                        success = false;
+                        break;
+                    }
+                } else if(param_name == "y") {
+
+                    if(set_y) {
+                        char * c_line = to_c_string(orig_line);
+                        scope_exit(free(c_line));
+
+                        log_print("do_load_room", "Tried to set y coordinates of collision block twice at line %d of file %s, string was \"%s\".", line_number, c_name, c_line);
+
+
+                        success = false;
+                        break;
+                    }
+
+                    String y_str = cut_until_space(&line);
+
+                    float y;
+                    bool param_success = string_to_float(y_str, &y);
+
+                    if(param_success) {
+                        set_y = true;
+                        y0 = y;
+                        y1 = y;
+                    } else {
+                        char * c_line = to_c_string(y_str);
+                        scope_exit(free(c_line));
+
+                        log_print("do_load_room", "Failed to parse y coordinate of the collision block on line %d of file %s, string was \"%s\".", line_number, c_name, c_line);
+
+                        success = false;
+                        break;
+                    }
+                } else if(param_name == "x_range") {
+
+                    if(set_x) {
+                        char * c_line = to_c_string(orig_line);
+                        scope_exit(free(c_line));
+
+                        log_print("do_load_room", "Tried to set x coordinates of collision block twice at line %d of file %s, string was \"%s\".", line_number, c_name, c_line);
+
+                        success = false;
+                        break;
+                    }
+
+                    String x0_str;
+                    String x1_str;
+
+                    x0_str = cut_until_space(&line);
+                    x1_str = cut_until_space(&line);
+
+                    bool param_success = true;
+
+                    if(!x0_str.count) param_success = false;
+                    if(!x1_str.count) param_success = false;
+
+                    float tx0, tx1;
+
+                    param_success &= string_to_float(x0_str, &tx0);
+                    param_success &= string_to_float(x1_str, &tx1);
+
+                    if(param_success) {
+                        set_x = true;
+                        x0 = tx0;
+                        x1 = tx1;
+                    } else {
+                        char * c_x0 = to_c_string(x0_str);
+                        scope_exit(free(c_x0));
+
+                        char * c_x1 = to_c_string(x1_str);
+                        scope_exit(free(c_x1));
+
+                        log_print("do_load_room", "Failed to parse x coordinate of the collision block on line %d of file %s, range was \"%s\" - \"%s\" .", line_number, c_name, c_x0, c_x1);
+
+                        success = false;
+                        break;
+                    }
+                } else if(param_name == "y_range") {
+
+                    if(set_y) {
+                        char * c_line = to_c_string(orig_line);
+                        scope_exit(free(c_line));
+
+                        log_print("do_load_room", "Tried to set y coordinates of collision block twice at line %d of file %s, string was \"%s\".", line_number, c_name, c_line);
+
+                        success = false;
+                        break;
+                    }
+
+                    String y0_str;
+                    String y1_str;
+
+                    y0_str = cut_until_space(&line);
+                    y1_str = cut_until_space(&line);
+
+                    bool param_success = true;
+
+                    if(!y0_str.count) param_success = false;
+                    if(!y1_str.count) param_success = false;
+
+                    float ty0, ty1;
+
+                    param_success &= string_to_float(y0_str, &ty0);
+                    param_success &= string_to_float(y1_str, &ty1);
+
+                    if(param_success) {
+                        set_y = true;
+                        y0 = ty0;
+                        y1 = ty1;
+                    } else {
+                        char * c_y0 = to_c_string(y0_str);
+                        scope_exit(free(c_y0));
+
+                        char * c_y1 = to_c_string(y1_str);
+                        scope_exit(free(c_y1));
+
+                        log_print("do_load_room", "Failed to parse y coordinate of the collision block on line %d of file %s, range was \"%s\" - \"%s\" .", line_number, c_name, c_y0, c_y1);
+
+                        success = false;
+                        break;
+                    }
+                } else {
+                    char * c_param = to_c_string(param_name);
+                    scope_exit(free(c_param));
+
+                    char * c_line = to_c_string(line);
+                    scope_exit(free(c_line));
+
+                    log_print("do_load_room", "Unknown parameter \"%s\" for \"begin_collision\" on line %d of file %s, remainder was \"%s\".", c_param, line_number, c_name, c_line);
+
+                    success = false;
+                    break;
+                }
+            }
+
+            if(!success) {
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            if(!set_x) {
+                log_print("do_load_room", "Missing x coordinates of the collision block on line %d of file %s, please use \"x\" or \"x_range\" to set them.", line_number, c_name);
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            if(!set_y) {
+                log_print("do_load_room", "Missing y coordinates of the collision block on line %d of file %s, please use \"y\" or \"y_range\" to set them.", line_number, c_name);
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            CollisionBlock block;
+
+            if(x0 > x1) swap(x0, x1);
+            if(y0 > y1) swap(y0, y1);
+
+            block.quad.x0 = x0;
+            block.quad.x1 = x1;
+            block.quad.y0 = y0;
+            block.quad.y1 = y1;
+
+            new_collision_block_array.add(block);
+
+            current_collision_block_index = new_collision_block_array.count - 1;
+
+            // log_print("do_load_room", "Added block in room %s with coords (x0: %f, y0: %f, x1: %f, y1: %f)", c_name, x0 , y0, x1, y1);
+        } else if(field_name == "flags") {
+            if(current_collision_block_index == -1) {
+                log_print("do_load_room", "Got a \"flags\" outside of a collision block on line %d of file %s", line_number, c_name);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            CollisionBlock * current_block = &new_collision_block_array.data[current_collision_block_index];
+
+            while(line.count) {
+                String flag = cut_until_space(&line);
+
+                bool is_valid_flag = false;
+
+                if (flag == "disabled") {
+                    current_block->flags |= COLLISION_DISABLED;
+                    is_valid_flag = true;
+                }
+
+                if(flag == "player_only") {
+                    current_block->flags |= COLLISION_PLAYER_ONLY; // @Incomplete Currently ignored
+                    is_valid_flag = true;
+                }
+
+
+                if(!is_valid_flag) {
+                    char * c_flag = to_c_string(flag);
+                    scope_exit(free(c_flag));
+
+                    log_print("do_load_room", "Unknown flag \"%s\" for \"flags\" on line %d of file %s. Ignoring.", c_flag, line_number, c_name);
+                    continue;
+                }
+
+            }
+        } else if(field_name == "teleport") {
+            if(current_collision_block_index == -1) {
+                log_print("do_load_room", "Got a \"teleport\" outside of a collision block on line %d of file %s", line_number, c_name);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            CollisionBlock * current_block = &new_collision_block_array.data[current_collision_block_index];
+
+            if(current_block->action_type != UNSET) {
+                log_print("do_load_room", "Trying to set multiple actions for the collision block on line %d of file %s, previous action was %d", line_number, c_name, current_block->action_type);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            String x_str;
+            String y_str;
+
+            x_str = cut_until_space(&line);
+            y_str = cut_until_space(&line);
+
+            bool param_success = true;
+
+            if(!x_str.count) param_success = false;
+            if(!y_str.count) param_success = false;
+
+            float x, y;
+
+            param_success &= string_to_float(x_str, &x);
+            param_success &= string_to_float(y_str, &y);
+
+            if(param_success) {
+                String target_room;
+
+                if(line.count) {
+                    target_room = cut_until_space(&line);
+
+                    if(line.count) {
+                        char * c_line = to_c_string(line);
+                        scope_exit(free(c_line));
+
+                        log_print("do_load_room", "Garbage left on line %d of file %s after the target room name: \"%s\".", line_number, c_name, c_line);
+
+                        successfully_parsed_file = false;
+                        continue;
+                    }
+                }
+
+                TeleportCollisionAction * action = (TeleportCollisionAction *) malloc(sizeof(TeleportCollisionAction));
+                action->target = {x, y};
+                action->target_room_name = to_string(to_c_string(target_room)); // @Cleanup
+
+                current_block->action      = action;
+                current_block->action_type = TELEPORT;
+
+            } else {
+                char * c_x = to_c_string(x_str);
+                scope_exit(free(c_x));
+
+                char * c_y = to_c_string(y_str);
+                scope_exit(free(c_y));
+
+                log_print("do_load_room", "Failed to parse coordinates of the target for the \"teleport\" on line %d of file %s, coords were \"%s\" - \"%s\" .", line_number, c_name, c_x, c_y);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+        } else if(field_name == "end_collision") {
+            if(current_collision_block_index == -1) {
+                log_print("do_load_room", "Got an \"end_collision\" before getting a valid \"begin_collision\" on line %d of file %s", line_number, c_name);
+
+                successfully_parsed_file = false;
+                continue;
+            }
+
+            // Reset block index
+            current_collision_block_index = -1;
+        } else {
+                char * c_field = to_c_string(field_name);
+                scope_exit(free(c_field));
+
+                char * c_line = to_c_string(line);
+                scope_exit(free(c_line));
+                log_print("do_load_room", "Unknown field  \"%s\"  on line %d of file %s, remainder was \"%s\".", c_field, line_number, c_name, c_line);
+
+                continue; // Not failing, we just ignore this line. @Temporary, we should probably fail here.
+        }
+    }
+
+
+
+    new_room->tiles            = new_tile_array;
+    new_room->collision_blocks = new_collision_block_array;
+
+    return successfully_parsed_file;
+}
+
+// Returns a buffer with the whole cooked file, free it when you're done.
+String write_cooked_room(Room * room) {
+    Array<char> strings;
+    scope_exit(free(strings.data));
+
+    Array<CookedTile> tiles;
+    scope_exit(free(tiles.data));
+
+    Array<CookedCollisionBlock> blocks;
+    scope_exit(free(blocks.data));
+
+    for_array(room->tiles.data, room->tiles.count) {
+        CookedTile tile;
+        tile.position = it->position;
+        tile.texture  = add_cooked_string(&strings, it->texture);
+
+        tiles.add(tile);
+    }
+
+    for_array(room->collision_blocks.data, room->collision_blocks.count) {
+        CookedCollisionBlock block = {};
+        block.quad        = it->quad;
+        block.flags       = it->flags;
+        block.action_type = it->action_type;
+
+        if(it->action_type == TELEPORT) {
+            TeleportCollisionAction * action = (TeleportCollisionAction *) it->action;
+
+            block.target           = action->target;
+            block.target_room_name = add_cooked_string(&strings, action->target_room_name);
+        }
+
+        blocks.add(block);
+    }
+
+    CookedRoomHeader header;
+    header.magic                = COOKED_ROOM_MAGIC;
+    header.version              = COOK_VERSION;
+    header.dimensions           = room->dimensions;
+    header.num_tiles            = tiles.count;
+    header.num_collision_blocks = blocks.count;
+    header.strings_size         = strings.count;
+
+    String file_data;
+    file_data.count = sizeof(header) + tiles.count * sizeof(CookedTile) + blocks.count * sizeof(CookedCollisionBlock) + strings.count;
+    file_data.data  = (char *) malloc(file_data.count);
+
+    char * cursor = file_data.data;
+
+    memcpy(cursor, &header, sizeof(header));
+    cursor += sizeof(header);
+
+    memcpy(cursor, tiles.data, tiles.count * sizeof(CookedTile));
+    cursor += tiles.count * sizeof(CookedTile);
+
+    memcpy(cursor, blocks.data, blocks.count * sizeof(CookedCollisionBlock));
+    cursor += blocks.count * sizeof(CookedCollisionBlock);
+
+    memcpy(cursor, strings.data, strings.count);
+
+    return file_data;
+}
+
+// Thread safe, only touches new_room. file_data has to start with a cooked room header, see is_cooked.
+bool read_cooked_room(char * c_name, String file_data, Room * new_room) {
+    if(file_data.count < sizeof(CookedRoomHeader)) {
+        log_print("do_load_room", "Cooked room %s is too small to hold its header", c_name);
+        return false;
+    }
+
+    CookedRoomHeader * header = (CookedRoomHeader *) file_data.data;
+
+    int expected_size = sizeof(CookedRoomHeader) + header->num_tiles * sizeof(CookedTile) + header->num_collision_blocks * sizeof(CookedCollisionBlock) + header->strings_size;
+
+    if(file_data.count != expected_size) {
+        log_print("do_load_room", "Cooked room %s is %d bytes, but its header says it should be %d bytes", c_name, file_data.count, expected_size);
+        return false;
+    }
+
+    CookedTile           * tiles  = (CookedTile *) (header + 1);
+    CookedCollisionBlock * blocks = (CookedCollisionBlock *) (tiles + header->num_tiles);
+
+    String strings;
+    strings.data  = (char *) (blocks + header->num_collision_blocks);
+    strings.count = header->strings_size;
+
+    new_room->dimensions = header->dimensions;
+
+    if(header->num_tiles) new_room->tiles.reserve(header->num_tiles);
+
+    for(int i = 0; i < header->num_tiles; i++) {
+        Tile tile = {};
+        tile.position = tiles[i].position;
+        tile.texture  = get_cooked_string(strings, tiles[i].texture);
+
+        new_room->tiles.add(tile);
+    }
+
+    if(header->num_collision_blocks) new_room->collision_blocks.reserve(header->num_collision_blocks);
+
+    for(int i = 0; i < header->num_collision_blocks; i++) {
+        CollisionBlock block;
+        block.quad        = blocks[i].quad;
+        block.flags       = blocks[i].flags;
+        block.action_type = (CollisionActionType) blocks[i].action_type;
+
+        if(block.action_type == TELEPORT) {
+            TeleportCollisionAction * action = (TeleportCollisionAction *) malloc(sizeof(TeleportCollisionAction));
+            action->target           = blocks[i].target;
+            action->target_room_name = get_cooked_string(strings, blocks[i].target_room_name);
+
+            block.action = action;
+        }
+
+        new_room->collision_blocks.add(block);
+    }
+
+    return true;
+}
+
+// Returns a copy, the file data doesn't outlive the load.
+static String get_cooked_string(String strings, CookedString cooked_string) {
+    String string;
+
+    if(cooked_string.offset < 0 || cooked_string.offset + cooked_string.count > strings.count) return string;
+
+    string.count = cooked_string.count;
+    string.data  = (char *) malloc(string.count + 1);
+    memcpy(string.data, strings.data + cooked_string.offset, string.count);
+    string.data[string.count] = 0;
+
+    return string;
+}
+
+static CookedString add_cooked_string(Array<char> * strings, String string) {
+    CookedString cooked_string;
+    cooked_string.offset = strings->count;
+    cooked_string.count  = string.count;
+
+    for(int i = 0; i < string.count; i++) {
+        strings->add(string.data[i]);
+    }
+
+    return cooked_string;
+}
@@ -49,6 +49,18 @@ struct RoomManager : AssetManager_Poly<Room> {
     void reload_or_create_asset(String file_path, String file_name);
     void create_placeholder(String name, String path);
 
+    void load_asset(Asset * asset);
+
+    void * begin_async_load(Asset * asset);
+    void   do_async_load   (void * load);
+    void   end_async_load  (void * load);
+
 private:
     void do_load_room(Room * room);
 };
+
+// room_format.cpp, shared with the builder's /cook mode.
+bool parse_room_text(char * c_name, String file_data, Room * new_room);
+
+String write_cooked_room(Room * room);
+bool read_cooked_room(char * c_name, String file_data, Room * new_room);
@@ -12,9 +12,18 @@ void ShaderManager::create_placeholder(String name, String path) {
     shader->name      = name;
     shader->full_path = path;
 
+    shader->content_hash   = 0;
+    shader->loading        = false;
+    shader->reload_pending = false;
+
     this->table.add(name, shader);
 }
 
+// Shaders get compiled by the renderer, which isn't thread safe, so they always load synchronously.
+void ShaderManager::load_asset(Asset * asset) {
+    do_load_shader((Shader *) asset);
+}
+
 // @Think, make this part of AssetManager_Poly ?
 void ShaderManager::reload_or_create_asset(String full_path, String file_name) {
     Asset * asset = this->table.find(file_name);
@@ -18,4 +18,6 @@ struct ShaderManager : AssetManager_Poly<Shader> {
 
     void reload_or_create_asset(String file_path, String file_name);
     void create_placeholder(String name, String path);
+
+    void load_asset(Asset * asset);
 };
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+
+#include "array.h"
+
+// Lock-free queue with exactly one producer thread and one consumer thread. The producer only writes tail and the
+// consumer only writes head, so the only synchronization we need is release/acquire on those two counters. Both
+// counters run freely and wrap around, capacity has to be a power of two for the masking to work.
+template <typename T>
+struct SPSCQueue {
+
+    T * data = NULL;
+    unsigned int capacity = 0;
+
+    std::atomic<unsigned int> head; // Next slot to pop,  only written by the consumer.
+    std::atomic<unsigned int> tail; // Next slot to push, only written by the producer.
+
+    bool init   (unsigned int capacity);
+    void release ();
+
+    bool push   (T item);     // Producer only. Returns false if the queue is full.
+    bool pop    (T * item);   // Consumer only. Returns false if the queue is empty.
+
+    bool is_empty();
+};
+
+// ************************ //
+// ---- Implementation ---- //
+// ************************ //
+
+template <typename T>
+bool SPSCQueue<T>::init(unsigned int to_allocate) {
+    assert(to_allocate && (to_allocate & (to_allocate - 1)) == 0); // Power of two
+
+    this->data = (T *) malloc(to_allocate * sizeof(T));
+    if(!this->data) return false;
+
+    this->capacity = to_allocate;
+
+    this->head.store(0, std::memory_order_relaxed);
+    this->tail.store(0, std::memory_order_relaxed);
+
+    return true;
+}
+
+template <typename T>
+void SPSCQueue<T>::release() {
+    free(this->data);
+    this->data     = NULL;
+    this->capacity = 0;
+}
+
+template <typename T>
+bool SPSCQueue<T>::push(T item) {
+    unsigned int tail = this->tail.load(std::memory_order_relaxed);
+    unsigned int head = this->head.load(std::memory_order_acquire); // Make sure the consumer is done with the slot.
+
+    if(tail - head == this->capacity) return false; // Full
+
+    memcpy(&this->data[tail & (this->capacity - 1)], &item, sizeof(T));
+
+    this->tail.store(tail + 1, std::memory_order_release); // Publishes the item.
+
+    return true;
+}
+
+template <typename T>
+bool SPSCQueue<T>::pop(T * item) {
+    unsigned int head = this->head.load(std::memory_order_relaxed);
+    unsigned int tail = this->tail.load(std::memory_order_acquire); // Make sure we see the item that was pushed.
+
+    if(head == tail) return false; // Empty
+
+    memcpy(item, &this->data[head & (this->capacity - 1)], sizeof(T));
+
+    this->head.store(head + 1, std::memory_order_release); // Hands the slot back to the producer.
+
+    return true;
+}
+
+template <typename T>
+bool SPSCQueue<T>::is_empty() {
+    return this->head.load(std::memory_order_relaxed) == this->tail.load(std::memory_order_acquire);
+}
@@ -0,0 +1,194 @@
+#include "text_layout.h"
+#include "font_manager.h"
+#include "glyph_cache.h"
+#include "hash.h"
+#include "macros.h"
+
+// Private functions
+static void lay_out_text(TextLayout * layout);
+
+static int find_layout_slot(SpecificFont * font, char * text, int count, unsigned int hash);
+static void rebuild_layout_index();
+
+static unsigned int get_layout_hash(SpecificFont * font, char * text, int count);
+
+// Const
+const int TEXT_LAYOUT_MAX_AGE = 30; // Frames without being drawn before we forget a layout.
+
+const int MIN_LAYOUT_INDEX_SIZE = 64; // Has to be a power of two.
+
+// Globals
+static Array<TextLayout *> layouts;
+
+// Open addressing, indices in layouts, -1 for empty slots. Never more than half full.
+static int * layout_index;
+static int   layout_index_size;
+
+static int current_frame;
+
+TextLayout * get_text_layout(SpecificFont * font, char * text, int count) {
+    if(!layout_index) rebuild_layout_index();
+
+    unsigned int hash = get_layout_hash(font, text, count);
+    int slot = find_layout_slot(font, text, count, hash);
+
+    TextLayout * layout;
+
+    if(layout_index[slot] >= 0) {
+        layout = layouts.data[layout_index[slot]];
+
+        if(layout->glyph_generation != get_glyph_cache_generation()) lay_out_text(layout);
+    } else {
+        layout = (TextLayout *) malloc(sizeof(TextLayout));
+
+        layout->font = font;
+        layout->hash = hash;
+
+        layout->text.count = count;
+        layout->text.data  = (char *) malloc(count + 1);
+        memcpy(layout->text.data, text, count);
+        layout->text.data[count] = 0;
+
+        layout->quads = {};
+
+        lay_out_text(layout);
+
+        layout_index[slot] = layouts.count;
+        layouts.add(layout);
+
+        if(layouts.count * 2 > layout_index_size) rebuild_layout_index();
+    }
+
+    layout->last_used_frame = current_frame;
+
+    use_glyph_pages(layout->glyph_pages); // They were laid out in an earlier frame, nothing else marked them.
+
+    return layout;
+}
+
+void next_text_layout_frame() {
+    current_frame += 1;
+
+    int kept = 0;
+
+    for_array(layouts.data, layouts.count) {
+        TextLayout * layout = *it;
+
+        if(current_frame - layout->last_used_frame > TEXT_LAYOUT_MAX_AGE) {
+            layout->quads.reset(true);
+            free(layout->text.data);
+            free(layout);
+
+            for_array_continue;
+        }
+
+        layouts.data[kept] = layout;
+        kept += 1;
+    }
+
+    if(kept == layouts.count) return;
+
+    layouts.count = kept;
+
+    rebuild_layout_index();
+}
+
+// What buffer_string used to do every frame, with the pen at 0, 0.
+// @Robustness A glyph that didn't fit in the atlas stays missing until the glyph cache generation changes.
+static void lay_out_text(TextLayout * layout) {
+    SpecificFont * font = layout->font;
+
+    layout->quads.count = 0;
+    layout->glyph_pages = 0;
+
+    {
+        float zero_x = 0.0f;
+        float zero_y = 0.0f;
+
+        stbtt_aligned_quad q;
+        get_glyph_quad(font, 'A', &zero_x, &zero_y, &q); // 'A' is used as a reference character
+
+        layout->reference_y = (float) ((int)(q.y0 + 0.5f));
+    }
+
+    float pen_x = 0.0f;
+    float pen_y = 0.0f;
+
+    char * cursor = layout->text.data;
+
+    while(*cursor) {
+        int codepoint = next_codepoint(&cursor);
+
+        // Control characters have nothing to draw
+        if(codepoint < 32) continue;
+
+        stbtt_aligned_quad q;
+        CachedGlyph glyph;
+        get_glyph_quad(font, codepoint, &pen_x, &pen_y, &q, &glyph);
+
+        if(glyph.page == NO_GLYPH_PAGE) continue;
+
+        layout->glyph_pages |= 1 << glyph.page;
+
+        TextQuad quad;
+        quad.x0 = q.x0;
+        quad.y0 = -q.y1;
+        quad.x1 = q.x1;
+        quad.y1 = -q.y0;
+        quad.s0 = q.s0;
+        quad.t0 = q.t0;
+        quad.s1 = q.s1;
+        quad.t1 = q.t1;
+
+        layout->quads.add(quad);
+    }
+
+    layout->width = (float) ((int)(pen_x + 0.5f));
+
+    // After, laying out can clear atlas pages, though never the ones we just used.
+    layout->glyph_generation = get_glyph_cache_generation();
+}
+
+// The slot holding the layout, or the empty slot where it would go.
+static int find_layout_slot(SpecificFont * font, char * text, int count, unsigned int hash) {
+    int mask = layout_index_size - 1;
+    int slot = hash & mask;
+
+    while(layout_index[slot] >= 0) {
+        TextLayout * layout = layouts.data[layout_index[slot]];
+
+        if(layout->hash == hash && layout->font == font && layout->text.count == count && memcmp(layout->text.data, text, count) == 0) break;
+
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+// Sized for the layouts we have, with room to grow.
+static void rebuild_layout_index() {
+    int size = MIN_LAYOUT_INDEX_SIZE;
+    while(size < layouts.count * 4) size *= 2;
+
+    if(size != layout_index_size) {
+        free(layout_index);
+
+        layout_index      = (int *) malloc(size * sizeof(int));
+        layout_index_size = size;
+    }
+
+    memset(layout_index, 0xff, size * sizeof(int)); // -1
+
+    for(int i = 0; i < layouts.count; i++) {
+        TextLayout * layout = layouts.data[i];
+
+        int slot = find_layout_slot(layout->font, layout->text.data, layout->text.count, layout->hash);
+        layout_index[slot] = i;
+    }
+}
+
+static unsigned int get_layout_hash(SpecificFont * font, char * text, int count) {
+    unsigned int seed = murmur_hash_2(&font, sizeof(font), 0);
+
+    return murmur_hash_2(text, count, seed);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "parsing.h"
+
+// Most strings we draw are the same from one frame to the next. Their glyph quads are laid out once, relative to the
+// pen, and drawing them again is only a translation. Layouts are found by font and text, alignment is only an offset
+// from the extents, so one layout serves every alignment. Layouts nobody asked for in a while are thrown away.
+
+struct SpecificFont;
+
+struct TextQuad {
+    // In pixels from the pen on the baseline, y up.
+    float x0;
+    float y0; // Bottom
+    float x1;
+    float y1; // Top
+
+    // In the glyph atlas, t0 is the top.
+    float s0;
+    float t0;
+    float s1;
+    float t1;
+};
+
+struct TextLayout {
+    SpecificFont * font;
+    String text; // Our copy, zero terminated.
+
+    unsigned int hash;
+
+    Array<TextQuad> quads;
+
+    float width;       // In pixels, rounded
+    float reference_y; // In pixels, the top of 'A' from the baseline, y down, rounded. What alignment calls the height.
+
+    unsigned int glyph_pages; // The atlas pages the quads sample, see use_glyph_pages.
+    int glyph_generation;     // See get_glyph_cache_generation.
+
+    int last_used_frame;
+};
+
+// Lays it out if we don't have it, or if its glyphs moved in the atlas since. text doesn't have to be zero terminated.
+TextLayout * get_text_layout(SpecificFont * font, char * text, int count);
+
+// Once per frame, after drawing.
+void next_text_layout_frame();
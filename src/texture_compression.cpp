@@ -0,0 +1,454 @@
+#include <math.h>
+#include <string.h>
+#include <emmintrin.h>
+
+#include "texture_compression.h"
+#include "mip_maps.h"
+
+// Color blocks always use BC1's 4 color mode (c0 > c1), which is also the only mode BC3 has. Alpha blocks use the
+// 8 level mode (a0 > a1).
+//
+// Pixels are kept as structure of arrays, so finding the closest palette entry works on 4 pixels at a time.
+
+struct Block {
+    __m128 r[4];
+    __m128 g[4];
+    __m128 b[4];
+
+    unsigned char alpha[16];
+};
+
+// Private functions
+static void load_block(unsigned char * rgba, int width, int height, int block_x, int block_y, Block * block);
+
+static void  encode_color_block(Block * block, CompressionQuality quality, unsigned char * output);
+static float write_color_block (Block * block, float endpoints[2][3], unsigned char * output);
+static void  encode_alpha_block(Block * block, unsigned char * output);
+
+static void get_bounding_box_endpoints  (Block * block, float endpoints[2][3]);
+static void get_principal_axis_endpoints(Block * block, float endpoints[2][3]);
+static bool fit_endpoints(Block * block, unsigned char * color_block, float endpoints[2][3]);
+
+static unsigned short pack_565(float * color);
+static void unpack_565(unsigned short packed, float * color);
+
+static float horizontal_min(__m128 values);
+static float horizontal_max(__m128 values);
+static float horizontal_sum(__m128 values);
+
+// Const
+const int NUM_REFINEMENTS = 2;
+const int NUM_POWER_ITERATIONS = 8;
+
+TextureFormat pick_compressed_format(unsigned char * rgba, int width, int height) {
+    int num_pixels = width * height;
+
+    for(int i = 0; i < num_pixels; i++) {
+        if(rgba[i * 4 + 3] != 255) return TEXTURE_FORMAT_BC3;
+    }
+
+    return TEXTURE_FORMAT_BC1;
+}
+
+void compress_block_rows(unsigned char * rgba, int width, int height, TextureFormat format, CompressionQuality quality,
+                         unsigned char * output, int first_block_row, int num_block_rows) {
+    int blocks_wide = (width + 3) / 4;
+    int block_size  = get_format_unit_size(format);
+
+    for(int block_y = first_block_row; block_y < first_block_row + num_block_rows; block_y++) {
+        for(int block_x = 0; block_x < blocks_wide; block_x++) {
+            Block block;
+            load_block(rgba, width, height, block_x, block_y, &block);
+
+            unsigned char * block_output = output + (block_y * blocks_wide + block_x) * block_size;
+
+            if(format == TEXTURE_FORMAT_BC3) {
+                encode_alpha_block(&block, block_output);
+                block_output += 8;
+            }
+
+            encode_color_block(&block, quality, block_output);
+        }
+    }
+}
+
+void compress_mip_chain(unsigned char * rgba_chain, int width, int height, int num_levels, TextureFormat format,
+                        CompressionQuality quality, unsigned char * output) {
+    for(int i = 0; i < num_levels; i++) {
+        compress_block_rows(rgba_chain, width, height, format, quality, output, 0, get_num_rows(format, height));
+
+        rgba_chain += get_level_size(TEXTURE_FORMAT_RGBA8, width, height);
+        output     += get_level_size(format, width, height);
+
+        width  = (width  > 1) ? width  / 2 : 1;
+        height = (height > 1) ? height / 2 : 1;
+    }
+}
+
+// Blocks that hang over the edge of the level repeat its last row and column.
+static void load_block(unsigned char * rgba, int width, int height, int block_x, int block_y, Block * block) {
+    float r[16], g[16], b[16];
+
+    for(int y = 0; y < 4; y++) {
+        int source_y = block_y * 4 + y;
+        if(source_y > height - 1) source_y = height - 1;
+
+        for(int x = 0; x < 4; x++) {
+            int source_x = block_x * 4 + x;
+            if(source_x > width - 1) source_x = width - 1;
+
+            unsigned char * pixel = rgba + (source_y * width + source_x) * 4;
+
+            r[y * 4 + x] = pixel[0];
+            g[y * 4 + x] = pixel[1];
+            b[y * 4 + x] = pixel[2];
+
+            block->alpha[y * 4 + x] = pixel[3];
+        }
+    }
+
+    for(int i = 0; i < 4; i++) {
+        block->r[i] = _mm_loadu_ps(r + i * 4);
+        block->g[i] = _mm_loadu_ps(g + i * 4);
+        block->b[i] = _mm_loadu_ps(b + i * 4);
+    }
+}
+
+static void encode_color_block(Block * block, CompressionQuality quality, unsigned char * output) {
+    float endpoints[2][3];
+
+    if(quality == COMPRESSION_FAST) {
+        get_bounding_box_endpoints(block, endpoints);
+        write_color_block(block, endpoints, output);
+        return;
+    }
+
+    get_principal_axis_endpoints(block, endpoints);
+
+    unsigned char best[8];
+    float best_error = write_color_block(block, endpoints, best);
+
+    // Now that we know which pixels go with which palette entry, least squares gives better endpoints. That changes
+    // the indices, so go again while it keeps getting better.
+    for(int i = 0; i < NUM_REFINEMENTS; i++) {
+        if(!fit_endpoints(block, best, endpoints)) break;
+
+        unsigned char candidate[8];
+        float error = write_color_block(block, endpoints, candidate);
+
+        if(error >= best_error) break;
+
+        memcpy(best, candidate, 8);
+        best_error = error;
+    }
+
+    memcpy(output, best, 8);
+}
+
+// Quantizes the endpoints, picks the closest palette entry for every pixel, and returns the squared error.
+static float write_color_block(Block * block, float endpoints[2][3], unsigned char * output) {
+    unsigned short c0 = pack_565(endpoints[0]);
+    unsigned short c1 = pack_565(endpoints[1]);
+
+    if(c0 < c1) {
+        unsigned short swap = c0;
+        c0 = c1;
+        c1 = swap;
+    }
+
+    output[0] = c0 & 0xff;
+    output[1] = c0 >> 8;
+    output[2] = c1 & 0xff;
+    output[3] = c1 >> 8;
+
+    float palette[4][3];
+    unpack_565(c0, palette[0]);
+    unpack_565(c1, palette[1]);
+
+    for(int c = 0; c < 3; c++) {
+        if(c0 == c1) { // That's the 3 color mode, but index 0 is all we need.
+            palette[2][c] = palette[0][c];
+            palette[3][c] = palette[0][c];
+        } else {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+    }
+
+    unsigned int indices = 0;
+    __m128 total_error = _mm_setzero_ps();
+
+    for(int i = 0; i < 4; i++) {
+        __m128 best_distance = _mm_set1_ps(3.0f * 256.0f * 256.0f);
+        __m128 best_index    = _mm_setzero_ps();
+
+        for(int k = 0; k < 4; k++) {
+            __m128 dr = _mm_sub_ps(block->r[i], _mm_set1_ps(palette[k][0]));
+            __m128 dg = _mm_sub_ps(block->g[i], _mm_set1_ps(palette[k][1]));
+            __m128 db = _mm_sub_ps(block->b[i], _mm_set1_ps(palette[k][2]));
+
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+
+            // Strictly closer only, so ties go to the lower index (and c0 == c1 stays all zeros).
+            __m128 closer = _mm_cmplt_ps(distance, best_distance);
+
+            best_distance = _mm_min_ps(distance, best_distance);
+            best_index    = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps((float) k)), _mm_andnot_ps(closer, best_index));
+        }
+
+        total_error = _mm_add_ps(total_error, best_distance);
+
+        int pixel_indices[4];
+        _mm_storeu_si128((__m128i *) pixel_indices, _mm_cvtps_epi32(best_index));
+
+        for(int j = 0; j < 4; j++) {
+            indices |= (unsigned int) pixel_indices[j] << (2 * (i * 4 + j));
+        }
+    }
+
+    output[4] = (indices >>  0) & 0xff;
+    output[5] = (indices >>  8) & 0xff;
+    output[6] = (indices >> 16) & 0xff;
+    output[7] = (indices >> 24) & 0xff;
+
+    return horizontal_sum(total_error);
+}
+
+// a0 is the biggest alpha and a1 the smallest, the 6 levels in between are evenly spaced, which is as good as it
+// gets for 8 level mode.
+static void encode_alpha_block(Block * block, unsigned char * output) {
+    int a0 = 0;
+    int a1 = 255;
+
+    for(int i = 0; i < 16; i++) {
+        if(block->alpha[i] > a0) a0 = block->alpha[i];
+        if(block->alpha[i] < a1) a1 = block->alpha[i];
+    }
+
+    output[0] = (unsigned char) a0;
+    output[1] = (unsigned char) a1;
+
+    unsigned long long indices = 0;
+
+    if(a0 != a1) {
+        for(int i = 0; i < 16; i++) {
+            // Position between a1 (0) and a0 (7), then the code for it: 0 is a0, 1 is a1, 2 to 7 go from a0 to a1.
+            int position = (int) ((block->alpha[i] - a1) * 7.0f / (a0 - a1) + 0.5f);
+
+            unsigned long long code;
+            if(position == 7)      code = 0;
+            else if(position == 0) code = 1;
+            else                   code = 8 - position;
+
+            indices |= code << (3 * i);
+        }
+    }
+
+    for(int i = 0; i < 6; i++) {
+        output[2 + i] = (indices >> (8 * i)) & 0xff;
+    }
+}
+
+// Corners of the colors' bounding box, pulled in a bit since the extremes are rarely worth an endpoint.
+static void get_bounding_box_endpoints(Block * block, float endpoints[2][3]) {
+    __m128 * channels[3] = { block->r, block->g, block->b };
+
+    float min[3];
+    float max[3];
+    float center[3];
+
+    for(int c = 0; c < 3; c++) {
+        __m128 * values = channels[c];
+
+        min[c] = horizontal_min(_mm_min_ps(_mm_min_ps(values[0], values[1]), _mm_min_ps(values[2], values[3])));
+        max[c] = horizontal_max(_mm_max_ps(_mm_max_ps(values[0], values[1]), _mm_max_ps(values[2], values[3])));
+
+        float inset = (max[c] - min[c]) / 16.0f;
+        min[c] += inset;
+        max[c] -= inset;
+
+        center[c] = (min[c] + max[c]) * 0.5f;
+    }
+
+    // The box has 4 diagonals and we took the one where every channel goes up together. If red or blue go down as
+    // green goes up, flip them.
+    __m128 covariance_rg = _mm_setzero_ps();
+    __m128 covariance_bg = _mm_setzero_ps();
+
+    for(int i = 0; i < 4; i++) {
+        __m128 g = _mm_sub_ps(block->g[i], _mm_set1_ps(center[1]));
+
+        covariance_rg = _mm_add_ps(covariance_rg, _mm_mul_ps(_mm_sub_ps(block->r[i], _mm_set1_ps(center[0])), g));
+        covariance_bg = _mm_add_ps(covariance_bg, _mm_mul_ps(_mm_sub_ps(block->b[i], _mm_set1_ps(center[2])), g));
+    }
+
+    if(horizontal_sum(covariance_rg) < 0.0f) {
+        float swap = min[0];
+        min[0] = max[0];
+        max[0] = swap;
+    }
+
+    if(horizontal_sum(covariance_bg) < 0.0f) {
+        float swap = min[2];
+        min[2] = max[2];
+        max[2] = swap;
+    }
+
+    for(int c = 0; c < 3; c++) {
+        endpoints[0][c] = max[c];
+        endpoints[1][c] = min[c];
+    }
+}
+
+// The line that best fits the colors goes through their mean, along the eigenvector of their covariance with the
+// biggest eigenvalue. We get it with a few power iterations, then put the endpoints at the extreme projections.
+static void get_principal_axis_endpoints(Block * block, float endpoints[2][3]) {
+    __m128 * channels[3] = { block->r, block->g, block->b };
+
+    float mean[3];
+    for(int c = 0; c < 3; c++) {
+        __m128 * values = channels[c];
+        mean[c] = horizontal_sum(_mm_add_ps(_mm_add_ps(values[0], values[1]), _mm_add_ps(values[2], values[3]))) / 16.0f;
+    }
+
+    float covariance[3][3];
+    for(int c0 = 0; c0 < 3; c0++) {
+        for(int c1 = c0; c1 < 3; c1++) {
+            __m128 sum = _mm_setzero_ps();
+
+            for(int i = 0; i < 4; i++) {
+                __m128 d0 = _mm_sub_ps(channels[c0][i], _mm_set1_ps(mean[c0]));
+                __m128 d1 = _mm_sub_ps(channels[c1][i], _mm_set1_ps(mean[c1]));
+                sum = _mm_add_ps(sum, _mm_mul_ps(d0, d1));
+            }
+
+            covariance[c0][c1] = covariance[c1][c0] = horizontal_sum(sum);
+        }
+    }
+
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+
+    for(int iteration = 0; iteration < NUM_POWER_ITERATIONS; iteration++) {
+        float next[3];
+        for(int c = 0; c < 3; c++) {
+            next[c] = covariance[c][0] * axis[0] + covariance[c][1] * axis[1] + covariance[c][2] * axis[2];
+        }
+
+        float length = sqrtf(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+
+        if(length < 1e-6f) { // Every pixel has the same color (or close enough).
+            for(int c = 0; c < 3; c++) endpoints[0][c] = endpoints[1][c] = mean[c];
+            return;
+        }
+
+        for(int c = 0; c < 3; c++) axis[c] = next[c] / length;
+    }
+
+    __m128 min_projection = _mm_set1_ps( 1e9f);
+    __m128 max_projection = _mm_set1_ps(-1e9f);
+
+    for(int i = 0; i < 4; i++) {
+        __m128 projection = _mm_mul_ps(_mm_sub_ps(block->r[i], _mm_set1_ps(mean[0])), _mm_set1_ps(axis[0]));
+        projection = _mm_add_ps(projection, _mm_mul_ps(_mm_sub_ps(block->g[i], _mm_set1_ps(mean[1])), _mm_set1_ps(axis[1])));
+        projection = _mm_add_ps(projection, _mm_mul_ps(_mm_sub_ps(block->b[i], _mm_set1_ps(mean[2])), _mm_set1_ps(axis[2])));
+
+        min_projection = _mm_min_ps(min_projection, projection);
+        max_projection = _mm_max_ps(max_projection, projection);
+    }
+
+    float min_t = horizontal_min(min_projection);
+    float max_t = horizontal_max(max_projection);
+
+    for(int c = 0; c < 3; c++) {
+        endpoints[0][c] = mean[c] + axis[c] * max_t;
+        endpoints[1][c] = mean[c] + axis[c] * min_t;
+    }
+}
+
+// Least squares endpoints for the indices in color_block. Every pixel is w * e0 + (1 - w) * e1, with w depending on
+// its index, which gives a 2x2 system per channel. Returns false when it's singular (every pixel on the same index).
+static bool fit_endpoints(Block * block, unsigned char * color_block, float endpoints[2][3]) {
+    static const float INDEX_WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+    unsigned int indices = color_block[4] | (color_block[5] << 8) | (color_block[6] << 16) | ((unsigned int) color_block[7] << 24);
+
+    float pixels[3][16];
+    for(int i = 0; i < 4; i++) {
+        _mm_storeu_ps(pixels[0] + i * 4, block->r[i]);
+        _mm_storeu_ps(pixels[1] + i * 4, block->g[i]);
+        _mm_storeu_ps(pixels[2] + i * 4, block->b[i]);
+    }
+
+    float ww = 0.0f, wv = 0.0f, vv = 0.0f; // v = 1 - w
+    float wx[3] = {};
+    float vx[3] = {};
+
+    for(int i = 0; i < 16; i++) {
+        float w = INDEX_WEIGHTS[(indices >> (2 * i)) & 3];
+        float v = 1.0f - w;
+
+        ww += w * w;
+        wv += w * v;
+        vv += v * v;
+
+        for(int c = 0; c < 3; c++) {
+            wx[c] += w * pixels[c][i];
+            vx[c] += v * pixels[c][i];
+        }
+    }
+
+    float determinant = ww * vv - wv * wv;
+
+    if(fabsf(determinant) < 1e-6f) return false;
+
+    for(int c = 0; c < 3; c++) {
+        float e0 = (vv * wx[c] - wv * vx[c]) / determinant;
+        float e1 = (ww * vx[c] - wv * wx[c]) / determinant;
+
+        endpoints[0][c] = (e0 < 0.0f) ? 0.0f : (e0 > 255.0f) ? 255.0f : e0;
+        endpoints[1][c] = (e1 < 0.0f) ? 0.0f : (e1 > 255.0f) ? 255.0f : e1;
+    }
+
+    return true;
+}
+
+static unsigned short pack_565(float * color) {
+    int r = (int) (color[0] * 31.0f / 255.0f + 0.5f);
+    int g = (int) (color[1] * 63.0f / 255.0f + 0.5f);
+    int b = (int) (color[2] * 31.0f / 255.0f + 0.5f);
+
+    r = (r < 0) ? 0 : (r > 31) ? 31 : r;
+    g = (g < 0) ? 0 : (g > 63) ? 63 : g;
+    b = (b < 0) ? 0 : (b > 31) ? 31 : b;
+
+    return (unsigned short) ((r << 11) | (g << 5) | b);
+}
+
+// Same expansion as the GPU, the top bits get repeated in the bottom ones.
+static void unpack_565(unsigned short packed, float * color) {
+    int r = (packed >> 11) & 31;
+    int g = (packed >>  5) & 63;
+    int b = (packed >>  0) & 31;
+
+    color[0] = (float) ((r << 3) | (r >> 2));
+    color[1] = (float) ((g << 2) | (g >> 4));
+    color[2] = (float) ((b << 3) | (b >> 2));
+}
+
+static float horizontal_min(__m128 values) {
+    values = _mm_min_ps(values, _mm_shuffle_ps(values, values, _MM_SHUFFLE(2, 3, 0, 1)));
+    values = _mm_min_ps(values, _mm_shuffle_ps(values, values, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(values);
+}
+
+static float horizontal_max(__m128 values) {
+    values = _mm_max_ps(values, _mm_shuffle_ps(values, values, _MM_SHUFFLE(2, 3, 0, 1)));
+    values = _mm_max_ps(values, _mm_shuffle_ps(values, values, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(values);
+}
+
+static float horizontal_sum(__m128 values) {
+    values = _mm_add_ps(values, _mm_shuffle_ps(values, values, _MM_SHUFFLE(2, 3, 0, 1)));
+    values = _mm_add_ps(values, _mm_shuffle_ps(values, values, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(values);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "texture_format.h"
+
+// BC1 and BC3 encoders, see /cook in the builder. Every function here is thread safe.
+
+enum CompressionQuality {
+    COMPRESSION_FAST, // Bounding box endpoints, one pass. Good enough to preview, or to compress at load time.
+    COMPRESSION_HIGH, // Endpoints along the colors' principal axis, then refined with least squares. What we ship.
+};
+
+// D3D11 wants both sides of the first level to be a multiple of 4 for block compressed textures. The mips below don't
+// have to be, they get padded to whole blocks.
+inline bool can_block_compress(int width, int height) {
+    return (width % 4 == 0) && (height % 4 == 0);
+}
+
+// BC1 if every pixel is opaque, BC3 otherwise.
+TextureFormat pick_compressed_format(unsigned char * rgba, int width, int height);
+
+// Compresses the rows of blocks [first_block_row, first_block_row + num_block_rows) of an RGBA8 level. output points
+// to the whole compressed level, so threads can each take a range of rows and write to the same buffer.
+void compress_block_rows(unsigned char * rgba, int width, int height, TextureFormat format, CompressionQuality quality,
+                         unsigned char * output, int first_block_row, int num_block_rows);
+
+// The whole chain, on the calling thread. output has to be get_mip_chain_size(format, ...) bytes.
+void compress_mip_chain(unsigned char * rgba_chain, int width, int height, int num_levels, TextureFormat format,
+                        CompressionQuality quality, unsigned char * output);
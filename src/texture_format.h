@@ -0,0 +1,50 @@
+#pragma once
+
+// How a texture's bitmap is laid out. Compressed formats store 4x4 blocks, rows of blocks from top to bottom, and a
+// level smaller than a block still takes a whole one.
+
+enum TextureFormat {
+    TEXTURE_FORMAT_RGBA8,
+    TEXTURE_FORMAT_A8,  // Font atlases
+    TEXTURE_FORMAT_BC1, // Opaque, 8 bytes per block
+    TEXTURE_FORMAT_BC3, // With alpha, 16 bytes per block
+
+    TEXTURE_FORMAT_COUNT,
+};
+
+inline bool is_block_compressed(TextureFormat format) {
+    return format == TEXTURE_FORMAT_BC1 || format == TEXTURE_FORMAT_BC3;
+}
+
+// Bytes per pixel for uncompressed formats, per block for compressed ones.
+inline int get_format_unit_size(TextureFormat format) {
+    switch(format) {
+        case TEXTURE_FORMAT_RGBA8 : return 4;
+        case TEXTURE_FORMAT_A8    : return 1;
+        case TEXTURE_FORMAT_BC1   : return 8;
+        case TEXTURE_FORMAT_BC3   : return 16;
+        default                   : return 0;
+    }
+}
+
+// Bytes from one row to the next, rows of blocks for compressed formats.
+inline int get_row_pitch(TextureFormat format, int width) {
+    if(is_block_compressed(format)) width = (width + 3) / 4;
+
+    return width * get_format_unit_size(format);
+}
+
+inline int get_num_rows(TextureFormat format, int height) {
+    return is_block_compressed(format) ? (height + 3) / 4 : height;
+}
+
+inline int get_level_size(TextureFormat format, int width, int height) {
+    return get_row_pitch(format, width) * get_num_rows(format, height);
+}
+
+// Of pixel (x, y) from the start of a level, x and y on block boundaries for compressed formats.
+inline int get_pixel_offset(TextureFormat format, int row_pitch, int x, int y) {
+    if(is_block_compressed(format)) return (y / 4) * row_pitch + (x / 4) * get_format_unit_size(format);
+
+    return y * row_pitch + x * get_format_unit_size(format);
+}
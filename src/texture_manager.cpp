@@ -1,13 +1,46 @@
 #define STBI_ONLY_PNG
+#define STBI_NO_FAILURE_STRINGS // They go through a global in this version of stb_image, and we decode on several threads.
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 #include "texture_manager.h"
 #include "macros.h"
+#include "pack_file.h"
+#include "cooked_assets.h"
+#include "texture_compression.h"
+#include "renderer.h"
 #include "os/layer.h"
 
+// Private functions
+static long long get_chain_size(Texture * texture);
+static int compare_last_used(const void * a, const void * b);
+
 void TextureManager::init() {
     this->extensions.add("png");
+
+    // Fully transparent, things pop in when their texture is back rather than flash something else first.
+    String empty_string;
+    empty_string.data = "";
+    empty_string.count = 0;
+
+    Texture * placeholder = (Texture *) malloc(sizeof(Texture));
+    *placeholder = {};
+
+    placeholder->name            = to_string("streaming_placeholder");
+    placeholder->full_path       = empty_string;
+    placeholder->bitmap          = (unsigned char *) calloc(1, 4);
+    placeholder->width           = 1;
+    placeholder->height          = 1;
+    placeholder->format          = TEXTURE_FORMAT_RGBA8;
+    placeholder->bytes_per_pixel = 4;
+    placeholder->num_mip_levels  = 1;
+    placeholder->width_in_bytes  = 4;
+    placeholder->num_bytes       = 4;
+    placeholder->streamable      = false;
+    placeholder->keep_bitmap     = true;
+    placeholder->last_used_frame = -1;
+
+    this->streaming_placeholder = placeholder; // Not in the table, nobody should find it by name.
 }
 
 Texture * TextureManager::create_texture(String name, unsigned char * data, int width, int height, int bytes_per_pixel) { // Default : bytes_per_pixel = 4
@@ -22,9 +55,13 @@ Texture * TextureManager::create_texture(String name, unsigned char * data, int
     texture->bitmap          = data;
     texture->width           = width;
     texture->height          = height;
+    texture->format          = (bytes_per_pixel == 1) ? TEXTURE_FORMAT_A8 : TEXTURE_FORMAT_RGBA8;
     texture->bytes_per_pixel = bytes_per_pixel;
+    texture->num_mip_levels  = 1;
     texture->width_in_bytes  = width * bytes_per_pixel;
     texture->num_bytes       = width * height * bytes_per_pixel;
+    texture->streamable      = false; // There is no file to load it back from.
+    texture->keep_bitmap     = true;
 
     return texture;
 }
@@ -32,11 +69,24 @@ Texture * TextureManager::create_texture(String name, unsigned char * data, int
 void TextureManager::create_placeholder(String name, String path) {
     Texture * texture = (Texture * ) malloc(sizeof(Texture));
 
-    texture->name          = name;
-    texture->full_path     = path;
-    texture->dirty         = false;
-    texture->platform_info = NULL;
-    texture->bitmap        = NULL;
+    texture->name           = name;
+    texture->full_path      = path;
+    texture->dirty          = false;
+    texture->dirty_rect     = {};
+    texture->platform_info  = NULL;
+    texture->bitmap         = NULL;
+    texture->format         = TEXTURE_FORMAT_RGBA8;
+    texture->num_mip_levels = 1;
+
+    texture->streamable      = true;
+    texture->stream_in       = false;
+    texture->last_used_frame = -1;
+    texture->keep_bitmap     = !this->release_uploaded_bitmaps;
+    texture->bitmap_pins     = 0;
+
+    texture->content_hash   = 0;
+    texture->loading        = false;
+    texture->reload_pending = false;
 
     this->table.add(name, texture);
 }
@@ -55,40 +105,336 @@ void TextureManager::reload_or_create_asset(String full_path, String file_name)
     do_load_texture((Texture *) asset);
 }
 
-// @Incomplete Handle other file types in addition to PNG.
+void TextureManager::load_asset(Asset * asset) {
+    do_load_texture((Texture *) asset);
+}
+
+// What decode_texture gives us. bitmap holds num_mip_levels levels back to back, see cooked_assets.h.
+struct DecodedTexture {
+    unsigned char * bitmap;
+    int width;
+    int height;
+    TextureFormat format;
+    int num_mip_levels;
+};
+
+// Decoded on a worker thread, published by end_async_load.
+struct LoadedTexture {
+    Texture * texture;
+
+    String full_path; // Copy, the texture's path can't be touched from the worker.
+
+    unsigned long long previous_hash;
+    unsigned long long content_hash;
+
+    bool compress;
+
+    DecodedTexture decoded;
+};
+
+// Private functions
+static bool decode_texture(String name, String full_path, unsigned long long previous_hash, unsigned long long * content_hash, bool compress, DecodedTexture * decoded);
+static bool read_cooked_texture(String name, String file_data, DecodedTexture * decoded);
+static void publish_texture(Texture * texture, DecodedTexture * decoded);
+
+void * TextureManager::begin_async_load(Asset * asset) {
+    if(should_skip_load((Texture *) asset)) return NULL; // load_asset skips it too.
+
+    LoadedTexture * load = (LoadedTexture *) malloc(sizeof(LoadedTexture));
+
+    load->texture        = (Texture *) asset;
+    load->decoded.bitmap = NULL;
+    load->previous_hash  = asset->content_hash;
+    load->content_hash   = 0;
+    load->compress       = this->compress_loose_textures;
+
+    load->full_path.count = asset->full_path.count;
+    load->full_path.data  = (char *) malloc(asset->full_path.count);
+    memcpy(load->full_path.data, asset->full_path.data, asset->full_path.count);
+
+    return load;
+}
+
+void TextureManager::do_async_load(void * data) {
+    LoadedTexture * load = (LoadedTexture *) data;
+
+    // The name is only read here for logging, nothing renames assets while they load.
+    decode_texture(load->texture->name, load->full_path, load->previous_hash, &load->content_hash, load->compress, &load->decoded);
+}
+
+void TextureManager::end_async_load(void * data) {
+    LoadedTexture * load = (LoadedTexture *) data;
+    scope_exit(free(load));
+    scope_exit(free(load->full_path.data));
+
+    if(load->decoded.bitmap == NULL) return; // Keep whatever we had.
+
+    publish_texture(load->texture, &load->decoded);
+    load->texture->content_hash = load->content_hash;
+}
+
 void TextureManager::do_load_texture(Texture * texture) {
-    String file_data = os_specific_read_file(texture->full_path);
-    scope_exit(free(file_data.data));
+    if(should_skip_load(texture)) return;
 
-    int width, height, bytes_per_pixel;
-    unsigned char * bitmap = stbi_load_from_memory((unsigned char *) file_data.data, file_data.count, &width, &height, &bytes_per_pixel, 4);
+    DecodedTexture decoded;
+    unsigned long long content_hash;
 
-    if(bitmap == NULL) {
-        char * c_name = to_c_string(texture->name);
-        scope_exit(free(c_name));
-        log_print("do_load_texture", "Failed to load texture \"%s\"", c_name);
+    if(!decode_texture(texture->name, texture->full_path, texture->content_hash, &content_hash, this->compress_loose_textures, &decoded)) return;
+
+    publish_texture(texture, &decoded);
+    texture->content_hash = content_hash;
+}
+
+// With a budget, textures that aren't resident only get loaded when something draws them. That goes for the first
+// load, and for hotloads of evicted textures too, they'll get the new file whenever they come back.
+bool TextureManager::should_skip_load(Texture * texture) {
+    return this->memory_budget && texture->streamable && !is_resident(texture) && !texture->stream_in;
+}
+
+Texture * TextureManager::use_texture(Texture * texture) {
+    texture->last_used_frame = this->current_frame;
+
+    if(is_resident(texture)) return texture;
+
+    // Queue it once, if that load fails we keep drawing the placeholder rather than try again every frame.
+    if(texture->streamable && !texture->stream_in && !texture->loading) {
+        texture->stream_in = true;
+
+        // The path we queue gets freed by find_or_create_asset since the texture exists, so give it a copy.
+        Asset reload = *texture;
+        reload.full_path.data = (char *) malloc(texture->full_path.count);
+        memcpy(reload.full_path.data, texture->full_path.data, texture->full_path.count);
+
+        this->assets_to_reload.add(reload);
+    }
+
+    return this->streaming_placeholder;
+}
+
+// Bitmaps the backend has uploaded get released first, so that what we count and evict is what we actually hold.
+// Then we evict the textures that were drawn the longest ago until we fit in the budget. Anything drawn this frame
+// stays, evicting it would only have us load it again right away.
+//
+// @Speed This walks every texture every frame. Fine for the few hundred we have, a list of the textures uploaded
+// this frame would do for the releases if it ever shows up.
+void TextureManager::update_residency() {
+    int frame = this->current_frame;
+    this->current_frame += 1;
+
+    this->cpu_bytes = 0;
+    this->gpu_bytes = 0;
+
+    this->eviction_candidates.reset();
+
+    for_array(this->table.mask.data, this->table.mask.allocated) {
+        if(!*it) for_array_continue;
+
+        Texture * texture = this->table.values.data[it_index];
+
+        // Dirty means there is a new bitmap the backend hasn't seen yet, or part of one.
+        bool uploaded = texture->platform_info && !texture->dirty && !has_dirty_region(texture);
+
+        if(texture->bitmap && uploaded && !texture->keep_bitmap && !texture->bitmap_pins) {
+            free(texture->bitmap);
+            texture->bitmap = NULL;
+        }
+
+        long long size = get_chain_size(texture);
+        if(texture->bitmap)        this->cpu_bytes += size;
+        if(texture->platform_info) this->gpu_bytes += size;
+
+        if(!texture->streamable || !is_resident(texture) || texture->loading || texture->bitmap_pins) for_array_continue;
+        if(texture->last_used_frame == frame) for_array_continue;
+
+        this->eviction_candidates.add(texture);
+    }
+
+    long long budget = this->memory_budget;
+
+    if(!budget || this->cpu_bytes + this->gpu_bytes <= budget) {
+        this->warned_over_budget = false;
         return;
     }
 
+    qsort(this->eviction_candidates.data, this->eviction_candidates.count, sizeof(Texture *), compare_last_used);
+
+    for(int i = 0; i < this->eviction_candidates.count && this->cpu_bytes + this->gpu_bytes > budget; i++) {
+        evict_texture(this->eviction_candidates.data[i]);
+    }
+
+    if(this->cpu_bytes + this->gpu_bytes <= budget) {
+        this->warned_over_budget = false;
+    } else if(!this->warned_over_budget) {
+        this->warned_over_budget = true;
+        log_print("update_residency", "%.1f MB of textures are still resident after evicting everything we could, the budget is %.1f MB",
+                  (this->cpu_bytes + this->gpu_bytes) / (1024.0 * 1024.0), budget / (1024.0 * 1024.0));
+    }
+}
+
+void TextureManager::evict_texture(Texture * texture) {
+    long long size = get_chain_size(texture);
+    if(texture->bitmap)        this->cpu_bytes -= size;
+    if(texture->platform_info) this->gpu_bytes -= size;
+
+    free(texture->bitmap);
+    texture->bitmap       = NULL;
+    texture->content_hash = 0; // Nothing is loaded, so the next load can't be skipped for having the same contents.
+
+    unload_texture(texture);
+}
+
+unsigned char * TextureManager::acquire_bitmap(Texture * texture) {
+    // Only pin once there are pixels to hand out, a NULL return has nothing to release.
     if(texture->bitmap) {
-        free(texture->bitmap);
+        texture->bitmap_pins += 1;
+        return texture->bitmap;
     }
 
-    texture->bitmap = bitmap;
+    if(!texture->streamable) return NULL;
+
+    DecodedTexture decoded;
+    unsigned long long content_hash;
+
+    if(!decode_texture(texture->name, texture->full_path, 0, &content_hash, this->compress_loose_textures, &decoded)) return NULL;
+
+    if(is_resident(texture) && content_hash == texture->content_hash) {
+        // Same file as what the backend has, we only wanted the pixels back.
+        texture->bitmap = decoded.bitmap;
+    } else {
+        // It changed on disk since, or it was evicted. Take the new one everywhere.
+        publish_texture(texture, &decoded);
+        texture->content_hash = content_hash;
+    }
+
+    if(texture->bitmap) texture->bitmap_pins += 1;
+
+    return texture->bitmap;
+}
+
+void TextureManager::release_bitmap(Texture * texture) {
+    assert(texture->bitmap_pins > 0);
+    texture->bitmap_pins -= 1; // update_residency releases it if it should.
+}
 
-    if(bytes_per_pixel != 4) {
-        char * c_name = to_c_string(texture->name);
+// Every mip level, that's what we keep on the CPU and what the backend uploads.
+static long long get_chain_size(Texture * texture) {
+    return get_mip_chain_size(texture->format, texture->width, texture->height, texture->num_mip_levels);
+}
+
+// Least recently drawn first.
+static int compare_last_used(const void * a, const void * b) {
+    Texture * first  = *(Texture **) a;
+    Texture * second = *(Texture **) b;
+
+    return first->last_used_frame - second->last_used_frame;
+}
+
+// @Incomplete Handle other file types in addition to PNG.
+// Thread safe, it only reads the file and decodes it. Returns false if it failed, or if the file still hashes to
+// previous_hash, in which case there is nothing to decode, upload or invalidate.
+static bool decode_texture(String name, String full_path, unsigned long long previous_hash, unsigned long long * content_hash, bool compress, DecodedTexture * decoded) {
+    decoded->bitmap = NULL;
+
+    String file_data = read_asset_file(full_path, content_hash);
+    scope_exit(free_asset_file(file_data));
+
+    if(!file_data.data) return false; // Should have already errored.
+
+    if(*content_hash == previous_hash) {
+        char * c_name = to_c_string(name);
+        scope_exit(free(c_name));
+        log_print("do_load_texture", "Skipped reloading texture \"%s\", its contents didn't change", c_name);
+        return false;
+    }
+
+    if(is_cooked(file_data.data, file_data.count, COOKED_TEXTURE_MAGIC)) {
+        return read_cooked_texture(name, file_data, decoded);
+    }
+
+    int channels_in_file;
+    unsigned char * pixels = stbi_load_from_memory((unsigned char *) file_data.data, file_data.count, &decoded->width, &decoded->height, &channels_in_file, 4);
+
+    if(pixels == NULL) {
+        char * c_name = to_c_string(name);
         scope_exit(free(c_name));
-        log_print("do_load_texture", "Loaded texture \"%s\", it has %d bit depth, please convert to 32 bit depth", c_name, bytes_per_pixel * 8);
-        bytes_per_pixel = 4;
+        log_print("do_load_texture", "Failed to load texture \"%s\"", c_name);
+        return false;
+    }
+
+    if(channels_in_file != 4) {
+        char * c_name = to_c_string(name);
+        scope_exit(free(c_name));
+        log_print("do_load_texture", "Loaded texture \"%s\", it has %d bit depth, please convert to 32 bit depth", c_name, channels_in_file * 8);
     } else {
         // log_print("do_load_texture", "Loaded texture \"%s\"", texture->name);
     }
 
-    texture->width           = width;
-    texture->height          = height;
-    texture->bytes_per_pixel = bytes_per_pixel;
-    texture->width_in_bytes  = width * bytes_per_pixel;
-    texture->num_bytes       = width * height * bytes_per_pixel;
+    // PNGs only have the first level, the rest of the chain gets built here, on the worker.
+    decoded->format         = TEXTURE_FORMAT_RGBA8;
+    decoded->num_mip_levels = get_num_mip_levels(decoded->width, decoded->height);
+
+    decoded->bitmap = (unsigned char *) malloc(get_mip_chain_size(TEXTURE_FORMAT_RGBA8, decoded->width, decoded->height, decoded->num_mip_levels));
+    memcpy(decoded->bitmap, pixels, decoded->width * decoded->height * 4);
+
+    stbi_image_free(pixels);
+
+    generate_mip_levels(decoded->bitmap, decoded->width, decoded->height, decoded->num_mip_levels, MIP_FILTER_BOX);
+
+    if(compress && can_block_compress(decoded->width, decoded->height)) {
+        TextureFormat format = pick_compressed_format(decoded->bitmap, decoded->width, decoded->height);
+
+        unsigned char * compressed = (unsigned char *) malloc(get_mip_chain_size(format, decoded->width, decoded->height, decoded->num_mip_levels));
+        compress_mip_chain(decoded->bitmap, decoded->width, decoded->height, decoded->num_mip_levels, format, COMPRESSION_FAST, compressed);
+
+        free(decoded->bitmap);
+        decoded->bitmap = compressed;
+        decoded->format = format;
+    }
+
+    return true;
+}
+
+// Cooked textures are already decoded, all we do is copy them out of the file.
+static bool read_cooked_texture(String name, String file_data, DecodedTexture * decoded) {
+    CookedTextureHeader * header = (CookedTextureHeader *) file_data.data;
+
+    int chain_size = 0;
+    if(file_data.count >= sizeof(CookedTextureHeader) && header->format >= 0 && header->format < TEXTURE_FORMAT_COUNT) {
+        chain_size = get_mip_chain_size((TextureFormat) header->format, header->width, header->height, header->num_mip_levels);
+    }
+
+    if(!chain_size || file_data.count != sizeof(CookedTextureHeader) + chain_size) {
+        char * c_name = to_c_string(name);
+        scope_exit(free(c_name));
+        log_print("do_load_texture", "Cooked texture \"%s\" is %d bytes, which doesn't match its header", c_name, file_data.count);
+        return false;
+    }
+
+    decoded->width          = header->width;
+    decoded->height         = header->height;
+    decoded->format         = (TextureFormat) header->format;
+    decoded->num_mip_levels = header->num_mip_levels;
+
+    decoded->bitmap = (unsigned char *) malloc(chain_size);
+    memcpy(decoded->bitmap, header + 1, chain_size);
+
+    return true;
+}
+
+static void publish_texture(Texture * texture, DecodedTexture * decoded) {
+    if(texture->bitmap) {
+        free(texture->bitmap);
+    }
+
+    texture->bitmap          = decoded->bitmap;
+    texture->width           = decoded->width;
+    texture->height          = decoded->height;
+    texture->format          = decoded->format;
+    texture->bytes_per_pixel = is_block_compressed(decoded->format) ? 0 : get_format_unit_size(decoded->format);
+    texture->num_mip_levels  = decoded->num_mip_levels;
+    texture->width_in_bytes  = get_row_pitch (decoded->format, decoded->width);
+    texture->num_bytes       = get_level_size(decoded->format, decoded->width, decoded->height);
     texture->dirty           = true;
+    texture->dirty_rect      = {}; // It all gets uploaded again.
+    texture->stream_in       = false;
 }
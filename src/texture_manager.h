@@ -1,32 +1,186 @@
 #include "asset_manager.h"
+#include "mip_maps.h"
 
 struct PlatformTextureInfo;
 
+// Pixels of the first level, x1 and y1 excluded. Empty if x1 <= x0.
+struct TextureRect {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+};
+
 struct Texture : Asset{
     int width;
     int height;
 
-    int bytes_per_pixel;
+    TextureFormat format;
+    int bytes_per_pixel; // 0 for block compressed formats
 
-    unsigned char * bitmap;
+    unsigned char * bitmap; // Every mip level, back to back, from width x height down to 1x1. NULL once uploaded, unless keep_bitmap.
+    int num_mip_levels;
 
-    int width_in_bytes;
-    int num_bytes;
+    int width_in_bytes; // Of the first level, rows of blocks for compressed formats
+    int num_bytes;      // Of the first level
 
-    bool dirty; // Was it changed this frame ?
+    bool dirty;             // Was it changed this frame ? The backend makes it again from scratch.
+    TextureRect dirty_rect; // Changed pixels, same size and format. The backend updates them in place, every level.
 
-    PlatformTextureInfo * platform_info; // Pointer to data structure containing platform specific fields
+    PlatformTextureInfo * platform_info; // Pointer to data structure containing platform specific fields, NULL until the backend uploads it.
+
+    // Residency, see TextureManager::update_residency.
+    bool streamable;      // Loaded from a file, so we can drop it and load it again. Font atlases aren't.
+    bool stream_in;       // Drawn while it wasn't resident, a load is queued.
+    int  last_used_frame; // -1 if it was never drawn
+
+    bool keep_bitmap; // Keep the pixels on the CPU after upload, see TextureManager::release_uploaded_bitmaps.
+    int  bitmap_pins; // acquire_bitmap calls not released yet, the bitmap stays while there are any.
 };
 
+// For small changes to the bitmap (glyphs added to an atlas, the editor painting), cheaper than setting dirty. Update
+// the bitmap first, mip levels included, it has to stay there until the next draw.
+inline void mark_texture_region_dirty(Texture * texture, int x, int y, int width, int height) {
+    assert(texture->bitmap);
+
+    int x1 = x + width;
+    int y1 = y + height;
+
+    if(x  < 0) x  = 0;
+    if(y  < 0) y  = 0;
+    if(x1 > texture->width)  x1 = texture->width;
+    if(y1 > texture->height) y1 = texture->height;
+
+    if(x1 <= x || y1 <= y) return;
+
+    TextureRect * rect = &texture->dirty_rect;
+
+    if(rect->x1 <= rect->x0) {
+        *rect = {x, y, x1, y1};
+        return;
+    }
+
+    if(x  < rect->x0) rect->x0 = x;
+    if(y  < rect->y0) rect->y0 = y;
+    if(x1 > rect->x1) rect->x1 = x1;
+    if(y1 > rect->y1) rect->y1 = y1;
+}
+
+inline bool has_dirty_region(Texture * texture) {
+    return texture->dirty_rect.x1 > texture->dirty_rect.x0;
+}
+
+// On either side, we can draw it without loading anything.
+inline bool is_resident(Texture * texture) {
+    return texture->bitmap || texture->platform_info;
+}
+
+struct MipLevel {
+    unsigned char * data;
+    int width;
+    int height;
+    int row_pitch; // Rows of blocks for compressed formats
+    int num_bytes;
+};
+
+// For the backends, so they don't have to know how the chain is laid out.
+inline MipLevel get_mip_level(Texture * texture, int level) {
+    MipLevel mip;
+    mip.data   = texture->bitmap;
+    mip.width  = texture->width;
+    mip.height = texture->height;
+
+    for(int i = 0; i < level; i++) {
+        mip.data  += get_level_size(texture->format, mip.width, mip.height);
+        mip.width  = (mip.width  > 1) ? mip.width  / 2 : 1;
+        mip.height = (mip.height > 1) ? mip.height / 2 : 1;
+    }
+
+    mip.row_pitch = get_row_pitch (texture->format, mip.width);
+    mip.num_bytes = get_level_size(texture->format, mip.width, mip.height);
+
+    return mip;
+}
+
+// What rect covers in a level: halved at each level, rounded out, and out to whole blocks for compressed formats.
+inline TextureRect get_mip_level_rect(Texture * texture, TextureRect rect, int level) {
+    MipLevel mip = get_mip_level(texture, level);
+
+    int scale = 1 << level;
+
+    TextureRect level_rect;
+    level_rect.x0 = rect.x0 / scale;
+    level_rect.y0 = rect.y0 / scale;
+    level_rect.x1 = (rect.x1 + scale - 1) / scale;
+    level_rect.y1 = (rect.y1 + scale - 1) / scale;
+
+    if(is_block_compressed(texture->format)) {
+        level_rect.x0 &= ~3;
+        level_rect.y0 &= ~3;
+        level_rect.x1 = (level_rect.x1 + 3) & ~3;
+        level_rect.y1 = (level_rect.y1 + 3) & ~3;
+    }
+
+    if(level_rect.x1 > mip.width)  level_rect.x1 = mip.width;
+    if(level_rect.y1 > mip.height) level_rect.y1 = mip.height;
+
+    return level_rect;
+}
+
 struct TextureManager : AssetManager_Poly<Texture> {
+    // Block compress textures loaded from PNGs, on the load workers. Cooked textures are compressed by the builder
+    // already, this is for seeing what compression does to a texture without cooking. Set it before loading anything.
+    bool compress_loose_textures = false;
+
+    // Once the backend has uploaded a texture, free its bitmap. Textures with no file to load them back from (font
+    // atlases, create_texture) always keep theirs. Set it before loading anything.
+    bool release_uploaded_bitmaps = false;
+
+    // Bytes of mip chains we keep around, CPU and GPU together, 0 for no limit. With a budget, textures only get
+    // loaded the first time they're drawn, and the ones that haven't been drawn for the longest get dropped when we
+    // go over it. They draw as streaming_placeholder until they're back. Set it before loading anything.
+    long long memory_budget = 0;
+
+    // As of the last update_residency, font atlases included.
+    long long cpu_bytes = 0;
+    long long gpu_bytes = 0;
+
+    Texture * streaming_placeholder;
+
     void init();
 
+    // Called by the renderer for every texture it draws. Returns what to actually draw.
+    Texture * use_texture(Texture * texture);
+
+    // Once per frame, after drawing. Drops uploaded bitmaps, counts cpu_bytes and gpu_bytes, and evicts until we're
+    // back under memory_budget.
+    void update_residency();
+
+    // For reading pixels back (the editor, tools), loads the bitmap again if it was released. Returns NULL if that
+    // failed, and then there is nothing to release. Otherwise the bitmap stays until the matching release_bitmap, but
+    // a reload can still swap it for a new one, so don't keep the pointer across frames.
+    unsigned char * acquire_bitmap(Texture * texture);
+    void            release_bitmap(Texture * texture);
+
     void reload_or_create_asset(String file_path, String file_name);
     void create_placeholder(String name, String path);
 
+    void load_asset(Asset * asset);
+
+    void * begin_async_load(Asset * asset);
+    void   do_async_load   (void * load);
+    void   end_async_load  (void * load);
+
     Texture * create_texture(String name, unsigned char * data, int width, int height, int bytes_per_pixel = 4);
 
 
 private: // @Cleanup I don't like this. If it's private, don't make it part of the struct namespace, just use a local function.
+    int current_frame = 0;
+    bool warned_over_budget = false;
+
+    Array<Texture *> eviction_candidates;
+
     void do_load_texture(Texture * texture);
+    bool should_skip_load(Texture * texture);
+    void evict_texture(Texture * texture);
 };
@@ -0,0 +1,112 @@
+// Mixes N voices for M seconds of audio as fast as it can, no device involved, and reports how many voices one core
+// could keep mixing in real time. Built with /tools, see builder.cpp.
+//
+//     audio_benchmark [voices] [seconds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "audio_mixer.h"
+#include "os/layer.h"
+#include "hash.h"
+#include "macros.h"
+#include "math_m.h"
+
+// Private functions
+static AudioClip make_test_clip(int num_channels, int sample_rate, double frequency, double seconds);
+
+// Const
+const int DEFAULT_VOICES  = 64;
+const int DEFAULT_SECONDS = 60;
+
+int main(int argc, char * argv[]) {
+    int num_voices  = argc > 1 ? atoi(argv[1]) : DEFAULT_VOICES;
+    int num_seconds = argc > 2 ? atoi(argv[2]) : DEFAULT_SECONDS;
+
+    if(num_voices <= 0 || num_seconds <= 0) {
+        printf("Usage: audio_benchmark [voices] [seconds]\n");
+        return 1;
+    }
+
+    if(num_voices > MAX_VOICES) {
+        printf("The mixer plays at most %d voices, mixing that many\n", MAX_VOICES);
+        num_voices = MAX_VOICES;
+    }
+
+    os_specific_init_clock();
+    init_audio_mixer();
+
+    // What we'd play in a game: some clips at the output rate, some that need resampling, mono and stereo.
+    AudioClip clips[] = {
+        make_test_clip(1, MIXER_OUTPUT_RATE, 440.0, 1.0),
+        make_test_clip(1, 22050,             220.0, 0.5),
+        make_test_clip(2, 48000,             330.0, 2.0),
+        make_test_clip(2, MIXER_OUTPUT_RATE, 550.0, 1.5),
+    };
+
+    srand(1234); // Same mix every run, so the checksum means something.
+
+    // Filling the categories in order, so the limits don't steal any of them.
+    int category       = 0;
+    int category_count = 0;
+
+    for(int i = 0; i < num_voices; i++) {
+        AudioClip * clip = &clips[i % array_size(clips)];
+
+        float gain = 1.0f / num_voices;
+        float pan  = (rand() / (float) RAND_MAX) * 2.0f - 1.0f;
+
+        if(category_count == SOUND_CATEGORY_VOICE_LIMITS[category]) {
+            category      += 1;
+            category_count = 0;
+        }
+
+        play_clip(clip, gain, pan, LOOP_FOREVER, (SoundCategory) category);
+        category_count += 1;
+    }
+
+    int total_frames = num_seconds * MIXER_OUTPUT_RATE;
+
+    short * block = (short *) malloc(MIX_BLOCK_FRAMES * MIXER_OUTPUT_CHANNELS * sizeof(short));
+    scope_exit(free(block));
+
+    unsigned long long checksum = 0;
+
+    double begin = os_specific_get_time();
+
+    for(int mixed = 0; mixed < total_frames; mixed += MIX_BLOCK_FRAMES) {
+        mix_audio(block, MIX_BLOCK_FRAMES);
+        checksum = murmur_hash_64a(block, MIX_BLOCK_FRAMES * MIXER_OUTPUT_CHANNELS * sizeof(short), checksum);
+    }
+
+    double elapsed = os_specific_get_time() - begin;
+
+    double realtime_factor = num_seconds / elapsed;
+    double num_blocks      = (double) total_frames / MIX_BLOCK_FRAMES;
+
+    printf("Mixed %d voices for %d seconds in %.3f seconds\n", num_voices, num_seconds, elapsed);
+    printf("    %.1fx real time, %.2f us per block of %d frames\n", realtime_factor, elapsed / num_blocks * 1000000, MIX_BLOCK_FRAMES);
+    printf("    %.2f ns per voice per frame\n", elapsed / ((double) num_voices * total_frames) * 1000000000);
+    printf("    %.0f voices per core\n", num_voices * realtime_factor);
+    printf("    checksum %016llx\n", checksum);
+
+    return 0;
+}
+
+static AudioClip make_test_clip(int num_channels, int sample_rate, double frequency, double seconds) {
+    AudioClip clip;
+    clip.num_channels = num_channels;
+    clip.sample_rate  = sample_rate;
+    clip.num_frames   = (int) (sample_rate * seconds);
+    clip.samples      = (float *) malloc(clip.num_frames * num_channels * sizeof(float));
+
+    for(int i = 0; i < clip.num_frames; i++) {
+        for(int channel = 0; channel < num_channels; channel++) {
+            double phase = (double) i / sample_rate * frequency * (channel + 1);
+            clip.samples[i * num_channels + channel] = (float) sin(phase * TAU);
+        }
+    }
+
+    return clip;
+}
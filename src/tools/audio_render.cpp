@@ -0,0 +1,460 @@
+// Plays a script of sounds through the mixer offline, into the null audio device (see null_audio.h), and reports how
+// long each block took to mix and a checksum of the output. The same script gives the same checksum on every run of
+// the same build on the same platform, and MIXER_NO_SIMD doesn't change it, so it catches any change to what the mixer
+// outputs. Only compare checksums from one platform: the tones and the pans go through the CRT's sin and cosf, which
+// don't round the same everywhere. Built with /tools, see builder.cpp.
+//
+//     audio_render [script] [-o output.wav] [-v]
+//
+// Without a script it plays DEFAULT_SCRIPT, which is also what a script looks like. -o writes what it mixed to a WAV
+// file, -v prints the time of every block.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "null_audio.h"
+#include "audio_mixer.h"
+#include "audio_manager.h"
+#include "job_system.h"
+#include "parsing.h"
+#include "os/layer.h"
+#include "macros.h"
+#include "math_m.h"
+
+enum ScriptEventType {
+    SCRIPT_PLAY,
+    SCRIPT_STOP,
+    SCRIPT_GAIN,
+};
+
+struct ScriptSound {
+    String name;
+
+    // One or the other
+    AudioClip * tone;
+    Sound * sound;
+
+    unsigned int voice; // The last one we started.
+};
+
+struct ScriptEvent {
+    long long frame; // When, from the start.
+    int order;       // In the script, for events at the same frame.
+
+    ScriptEventType type;
+    int sound; // In sounds
+
+    float gain;
+    float pan;
+    int loops;
+    SoundCategory category;
+    int priority;
+};
+
+// Private functions
+static bool parse_script(char * c_name, String script);
+static bool parse_play_options(int line_number, String line, ScriptEvent * event);
+static int  find_script_sound(String name);
+static AudioClip * make_tone(float frequency, float seconds, int sample_rate, int num_channels);
+static int  compare_events(const void * a, const void * b);
+static int  compare_times(const void * a, const void * b);
+
+// Const
+//     tone <name> <frequency> <seconds> <sample rate> <channels>
+//     sound <name> <path to a WAV file>
+//     at <seconds> play <name> [gain <g>] [pan <p>] [loops <n> or forever] [category <effects, ui, ambience or music>] [priority <n>]
+//     at <seconds> stop <name>
+//     at <seconds> gain <name> <gain> [pan]
+//     end <seconds>
+//
+// Voices start, stop and change between blocks, at the first block boundary after their time.
+const char * DEFAULT_SCRIPT =
+    "VERSION <1>\n"
+    "\n"
+    "// Resampled, mono and stereo, looping and not, and more UI sounds than the category takes at the end.\n"
+    "tone drone  55   2.0   44100 1\n"
+    "tone pad    220  1.5   48000 2\n"
+    "tone blip   880  0.1   22050 1\n"
+    "tone chirp  1760 0.05  32000 2\n"
+    "\n"
+    "at 0.0  play drone gain 0.2 loops forever category ambience\n"
+    "at 0.25 play pad   gain 0.2 pan -0.5 loops 2 category music\n"
+    "at 0.5  play blip  gain 0.2 pan 0.8\n"
+    "at 1.0  play chirp gain 0.2 pan -0.8 loops 10\n"
+    "at 1.5  gain drone 0.1 -0.3\n"
+    "at 2.0  play blip  gain 0.05 category ui\n"
+    "at 2.0  play blip  gain 0.05 category ui pan 0.1\n"
+    "at 2.0  play blip  gain 0.05 category ui pan 0.2\n"
+    "at 2.0  play blip  gain 0.05 category ui pan 0.3\n"
+    "at 2.0  play blip  gain 0.05 category ui pan 0.4\n"
+    "at 2.0  play blip  gain 0.05 category ui pan 0.5\n"
+    "at 2.0  play blip  gain 0.05 category ui pan 0.6\n"
+    "at 2.0  play blip  gain 0.05 category ui pan 0.7\n"
+    "at 2.0  play chirp gain 0.1 category ui priority 1\n"
+    "at 3.0  stop drone\n"
+    "at 3.0  play pad   gain 0.3 category music\n"
+    "end 6.0\n";
+
+const char * CATEGORY_NAMES[NUM_SOUND_CATEGORIES] = { "effects", "ui", "ambience", "music" };
+
+// Globals
+static Array<ScriptSound> sounds;
+static Array<ScriptEvent> events;
+static long long end_frame;
+
+static AudioManager audio_manager;
+
+int main(int argc, char * argv[]) {
+    char * script_path = NULL;
+    char * wav_path    = NULL;
+    bool verbose       = false;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            wav_path = argv[i + 1];
+            i += 1;
+        } else if(strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if(argv[i][0] != '-' && !script_path) {
+            script_path = argv[i];
+        } else {
+            printf("Usage: audio_render [script] [-o output.wav] [-v]\n");
+            return 1;
+        }
+    }
+
+    os_specific_init_clock();
+    init_job_system();
+    scope_exit(shutdown_job_system());
+
+    if(!init_null_audio(wav_path ? NULL_AUDIO_WAV_FILE : NULL_AUDIO_MEMORY, wav_path)) return 1;
+    scope_exit(shutdown_null_audio());
+
+    audio_manager.init();
+
+    String script;
+
+    if(script_path) {
+        script = os_specific_read_file(to_string(script_path));
+        if(!script.data) return 1; // Already complained.
+    } else {
+        script_path = "default script";
+        script      = to_string_copy((char *) DEFAULT_SCRIPT);
+    }
+
+    scope_exit(free(script.data));
+
+    if(!parse_script(script_path, script)) return 1;
+
+    wait_for_all_jobs(); // Nothing loads asynchronously, but to be sure.
+
+    qsort(events.data, events.count, sizeof(ScriptEvent), compare_events);
+
+    int num_blocks = (int) ((end_frame + MIX_BLOCK_FRAMES - 1) / MIX_BLOCK_FRAMES);
+
+    double * block_times = (double *) malloc(num_blocks * sizeof(double));
+    scope_exit(free(block_times));
+
+    int next_event = 0;
+
+    for(int i = 0; i < num_blocks; i++) {
+        long long block_start = (long long) i * MIX_BLOCK_FRAMES;
+
+        for(; next_event < events.count && events.data[next_event].frame <= block_start; next_event++) {
+            ScriptEvent * event = &events.data[next_event];
+            ScriptSound * sound = &sounds.data[event->sound];
+
+            if(event->type == SCRIPT_PLAY) {
+                if(sound->tone) {
+                    sound->voice = play_clip(sound->tone, event->gain, event->pan, event->loops, event->category, event->priority);
+                } else {
+                    sound->voice = audio_manager.play_sound(sound->sound, event->gain, event->pan, event->loops, event->category, event->priority);
+                }
+            } else if(event->type == SCRIPT_STOP) {
+                stop_voice(sound->voice);
+            } else {
+                set_voice_gain(sound->voice, event->gain, event->pan);
+            }
+        }
+
+        double begin = os_specific_get_time();
+        render_null_audio(MIX_BLOCK_FRAMES);
+        block_times[i] = os_specific_get_time() - begin;
+
+        // Streams get their chunks between the blocks, whatever the job system does, so they never run dry and the
+        // output doesn't depend on timing.
+        audio_manager.update_streams();
+        wait_for_all_jobs();
+    }
+
+    double total = 0.0;
+    for(int i = 0; i < num_blocks; i++) total += block_times[i];
+
+    if(verbose) {
+        for(int i = 0; i < num_blocks; i++) printf("block %5d: %8.2f us\n", i, block_times[i] * 1000000);
+    }
+
+    qsort(block_times, num_blocks, sizeof(double), compare_times);
+
+    double seconds = (double) num_blocks * MIX_BLOCK_FRAMES / MIXER_OUTPUT_RATE;
+
+    printf("Rendered %.2f seconds of %s, %d blocks of %d frames, in %.3f seconds, %.1fx real time\n", seconds, script_path, num_blocks, MIX_BLOCK_FRAMES, total, seconds / total);
+    printf("    per block: min %.2f us, mean %.2f us, 99%% %.2f us, max %.2f us\n", block_times[0] * 1000000, total / num_blocks * 1000000, block_times[(num_blocks - 1) * 99 / 100] * 1000000, block_times[num_blocks - 1] * 1000000);
+
+    if(!wav_path) {
+        int num_frames;
+        short * output = get_null_audio_output(&num_frames);
+
+        int peak = 0;
+        for(int i = 0; i < num_frames * MIXER_OUTPUT_CHANNELS; i++) {
+            int level = output[i] < 0 ? -output[i] : output[i];
+            if(level > peak) peak = level;
+        }
+
+        printf("    peak %.1f dBFS%s\n", peak ? 20.0 * log10(peak / 32767.0) : -INFINITY, peak >= 32767 ? ", clipped" : "");
+    } else {
+        printf("    written to %s\n", wav_path);
+    }
+
+    printf("    checksum %016llx\n", get_null_audio_checksum());
+
+    return 0;
+}
+
+static bool parse_script(char * c_name, String script) {
+    Array<String> lines = strip_comments_from_file(script);
+    scope_exit(free(lines.data));
+
+    if(get_file_version_number(lines, c_name) != 1) return false; // Already complained, unless it's another version.
+
+    int line_number = 1;
+    bool success    = true;
+
+    end_frame = -1;
+
+    while(true) {
+        String line = lines.data[line_number];
+        line_number += 1;
+
+        if(line.count == -1) break; // EOF
+
+        cut_spaces(&line);
+        cut_trailing_spaces(&line);
+        if(line.count == 0) continue; // Empty line
+
+        String command = cut_until_space(&line);
+
+        if(command == "tone") {
+            ScriptSound sound = {};
+            sound.name = cut_until_space(&line);
+
+            float frequency, seconds;
+            int sample_rate, num_channels;
+
+            bool parsed = string_to_float(cut_until_space(&line), &frequency) && string_to_float(cut_until_space(&line), &seconds) &&
+                          string_to_int(cut_until_space(&line), &sample_rate) && string_to_int(cut_until_space(&line), &num_channels);
+
+            if(!parsed || !sound.name.count || line.count || seconds <= 0.0f || sample_rate <= 0 || num_channels < 1 || num_channels > 2) {
+                printf("%s, line %d: expected tone <name> <frequency> <seconds> <sample rate> <1 or 2 channels>\n", c_name, line_number);
+                success = false;
+                continue;
+            }
+
+            sound.tone = make_tone(frequency, seconds, sample_rate, num_channels);
+            sounds.add(sound);
+        } else if(command == "sound") {
+            ScriptSound sound = {};
+            sound.name = cut_until_space(&line);
+
+            if(!sound.name.count || !line.count) {
+                printf("%s, line %d: expected sound <name> <path to a WAV file>\n", c_name, line_number);
+                success = false;
+                continue;
+            }
+
+            // The manager keeps both.
+            char * c_path  = to_c_string(line);
+            char * c_sound = to_c_string(sound.name);
+
+            audio_manager.reload_or_create_asset(to_string(c_path), to_string(c_sound));
+            sound.sound = audio_manager.table.find(sound.name);
+
+            if(!sound.sound->loaded) {
+                success = false; // Already complained.
+                continue;
+            }
+
+            sounds.add(sound);
+        } else if(command == "at") {
+            ScriptEvent event = {};
+            event.order    = events.count;
+            event.gain     = 1.0f;
+            event.category = SOUND_CATEGORY_EFFECTS;
+
+            float seconds;
+            String time = cut_until_space(&line);
+
+            if(!time.count || !string_to_float(time, &seconds)) {
+                printf("%s, line %d: expected a time in seconds after \"at\"\n", c_name, line_number);
+                success = false;
+                continue;
+            }
+
+            event.frame = (long long) (seconds * MIXER_OUTPUT_RATE + 0.5f);
+
+            String type = cut_until_space(&line);
+            String name = cut_until_space(&line);
+
+            event.sound = find_script_sound(name);
+
+            if(event.sound < 0) {
+                char * c_sound = to_c_string(name);
+                scope_exit(free(c_sound));
+
+                printf("%s, line %d: no sound called \"%s\" before this line\n", c_name, line_number, c_sound);
+                success = false;
+                continue;
+            }
+
+            if(type == "play") {
+                event.type = SCRIPT_PLAY;
+
+                if(!parse_play_options(line_number, line, &event)) {
+                    success = false;
+                    continue;
+                }
+            } else if(type == "stop") {
+                event.type = SCRIPT_STOP;
+            } else if(type == "gain") {
+                event.type = SCRIPT_GAIN;
+
+                String gain = cut_until_space(&line);
+                String pan  = cut_until_space(&line);
+
+                if(!gain.count || !string_to_float(gain, &event.gain) || (pan.count && !string_to_float(pan, &event.pan))) {
+                    printf("%s, line %d: expected gain <name> <gain> [pan]\n", c_name, line_number);
+                    success = false;
+                    continue;
+                }
+            } else {
+                printf("%s, line %d: expected play, stop or gain after the time\n", c_name, line_number);
+                success = false;
+                continue;
+            }
+
+            events.add(event);
+        } else if(command == "end") {
+            float seconds;
+
+            if(!line.count || !string_to_float(line, &seconds)) {
+                printf("%s, line %d: expected end <seconds>\n", c_name, line_number);
+                success = false;
+                continue;
+            }
+
+            end_frame = (long long) (seconds * MIXER_OUTPUT_RATE + 0.5f);
+        } else {
+            char * c_command = to_c_string(command);
+            scope_exit(free(c_command));
+
+            printf("%s, line %d: unknown command \"%s\"\n", c_name, line_number, c_command);
+            success = false;
+        }
+    }
+
+    if(end_frame <= 0) {
+        printf("%s: needs an end, after which nothing gets mixed\n", c_name);
+        success = false;
+    }
+
+    return success;
+}
+
+static bool parse_play_options(int line_number, String line, ScriptEvent * event) {
+    while(line.count) {
+        String option = cut_until_space(&line);
+        String value  = cut_until_space(&line);
+
+        bool parsed = value.count > 0;
+
+        if(!parsed) {
+            // Complained about below.
+        } else if(option == "gain") {
+            parsed = string_to_float(value, &event->gain);
+        } else if(option == "pan") {
+            parsed = string_to_float(value, &event->pan);
+        } else if(option == "loops") {
+            if(value == "forever") event->loops = LOOP_FOREVER;
+            else parsed = string_to_int(value, &event->loops);
+        } else if(option == "priority") {
+            parsed = string_to_int(value, &event->priority);
+        } else if(option == "category") {
+            parsed = false;
+
+            for(int i = 0; i < NUM_SOUND_CATEGORIES; i++) {
+                if(value != (char *) CATEGORY_NAMES[i]) continue;
+
+                event->category = (SoundCategory) i;
+                parsed = true;
+            }
+        } else {
+            parsed = false;
+        }
+
+        if(!parsed) {
+            char * c_option = to_c_string(option);
+            scope_exit(free(c_option));
+
+            printf("line %d: bad play option \"%s\", see the top of audio_render.cpp\n", line_number, c_option);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int find_script_sound(String name) {
+    for(int i = 0; i < sounds.count; i++) {
+        if(sounds.data[i].name == name) return i;
+    }
+
+    return -1;
+}
+
+// A sine, the right channel an octave up.
+static AudioClip * make_tone(float frequency, float seconds, int sample_rate, int num_channels) {
+    AudioClip * clip = (AudioClip *) malloc(sizeof(AudioClip));
+    clip->num_channels = num_channels;
+    clip->sample_rate  = sample_rate;
+    clip->num_frames   = (int) (sample_rate * seconds);
+    clip->samples      = (float *) malloc(clip->num_frames * num_channels * sizeof(float));
+
+    for(int i = 0; i < clip->num_frames; i++) {
+        for(int channel = 0; channel < num_channels; channel++) {
+            double phase = (double) i / sample_rate * frequency * (channel + 1);
+            clip->samples[i * num_channels + channel] = (float) sin(phase * TAU);
+        }
+    }
+
+    return clip;
+}
+
+static int compare_events(const void * a, const void * b) {
+    ScriptEvent * first  = (ScriptEvent *) a;
+    ScriptEvent * second = (ScriptEvent *) b;
+
+    if(first->frame != second->frame) return first->frame < second->frame ? -1 : 1;
+
+    return first->order - second->order;
+}
+
+static int compare_times(const void * a, const void * b) {
+    double first  = *(double *) a;
+    double second = *(double *) b;
+
+    if(first == second) return 0;
+
+    return first < second ? -1 : 1;
+}